@@ -32,6 +32,149 @@ using namespace std;
 		assert(local || prob_.cper_->debugCell(rowc, colc, hefc)); \
 	}
 
+/**
+ * Split 8 consecutive CpQuads into vectors of their H, E, F fields.
+ */
+static inline void loadQuads8(
+	const CpQuad *q,
+	__m128i& h,
+	__m128i& e,
+	__m128i& f)
+{
+	__m128i a0 = _mm_loadu_si128((const __m128i*)(q + 0));
+	__m128i a1 = _mm_loadu_si128((const __m128i*)(q + 2));
+	__m128i a2 = _mm_loadu_si128((const __m128i*)(q + 4));
+	__m128i a3 = _mm_loadu_si128((const __m128i*)(q + 6));
+	__m128i t0 = _mm_unpacklo_epi16(a0, a1);
+	__m128i t1 = _mm_unpackhi_epi16(a0, a1);
+	__m128i t2 = _mm_unpacklo_epi16(a2, a3);
+	__m128i t3 = _mm_unpackhi_epi16(a2, a3);
+	__m128i u0 = _mm_unpacklo_epi16(t0, t1); // H0-3, E0-3
+	__m128i u1 = _mm_unpackhi_epi16(t0, t1); // F0-3, mask0-3
+	__m128i u2 = _mm_unpacklo_epi16(t2, t3); // H4-7, E4-7
+	__m128i u3 = _mm_unpackhi_epi16(t2, t3); // F4-7, mask4-7
+	h = _mm_unpacklo_epi64(u0, u2);
+	e = _mm_unpackhi_epi64(u0, u2);
+	f = _mm_unpacklo_epi64(u1, u3);
+}
+
+/**
+ * Interleave vectors of H, E, F and mask fields into 8 consecutive CpQuads.
+ */
+static inline void storeQuads8(
+	CpQuad *q,
+	__m128i h,
+	__m128i e,
+	__m128i f,
+	__m128i m)
+{
+	__m128i v0 = _mm_unpacklo_epi16(h, e);
+	__m128i v1 = _mm_unpackhi_epi16(h, e);
+	__m128i w0 = _mm_unpacklo_epi16(f, m);
+	__m128i w1 = _mm_unpackhi_epi16(f, m);
+	_mm_storeu_si128((__m128i*)(q + 0), _mm_unpacklo_epi32(v0, w0));
+	_mm_storeu_si128((__m128i*)(q + 2), _mm_unpackhi_epi32(v0, w0));
+	_mm_storeu_si128((__m128i*)(q + 4), _mm_unpacklo_epi32(v1, w1));
+	_mm_storeu_si128((__m128i*)(q + 6), _mm_unpackhi_epi32(v1, w1));
+}
+
+/**
+ * Return m ? a : b, lane by lane.
+ */
+static inline __m128i select16(__m128i m, __m128i a, __m128i b) {
+	return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+}
+
+/**
+ * Fill 8 consecutive cells of a triangle diagonal, none of them in the top
+ * row or leftmost column of the DP table, computing exactly what the
+ * scalar loop in triangleFill() computes for them.  prev1 and prev2 point
+ * to the cells' up neighbors in diagonals -1 and -2 (the left neighbors in
+ * diagonal -1 are at prev1+1).  'diag' holds the match/mismatch score of
+ * each cell and 'gaps' is all ones for cells where gaps are allowed.
+ */
+static inline void triangleFill8(
+	const CpQuad *prev1,
+	const CpQuad *prev2,
+	CpQuad *cur,
+	__m128i diag,
+	__m128i gaps,
+	int16_t sc_rdo,
+	int16_t sc_rde,
+	int16_t sc_rfo,
+	int16_t sc_rfe,
+	bool local)
+{
+	const __m128i vmin = _mm_set1_epi16(MIN_I16);
+	const __m128i vzero = _mm_setzero_si128();
+	__m128i h_up, e_up, f_up, h_lf, e_lf, f_lf, h_dg, e_dg, f_dg;
+	loadQuads8(prev1, h_up, e_up, f_up);
+	loadQuads8(prev1 + 1, h_lf, e_lf, f_lf);
+	loadQuads8(prev2, h_dg, e_dg, f_dg);
+	(void)e_up; (void)f_lf; (void)e_dg; (void)f_dg;
+	// Gap moves into the cell, from cells that aren't unreachable
+	__m128i ok;
+	ok = _mm_and_si128(gaps, _mm_cmpgt_epi16(h_up, vmin));
+	h_up = select16(ok, _mm_sub_epi16(h_up, _mm_set1_epi16(sc_rfo)), vmin);
+	ok = _mm_and_si128(gaps, _mm_cmpgt_epi16(f_up, vmin));
+	f_up = select16(ok, _mm_sub_epi16(f_up, _mm_set1_epi16(sc_rfe)), vmin);
+	ok = _mm_and_si128(gaps, _mm_cmpgt_epi16(h_lf, vmin));
+	h_lf = select16(ok, _mm_sub_epi16(h_lf, _mm_set1_epi16(sc_rdo)), vmin);
+	ok = _mm_and_si128(gaps, _mm_cmpgt_epi16(e_lf, vmin));
+	e_lf = select16(ok, _mm_sub_epi16(e_lf, _mm_set1_epi16(sc_rde)), vmin);
+	// Diagonal move
+	ok = _mm_cmpgt_epi16(h_dg, vmin);
+	h_dg = select16(ok, _mm_add_epi16(h_dg, diag), h_dg);
+	if(local) {
+		// Gap moves from reachable cells are clamped at 0; unreachable
+		// ones stay MIN_I16.  The diagonal move is always clamped.
+		h_up = select16(_mm_cmpeq_epi16(h_up, vmin), vmin, _mm_max_epi16(h_up, vzero));
+		f_up = select16(_mm_cmpeq_epi16(f_up, vmin), vmin, _mm_max_epi16(f_up, vzero));
+		h_lf = select16(_mm_cmpeq_epi16(h_lf, vmin), vmin, _mm_max_epi16(h_lf, vzero));
+		e_lf = select16(_mm_cmpeq_epi16(e_lf, vmin), vmin, _mm_max_epi16(e_lf, vzero));
+		h_dg = _mm_max_epi16(h_dg, vzero);
+	}
+	// Best way into H; see the mask bits described in triangleFill()
+	__m128i mask = _mm_set1_epi16(1);
+	__m128i best = h_dg;
+	__m128i gt;
+	gt = _mm_cmpgt_epi16(h_lf, best);
+	mask = _mm_or_si128(_mm_andnot_si128(gt, mask),
+		_mm_andnot_si128(_mm_cmpgt_epi16(best, h_lf), _mm_set1_epi16(2)));
+	best = _mm_max_epi16(best, h_lf);
+	gt = _mm_cmpgt_epi16(e_lf, best);
+	mask = _mm_or_si128(_mm_andnot_si128(gt, mask),
+		_mm_andnot_si128(_mm_cmpgt_epi16(best, e_lf), _mm_set1_epi16(4)));
+	best = _mm_max_epi16(best, e_lf);
+	gt = _mm_cmpgt_epi16(h_up, best);
+	mask = _mm_or_si128(_mm_andnot_si128(gt, mask),
+		_mm_andnot_si128(_mm_cmpgt_epi16(best, h_up), _mm_set1_epi16(8)));
+	best = _mm_max_epi16(best, h_up);
+	gt = _mm_cmpgt_epi16(f_up, best);
+	mask = _mm_or_si128(_mm_andnot_si128(gt, mask),
+		_mm_andnot_si128(_mm_cmpgt_epi16(best, f_up), _mm_set1_epi16(16)));
+	best = _mm_max_epi16(best, f_up);
+	// Best way into E
+	__m128i e_gt = _mm_cmpgt_epi16(e_lf, h_lf);
+	mask = _mm_or_si128(mask, _mm_andnot_si128(e_gt, _mm_set1_epi16(32)));
+	mask = _mm_or_si128(mask, _mm_and_si128(
+		_mm_or_si128(e_gt, _mm_cmpeq_epi16(e_lf, h_lf)), _mm_set1_epi16(64)));
+	__m128i e_best = _mm_max_epi16(h_lf, e_lf);
+	gt = _mm_cmpgt_epi16(e_best, best);
+	mask = _mm_andnot_si128(_mm_and_si128(gt, _mm_set1_epi16(31)), mask);
+	best = _mm_max_epi16(best, e_best);
+	// Best way into F
+	__m128i f_gt = _mm_cmpgt_epi16(f_up, h_up);
+	mask = _mm_or_si128(mask, _mm_andnot_si128(f_gt, _mm_set1_epi16(128)));
+	mask = _mm_or_si128(mask, _mm_and_si128(
+		_mm_or_si128(f_gt, _mm_cmpeq_epi16(f_up, h_up)), _mm_set1_epi16(256)));
+	__m128i f_best = _mm_max_epi16(h_up, f_up);
+	gt = _mm_cmpgt_epi16(f_best, best);
+	mask = _mm_andnot_si128(_mm_and_si128(gt, _mm_set1_epi16(127)), mask);
+	best = _mm_max_epi16(best, f_best);
+	storeQuads8(cur, best, e_best, f_best, mask);
+}
+
 /**
  * Fill in a triangle of the DP table and backtrace from the given cell to
  * a cell in the previous checkpoint, or to the terminal cell.
@@ -124,10 +267,50 @@ void BtBranchTracer::triangleFill(
 		int64_t colc = col;
 		size_t neval = 0; // # cells evaluated in this diag
 		ASSERT_ONLY(const CpQuad *last = NULL);
+		// Cells [vlo, vhi) are neither in the top row nor in the leftmost
+		// column, so all their neighbors are available.  Fill them 8 at a
+		// time with SSE2 and leave the rest to the scalar loop below.
+		size_t vlo = 0, vhi = 0;
+		if(!upperleft || i >= 2) {
+			int64_t lo = max<int64_t>(0, (int64_t)doff - row + 1);
+			int64_t hi = min<int64_t>((int64_t)breadth, col);
+			if(hi - lo >= 8) {
+				vlo = (size_t)lo;
+				vhi = vlo + ((size_t)(hi - lo) & ~(size_t)7);
+			}
+		}
+		for(size_t j = vlo; j < vhi; j += 8) {
+			int16_t diag[8], gaps[8];
+			int64_t rowv = row - doff + j;
+			for(size_t k = 0; k < 8; k++, rowv++) {
+				int64_t fromend = prob_.qrylen_ - rowv - 1;
+				gaps[k] = (fromend >= prob_.sc_->gapbar &&
+				           rowv >= prob_.sc_->gapbar) ? -1 : 0;
+				int qq = prob_.qual_[rowv];
+				assert_geq(qq, 33);
+				int rc = prob_.ref_[col - (int64_t)(j + k)];
+				assert_range(0, 16, rc);
+				diag[k] = prob_.sc_->score(prob_.qry_[rowv], rc, qq - 33);
+			}
+			triangleFill8(
+				prev1 + j,
+				prev2 + j,
+				cur + j,
+				_mm_loadu_si128((const __m128i*)diag),
+				_mm_loadu_si128((const __m128i*)gaps),
+				(int16_t)sc_rdo,
+				(int16_t)sc_rde,
+				(int16_t)sc_rfo,
+				(int16_t)sc_rfe,
+				local);
+		}
+		neval += vhi - vlo;
 		// Fill this diagonal from upper right to lower left
 		for(size_t j = 0; j < breadth; j++) {
-			if(rowc >= rowmin && rowc <= rowmax &&
-			   colc >= colmin && colc <= colmax)
+			if(j >= vlo && j < vhi) {
+				// Filled above
+			} else if(rowc >= rowmin && rowc <= rowmax &&
+			          colc >= colmin && colc <= colmax)
 			{
 				neval++;
 				int64_t fromend = prob_.qrylen_ - rowc - 1;
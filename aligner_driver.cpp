@@ -261,8 +261,76 @@ void IntervalRootSelector::select(
  * during the search and extending each with DP.  The process might also be
  * iterated, with the search being occasioanally halted so that DPs can be
  * tried, then restarted, etc.
+ *
+ * Each mate is searched with its own budget and its alignments are reported
+ * as unpaired alignments.  For paired-end reads, pairs of those alignments
+ * that satisfy the paired-end policy are then reported as concordant.
  */
 int AlignerDriver::go(
+	const Scoring& sc,
+	const Ebwt& ebwtFw,
+	const Ebwt& ebwtBw,
+	const BitPairReference& ref,
+	DescentMetrics& met,
+	WalkMetrics& wlm,
+	PerReadMetrics& prm,
+	RandomSource& rnd,
+	AlnSinkWrap& sink,
+	const PairedEndPolicy* pepol)
+{
+	mateAls_[0].clear();
+	mateAls_[1].clear();
+	int ret = goMate(dr1_, red1_, stop_, q1IsMate1_, sc, ebwtFw, ebwtBw, ref,
+	                 met, wlm, prm, rnd, sink);
+	if(!paired_ || ret == ALDRIVER_POLICY_FULFILLED) {
+		return ret;
+	}
+	int ret2 = goMate(dr2_, red2_, stop2_, !q1IsMate1_, sc, ebwtFw, ebwtBw, ref,
+	                  met, wlm, prm, rnd, sink);
+	if(ret2 == ALDRIVER_POLICY_FULFILLED) {
+		return ret2;
+	}
+	if(pepol != NULL) {
+		// Report every pair of mate alignments that is concordant
+		for(size_t i = 0; i < mateAls_[0].size(); i++) {
+			const AlnRes& r1 = mateAls_[0][i];
+			for(size_t j = 0; j < mateAls_[1].size(); j++) {
+				const AlnRes& r2 = mateAls_[1][j];
+				if(sink.state().doneConcordant()) {
+					break;
+				}
+				if(r1.refid() != r2.refid()) {
+					continue;
+				}
+				int pairCl = pepol->peClassifyPair(
+					r1.refoff(),
+					r1.refExtent(),
+					r1.fw(),
+					r2.refoff(),
+					r2.refExtent(),
+					r2.fw());
+				if(pairCl != PE_ALS_DISCORD && sink.report(0, &r1, &r2)) {
+					// Short-circuited because a limit, e.g. -k, -m or -M,
+					// was exceeded
+					return ALDRIVER_POLICY_FULFILLED;
+				}
+			}
+		}
+	}
+	return (ret == ALDRIVER_EXCEEDED_LIMIT) ? ret : ret2;
+}
+
+/**
+ * Run the best-first search for one mate until it is exhausted or its
+ * memory or FM-index-op budget runs out, reporting each completed stratum
+ * of alignments as unpaired alignments for that mate.  The FM-index-op
+ * budget applies to the whole search, not to each call to advance().
+ */
+int AlignerDriver::goMate(
+	DescentDriver& dr,
+	RedundantAlns& red,
+	const DescentStoppingConditions& stopc,
+	bool mate1,
 	const Scoring& sc,
 	const Ebwt& ebwtFw,
 	const Ebwt& ebwtBw,
@@ -273,120 +341,126 @@ int AlignerDriver::go(
 	RandomSource& rnd,
 	AlnSinkWrap& sink)
 {
-	if(paired_) {
-		// Paired-end - alternate between advancing dr1_ / dr2_ whenever a
-		// new full alignment is discovered in the one currently being
-		// advanced.  Whenever a new full alignment is found, check to see
-		// if it pairs with a previously discovered alignment.
-		bool first1 = rnd.nextBool();
-		bool first = true;
-		DescentStoppingConditions stopc1 = stop_;
-		DescentStoppingConditions stopc2 = stop_;
-		size_t totszIncr = (stop_.totsz + 7) / 8;
-		stopc1.totsz = totszIncr;
-		stopc2.totsz = totszIncr;
-		while(stopc1.totsz <= stop_.totsz && stopc2.totsz <= stop_.totsz) {
-			if(first && first1 && stopc1.totsz <= stop_.totsz) {
-				dr1_.advance(stop_, sc, ebwtFw, ebwtBw, met, prm);
-				stopc1.totsz += totszIncr;
+	DescentStoppingConditions stopcur = stopc;
+	const uint64_t nbwop_i = met.bwops;
+	while(true) {
+		if(stopc.nbwop > 0) {
+			uint64_t used = met.bwops - nbwop_i;
+			if(used >= stopc.nbwop) {
+				break;
 			}
-			if(stopc2.totsz <= stop_.totsz) {
-				dr2_.advance(stop_, sc, ebwtFw, ebwtBw, met, prm);
-				stopc2.totsz += totszIncr;
+			stopcur.nbwop = (size_t)(stopc.nbwop - used);
+		}
+		int ret = dr.advance(stopcur, sc, ebwtFw, ebwtBw, met, prm);
+		if(ret == DESCENT_DRIVER_STRATA || ret == DESCENT_DRIVER_ALN) {
+			// DESCENT_DRIVER_STRATA is returned by DescentDriver.advance()
+			// when it has finished with a "non-empty" stratum: a stratum
+			// in which at least one alignment was found.  Here we report
+			// the alignments in an arbitrary order.
+			if(reportStratum(dr, red, mate1, ebwtFw, ref, wlm, prm, rnd, sink)) {
+				// Short-circuited because a limit, e.g. -k, -m or -M, was
+				// exceeded
+				return ALDRIVER_POLICY_FULFILLED;
 			}
-			first = false;
+			continue;
 		}
-	} else {
-		// Unpaired
-		size_t iter = 1;
-		while(true) {
-			int ret = dr1_.advance(stop_, sc, ebwtFw, ebwtBw, met, prm);
-			if(ret == DESCENT_DRIVER_ALN) {
-				cerr << iter << ". DESCENT_DRIVER_ALN" << endl;
-			} else if(ret == DESCENT_DRIVER_MEM) {
-				cerr << iter << ". DESCENT_DRIVER_MEM" << endl;
-				break;
-			} else if(ret == DESCENT_DRIVER_STRATA) {
-				// DESCENT_DRIVER_STRATA is returned by DescentDriver.advance()
-				// when it has finished with a "non-empty" stratum: a stratum
-				// in which at least one alignment was found.  Here we report
-				// the alignments in an arbitrary order.
-				AlnRes res;
-				// Initialize alignment selector with the DescentDriver's
-				// alignment sink
-				alsel_.init(
-					dr1_.query(),
-					dr1_.sink(),
-					ebwtFw,
-					ref,
-					rnd,
-					wlm);
-				while(!alsel_.done() && !sink.state().doneWithMate(true)) {
-					res.reset();
-					bool ret2 = alsel_.next(
-						dr1_,
-						ebwtFw,
-						ref,
-						rnd,
-						res,
-						wlm,
-						prm);
-					if(ret2) {
-						// Got an alignment
-						assert(res.matchesRef(
-							dr1_.query(),
-							ref,
-							tmp_rf_,
-							tmp_rdseq_,
-							tmp_qseq_,
-							raw_refbuf_,
-							raw_destU32_,
-							raw_matches_));
-						// Get reference interval involved in alignment
-						Interval refival(res.refid(), 0, res.fw(), res.reflen());
-						assert_gt(res.refExtent(), 0);
-						// Does alignment falls off end of reference?
-						if(gReportOverhangs &&
-						   !refival.containsIgnoreOrient(res.refival()))
-						{
-							res.clipOutside(true, 0, res.reflen());
-							if(res.refExtent() == 0) {
-								continue;
-							}
-						}
-						assert(gReportOverhangs ||
-							   refival.containsIgnoreOrient(res.refival()));
-						// Alignment fell entirely outside the reference?
-						if(!refival.overlapsIgnoreOrient(res.refival())) {
-							continue; // yes, fell outside
-						}
-						// Alignment redundant with one we've seen previously?
-						if(red1_.overlap(res)) {
-							continue; // yes, redundant
-						}
-						red1_.add(res); // so we find subsequent redundancies
-						// Report an unpaired alignment
-						assert(!sink.state().doneWithMate(true));
-						assert(!sink.maxed());
-						if(sink.report(0, &res, NULL)) {
-							// Short-circuited because a limit, e.g. -k, -m or
-							// -M, was exceeded
-							return ALDRIVER_POLICY_FULFILLED;
-						}
-					}
+		// Search stopped; report whatever is left in the current stratum
+		if(dr.sink().nelt() > 0 &&
+		   reportStratum(dr, red, mate1, ebwtFw, ref, wlm, prm, rnd, sink))
+		{
+			return ALDRIVER_POLICY_FULFILLED;
+		}
+		if(ret == DESCENT_DRIVER_DONE) {
+			return ALDRIVER_EXHAUSTED_CANDIDATES;
+		}
+		assert(ret == DESCENT_DRIVER_MEM || ret == DESCENT_DRIVER_BWOPS);
+		break;
+	}
+	return ALDRIVER_EXCEEDED_LIMIT;
+}
+
+/**
+ * Report all the alignments in the driver's current stratum, then advance
+ * the driver's sink to the next stratum.  Return true iff the reporting
+ * policy has been fulfilled.
+ */
+bool AlignerDriver::reportStratum(
+	DescentDriver& dr,
+	RedundantAlns& red,
+	bool mate1,
+	const Ebwt& ebwtFw,
+	const BitPairReference& ref,
+	WalkMetrics& wlm,
+	PerReadMetrics& prm,
+	RandomSource& rnd,
+	AlnSinkWrap& sink)
+{
+	assert_gt(dr.sink().nelt(), 0);
+	AlnRes res;
+	// Initialize alignment selector with the DescentDriver's alignment sink
+	alsel_.init(
+		dr.query(),
+		dr.sink(),
+		ebwtFw,
+		ref,
+		rnd,
+		wlm);
+	while(!alsel_.done() && !sink.state().doneWithMate(mate1)) {
+		res.reset();
+		bool ret2 = alsel_.next(
+			dr,
+			ebwtFw,
+			ref,
+			rnd,
+			res,
+			wlm,
+			prm);
+		if(ret2) {
+			// Got an alignment
+			assert(res.matchesRef(
+				dr.query(),
+				ref,
+				tmp_rf_,
+				tmp_rdseq_,
+				tmp_qseq_,
+				raw_refbuf_,
+				raw_destU32_,
+				raw_matches_));
+			// Get reference interval involved in alignment
+			Interval refival(res.refid(), 0, res.fw(), res.reflen());
+			assert_gt(res.refExtent(), 0);
+			// Does alignment falls off end of reference?
+			if(gReportOverhangs &&
+			   !refival.containsIgnoreOrient(res.refival()))
+			{
+				res.clipOutside(true, 0, res.reflen());
+				if(res.refExtent() == 0) {
+					continue;
 				}
-				dr1_.sink().advanceStratum();
-			} else if(ret == DESCENT_DRIVER_BWOPS) {
-				cerr << iter << ". DESCENT_DRIVER_BWOPS" << endl;
-				break;
-			} else if(ret == DESCENT_DRIVER_DONE) {
-				cerr << iter << ". DESCENT_DRIVER_DONE" << endl;
-				break;
-			} else {
-				assert(false);
 			}
-			iter++;
+			assert(gReportOverhangs ||
+				   refival.containsIgnoreOrient(res.refival()));
+			// Alignment fell entirely outside the reference?
+			if(!refival.overlapsIgnoreOrient(res.refival())) {
+				continue; // yes, fell outside
+			}
+			// Alignment redundant with one we've seen previously?
+			if(red.overlap(res)) {
+				continue; // yes, redundant
+			}
+			red.add(res); // so we find subsequent redundancies
+			mateAls_[mate1 ? 0 : 1].push_back(res);
+			// Report an unpaired alignment
+			assert(!sink.state().doneWithMate(mate1));
+			assert(!sink.maxed());
+			if(sink.report(0, mate1 ? &res : NULL, mate1 ? NULL : &res)) {
+				// Short-circuited because a limit, e.g. -k, -m or -M, was
+				// exceeded
+				dr.sink().advanceStratum();
+				return true;
+			}
 		}
 	}
-	return ALDRIVER_EXHAUSTED_CANDIDATES;
+	dr.sink().advanceStratum();
+	return false;
 }
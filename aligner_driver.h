@@ -78,6 +78,7 @@
 #include "aligner_seed2.h"
 #include "simple_func.h"
 #include "aln_sink.h"
+#include "pe.h"
 
 /**
  * Concrete subclass of DescentRootSelector.  Puts a root every 'ival' chars,
@@ -223,8 +224,10 @@ public:
 		bool norc,
 		TAlScore minsc,
 		TAlScore maxpen,
-		const Read* q2)
+		const Read* q2,
+		bool q1IsMate1 = true) // false -> q1 is mate 2 of a pair
 	{
+		q1IsMate1_ = q1IsMate1;
 		// Initialize search for mate 1.  This includes instantiating and
 		// prioritizing all the search roots.
 		dr1_.initRead(q1, nofw, norc, minsc, maxpen, q2, sel_);
@@ -242,13 +245,18 @@ public:
 		// Initialize stopping conditions.  We use two conditions:
 		// totsz: when memory footprint exceeds this many bytes
 		// totfmops: when we've exceeded this many FM Index ops
-		size_t totsz = totsz_.f<size_t>(q1.length());
-		size_t totfmops = totfmops_.f<size_t>(q1.length());
 		stop_.init(
-			totsz,
+			totsz_.f<size_t>(q1.length()),
 			0,
 			true,
-			totfmops);
+			totfmops_.f<size_t>(q1.length()));
+		if(q2 != NULL) {
+			stop2_.init(
+				totsz_.f<size_t>(q2->length()),
+				0,
+				true,
+				totfmops_.f<size_t>(q2->length()));
+		}
 	}
 	
 	/**
@@ -269,7 +277,8 @@ public:
 		WalkMetrics& wlm,
 		PerReadMetrics& prm,
 		RandomSource& rnd,
-		AlnSinkWrap& sink);
+		AlnSinkWrap& sink,
+		const PairedEndPolicy* pepol = NULL);
 	
 	/**
 	 * Reset state of all DescentDrivers.
@@ -286,12 +295,49 @@ public:
 
 protected:
 
+	/**
+	 * Run the best-first search for one mate until it is exhausted or its
+	 * memory or FM-index-op budget runs out, reporting each completed
+	 * stratum of alignments as unpaired alignments for that mate.
+	 */
+	int goMate(
+		DescentDriver& dr,
+		RedundantAlns& red,
+		const DescentStoppingConditions& stopc,
+		bool mate1,
+		const Scoring& sc,
+		const Ebwt& ebwtFw,
+		const Ebwt& ebwtBw,
+		const BitPairReference& ref,
+		DescentMetrics& met,
+		WalkMetrics& wlm,
+		PerReadMetrics& prm,
+		RandomSource& rnd,
+		AlnSinkWrap& sink);
+
+	/**
+	 * Report all the alignments in the driver's current stratum.  Return
+	 * true iff the reporting policy has been fulfilled.
+	 */
+	bool reportStratum(
+		DescentDriver& dr,
+		RedundantAlns& red,
+		bool mate1,
+		const Ebwt& ebwtFw,
+		const BitPairReference& ref,
+		WalkMetrics& wlm,
+		PerReadMetrics& prm,
+		RandomSource& rnd,
+		AlnSinkWrap& sink);
+
 	DescentRootSelector *sel_;        // selects where roots should go
 	DescentAlignmentSelector alsel_;  // one selector can deal with >1 drivers
 	DescentDriver dr1_;               // driver for mate 1/unpaired reads
 	DescentDriver dr2_;               // driver for paired-end reads
-	DescentStoppingConditions stop_;  // when to pause index-assisted BFS
+	DescentStoppingConditions stop_;  // when to stop BFS for dr1_
+	DescentStoppingConditions stop2_; // when to stop BFS for dr2_
 	bool paired_;                     // current read is paired?
+	bool q1IsMate1_;                  // dr1_ is aligning mate 1?
 
 	SimpleFunc totsz_;      // memory limit on best-first search data
 	SimpleFunc totfmops_;   // max # FM ops for best-first search
@@ -300,6 +346,8 @@ protected:
 	RedundantAlns  red1_;   // database of cells used for mate 1 alignments
 	RedundantAlns  red2_;   // database of cells used for mate 2 alignments
 
+	EList<AlnRes>  mateAls_[2]; // unpaired alignments reported for each mate
+
 	// For AlnRes::matchesRef
 	ASSERT_ONLY(SStringExpandable<char> raw_refbuf_);
 	ASSERT_ONLY(SStringExpandable<uint32_t> raw_destU32_);
@@ -566,6 +566,31 @@ void StackedAln::init(
 	trimRS_ = trimRS;
 	trimRH_ = trimRH;
 	ASSERT_ONLY(size_t ln_postsoft = s.length() - trimLS - trimRS);
+	ungapped_ = true;
+	for(size_t i = 0; i < ed.size(); i++) {
+		if(ed[i].isGap()) {
+			ungapped_ = false;
+			break;
+		}
+	}
+	if(ungapped_) {
+		// Nothing to left-align, so the mismatches are all we need
+		alnlen_ = s.length() - trimLS - trimRS;
+		mms_.clear();
+		for(size_t i = 0; i < ed.size(); i++) {
+			assert_lt(ed[i].pos, ln_postsoft);
+			if(ed[i].isMismatch()) {
+				assert(mms_.empty() || ed[i].pos > mms_.back().pos);
+				mms_.push_back(ed[i]);
+			}
+		}
+		inited_ = true;
+#ifdef NDEBUG
+		return;
+#endif
+		// Debug builds stack the columns anyway, so that writeCigar() and
+		// writeMdz() can check the ungapped output against the stacked one
+	}
 	stackRef_.clear();
 	stackRel_.clear();
 	stackRead_.clear();
@@ -628,6 +653,9 @@ void StackedAln::init(
  */
 void StackedAln::leftAlign(bool pastMms) {
 	assert(inited_);
+	if(ungapped_) {
+		return; // no gaps to move
+	}
 	bool changed = false;
 	size_t ln = stackRef_.size();
 	// Scan left-to-right
@@ -679,6 +707,14 @@ bool StackedAln::buildCigar(bool xeq) {
 	if(cigCalc_) {
 		return false; // already done
 	}
+	cigDistMm_ = xeq;
+	if(ungapped_) {
+		// writeCigar() works from the mismatches directly
+		cigCalc_ = true;
+#ifdef NDEBUG
+		return true;
+#endif
+	}
 	cigOp_.clear();
 	cigRun_.clear();
 	if(trimLS_ > 0) {
@@ -722,6 +758,13 @@ bool StackedAln::buildMdz() {
 	if(mdzCalc_) {
 		return false; // already done
 	}
+	if(ungapped_) {
+		// writeMdz() works from the mismatches directly
+		mdzCalc_ = true;
+#ifdef NDEBUG
+		return true;
+#endif
+	}
 	mdzOp_.clear();
 	mdzChr_.clear();
 	mdzRun_.clear();
@@ -769,6 +812,23 @@ void StackedAln::writeCigar(
 	BTString* o,      // if non-NULL, string to append to
 	char* occ) const  // if non-NULL, character string to append to
 {
+	if(ungapped_) {
+		writeCigarUngapped(o, occ);
+#ifndef NDEBUG
+		BTString fast, stacked;
+		writeCigarUngapped(&fast, NULL);
+		writeCigarStacked(&stacked, NULL);
+		assert(fast == stacked);
+#endif
+		return;
+	}
+	writeCigarStacked(o, occ);
+}
+
+/**
+ * Write the CIGAR string from the op/run lists built from the stacks.
+ */
+void StackedAln::writeCigarStacked(BTString* o, char* occ) const {
 	const EList<char>& op = cigOp_;
 	const EList<size_t>& run = cigRun_;
 	assert_eq(op.size(), run.size());
@@ -803,6 +863,23 @@ void StackedAln::writeCigar(
  * char buffer.
  */
 void StackedAln::writeMdz(BTString* o, char* occ) const {
+	if(ungapped_) {
+		writeMdzUngapped(o, occ);
+#ifndef NDEBUG
+		BTString fast, stacked;
+		writeMdzUngapped(&fast, NULL);
+		writeMdzStacked(&stacked, NULL);
+		assert(fast == stacked);
+#endif
+		return;
+	}
+	writeMdzStacked(o, occ);
+}
+
+/**
+ * Write the MD:Z string from the op/char/run lists built from the stacks.
+ */
+void StackedAln::writeMdzStacked(BTString* o, char* occ) const {
 	char buf[128];
 	bool mm_last = false;
 	bool rdgap_last = false;
@@ -872,6 +949,90 @@ void StackedAln::writeMdz(BTString* o, char* occ) const {
 	if(occ != NULL) { *occ = '\0'; }
 }
 
+/**
+ * Append a run length, followed by op if op isn't '\0', to the given string
+ * and/or char buffer.  Returns the advanced char buffer pointer.
+ */
+static inline char* appendRun(BTString* o, char* occ, size_t r, char op) {
+	char buf[128];
+	itoa10<size_t>(r, buf);
+	if(o != NULL) {
+		o->append(buf);
+		if(op != '\0') o->append(op);
+	}
+	if(occ != NULL) {
+		COPY_BUF();
+		if(op != '\0') {
+			*occ = op;
+			occ++;
+		}
+	}
+	return occ;
+}
+
+/**
+ * Write the CIGAR string of an ungapped alignment, taking the runs of
+ * matches and mismatches straight from mms_.
+ */
+void StackedAln::writeCigarUngapped(BTString* o, char* occ) const {
+	assert(ungapped_);
+	assert(cigCalc_);
+	if(o == NULL && occ == NULL) {
+		return;
+	}
+	if(trimLS_ > 0) {
+		occ = appendRun(o, occ, trimLS_, 'S');
+	}
+	if(!cigDistMm_) {
+		occ = appendRun(o, occ, alnlen_, 'M');
+	} else {
+		size_t rdoff = 0;
+		for(size_t i = 0; i < mms_.size(); ) {
+			size_t pos = mms_[i].pos;
+			if(pos > rdoff) {
+				occ = appendRun(o, occ, pos - rdoff, '=');
+			}
+			// Adjacent mismatches form one X run
+			size_t run = 1;
+			while(i + run < mms_.size() && mms_[i + run].pos == pos + run) {
+				run++;
+			}
+			occ = appendRun(o, occ, run, 'X');
+			rdoff = pos + run;
+			i += run;
+		}
+		if(alnlen_ > rdoff) {
+			occ = appendRun(o, occ, alnlen_ - rdoff, '=');
+		}
+	}
+	if(trimRS_ > 0) {
+		occ = appendRun(o, occ, trimRS_, 'S');
+	}
+	if(occ != NULL) {
+		*occ = '\0';
+	}
+}
+
+/**
+ * Write the MD:Z string of an ungapped alignment, taking the match runs
+ * and mismatched reference characters straight from mms_.
+ */
+void StackedAln::writeMdzUngapped(BTString* o, char* occ) const {
+	assert(ungapped_);
+	assert(mdzCalc_);
+	size_t rdoff = 0;
+	for(size_t i = 0; i < mms_.size(); i++) {
+		// A zero-length run is written before a leading mismatch and
+		// between adjacent ones
+		occ = appendRun(o, occ, mms_[i].pos - rdoff, (char)mms_[i].chr);
+		rdoff = mms_[i].pos + 1;
+	}
+	occ = appendRun(o, occ, alnlen_ - rdoff, '\0');
+	if(occ != NULL) {
+		*occ = '\0';
+	}
+}
+
 /**
  * Print the sequence for the read that aligned using A, C, G and
  * T.  This will simply print the read sequence (or its reverse
@@ -924,10 +1085,13 @@ void AlnRes::printQuals(
 }
 
 /**
- * Add all of the cells involved in the given alignment to the database.
+ * Set tmp_ to the runs of cells making up the given alignment, in order of
+ * read row.
  */
-void RedundantAlns::add(const AlnRes& res) {
-	assert(!cells_.empty());
+void RedundantAlns::runs(const AlnRes& res) {
+	assert_gt(npos_, 0);
+	tmp_.clear();
+	ASSERT_ONLY(tmpCells_.clear());
 	TRefOff left = res.refoff(), right;
 	const size_t len = res.readExtentRows();
 	const size_t alignmentStart = res.trimmedLeft(true);
@@ -936,7 +1100,7 @@ void RedundantAlns::add(const AlnRes& res) {
 	}
 	const EList<Edit>& ned = res.ned();
 	size_t nedidx = 0;
-	assert_leq(len, cells_.size());
+	assert_leq(len, npos_);
 	// For each row...
 	for(size_t i = alignmentStart; i < alignmentStart + len; i++) {
 		size_t diff = 1;  // amount to shift to right for next round
@@ -960,17 +1124,70 @@ void RedundantAlns::add(const AlnRes& res) {
 				nedidx_next++;
 			}
 		}
-		for(TRefOff j = left; j < right; j++) {
-			// Add to db
-			RedundantCell c(res.refid(), res.fw(), j, i);
-			ASSERT_ONLY(bool ret =) cells_[i].insert(c);
-			assert(ret);
+		// Row i covers columns [left, right); extend the current run if
+		// it covers the same diagonals in the row above
+		const int64_t dglo = (int64_t)left - (int64_t)i;
+		const int64_t dghi = (int64_t)right - (int64_t)i;
+#ifndef NDEBUG
+		// Note the row's cells one by one too, for overlap() to check with
+		for(int64_t dg = dglo; dg < dghi; dg++) {
+			tmpCells_.expand();
+			RedundantRun& c = tmpCells_.back();
+			c.rfid = res.refid();
+			c.fw = res.fw();
+			c.dglo = dg;
+			c.dghi = dg + 1;
+			c.rdlo = i;
+			c.rdhi = i + 1;
+		}
+#endif
+		if(!tmp_.empty() && tmp_.back().rdhi == i &&
+		   tmp_.back().dglo == dglo && tmp_.back().dghi == dghi)
+		{
+			tmp_.back().rdhi++;
+		} else {
+			tmp_.expand();
+			RedundantRun& r = tmp_.back();
+			r.rfid = res.refid();
+			r.fw = res.fw();
+			r.dglo = dglo;
+			r.dghi = dghi;
+			r.rdlo = i;
+			r.rdhi = i + 1;
 		}
 		left = right + diff - 1;
 	}
 	if(!res.fw()) {
 		const_cast<AlnRes&>(res).invertEdits();
 	}
+#ifndef NDEBUG
+	size_t ncells = 0;
+	for(size_t i = 0; i < tmp_.size(); i++) {
+		ncells += (size_t)(tmp_[i].dghi - tmp_[i].dglo) *
+		          (tmp_[i].rdhi - tmp_[i].rdlo);
+	}
+	assert_eq(tmpCells_.size(), ncells);
+#endif
+}
+
+/**
+ * Add all of the cells involved in the given alignment to the database.
+ */
+void RedundantAlns::add(const AlnRes& res) {
+	runs(res);
+	for(size_t i = 0; i < tmp_.size(); i++) {
+		const RedundantRun& r = tmp_[i];
+		assert(!overlapsAny(r));
+		runs_.insert(r, runs_.bsearchLoBound(r));
+		if(r.dghi - r.dglo > maxWidth_) {
+			maxWidth_ = r.dghi - r.dglo;
+		}
+	}
+#ifndef NDEBUG
+	for(size_t i = 0; i < tmpCells_.size(); i++) {
+		cells_.insert(tmpCells_[i]);
+	}
+#endif
 }
 
 /**
@@ -978,57 +1195,47 @@ void RedundantAlns::add(const AlnRes& res) {
  * one of the cells in the database.
  */
 bool RedundantAlns::overlap(const AlnRes& res) {
-	assert(!cells_.empty());
-	TRefOff left = res.refoff(), right;
-	const size_t len = res.readExtentRows();
-	const size_t alignmentStart = res.trimmedLeft(true);
-	if(!res.fw()) {
-		const_cast<AlnRes&>(res).invertEdits();
-	}
-	const EList<Edit>& ned = res.ned();
-	size_t nedidx = 0;
-	// For each row...
-	bool olap = false;
-	assert_leq(len, cells_.size());
-	for(size_t i = alignmentStart; i < alignmentStart + len; i++) {
-		size_t diff = 1;  // amount to shift to right for next round
-		right = left + 1;
-		while(nedidx < ned.size() && ned[nedidx].pos == i) {
-			if(ned[nedidx].isRefGap()) {
-				// Next my_left will be in same column as this round
-				diff = 0;
-			}
-			nedidx++;
-		}
-		if(i < alignmentStart + len - 1) {
-			// See how many inserts there are before the next read
-			// character
-			size_t nedidx_next = nedidx;
-			while(nedidx_next < ned.size() && ned[nedidx_next].pos == i+1)
-			{
-				if(ned[nedidx_next].isReadGap()) {
-					right++;
-				}
-				nedidx_next++;
-			}
-		}
-		for(TRefOff j = left; j < right; j++) {
-			// Add to db
-			RedundantCell c(res.refid(), res.fw(), j, i);
-			if(cells_[i].contains(c)) {
-				olap = true;
-				break;
-			}
+	runs(res);
+	bool ret = false;
+	for(size_t i = 0; i < tmp_.size(); i++) {
+		if(overlapsAny(tmp_[i])) {
+			ret = true;
+			break;
 		}
-		if(olap) {
+	}
+#ifndef NDEBUG
+	// Same answer as checking the alignment's cells one by one
+	bool cellRet = false;
+	for(size_t i = 0; i < tmpCells_.size(); i++) {
+		if(cells_.contains(tmpCells_[i])) {
+			cellRet = true;
 			break;
 		}
-		left = right + diff - 1;
 	}
-	if(!res.fw()) {
-		const_cast<AlnRes&>(res).invertEdits();
+	assert_eq(cellRet, ret);
+#endif
+	return ret;
+}
+
+/**
+ * Return true iff the given run has a cell in common with a run in the
+ * database.  Only runs starting within maxWidth_ diagonals to the left of
+ * it can reach it, and those are adjacent in the sorted list.
+ */
+bool RedundantAlns::overlapsAny(const RedundantRun& q) const {
+	RedundantRun key = q;
+	key.dglo = q.dglo - maxWidth_ + 1;
+	key.rdlo = 0;
+	for(size_t j = runs_.bsearchLoBound(key); j < runs_.size(); j++) {
+		const RedundantRun& r = runs_[j];
+		if(r.rfid != q.rfid || r.fw != q.fw || r.dglo >= q.dghi) {
+			break;
+		}
+		if(r.overlaps(q)) {
+			return true;
+		}
 	}
-	return olap;
+	return false;
 }
 
 /**
@@ -1098,6 +1305,7 @@ bool AlnFlags::printYF(BTString& o, bool first) const {
 	else if(!nfilt_  ) flag = "NS";
 	else if(!scfilt_ ) flag = "SC";
 	else if(!qcfilt_ ) flag = "QC";
+	else if(!lcfilt_ ) flag = "LC";
 	if(flag[0] != '\0') {
 		if(!first) o.append('\t');
 		o.append("YF:Z:");
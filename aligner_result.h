@@ -292,6 +292,7 @@ public:
 			false,  // scfilt
 			false,  // lenfilt
 			false,  // qcfilt
+			false,  // lcfilt
 			false,  // mixedMode
 			false,  // primary
 			false,  // oppAligned
@@ -309,6 +310,7 @@ public:
 		bool scfilt,
 		bool lenfilt,
 		bool qcfilt,
+		bool lcfilt,
 		bool mixedMode,
 		bool primary,
 		bool oppAligned, // opposite mate aligned?
@@ -317,7 +319,7 @@ public:
 		bool xeq)
 	{
 		init(pairing, canMax, maxed, maxedPair, nfilt, scfilt,
-			 lenfilt, qcfilt, mixedMode, primary, oppAligned,
+			 lenfilt, qcfilt, lcfilt, mixedMode, primary, oppAligned,
 			 oppFw, scUnMapped, xeq);
 	}
 
@@ -333,6 +335,7 @@ public:
 		bool scfilt,
 		bool lenfilt,
 		bool qcfilt,
+		bool lcfilt,
 		bool mixedMode,
 		bool primary,
 		bool oppAligned,
@@ -350,6 +353,7 @@ public:
 		scfilt_     = scfilt;
 		lenfilt_    = lenfilt;
 		qcfilt_     = qcfilt;
+		lcfilt_     = lcfilt;
 		mixedMode_  = mixedMode;
 		primary_    = primary;
 		oppAligned_ = oppAligned;
@@ -438,7 +442,7 @@ public:
 	 * Return true iff the alignment was filtered out.
 	 */
 	bool filtered() const {
-		return !nfilt_ || !scfilt_ || !lenfilt_ || !qcfilt_;
+		return !nfilt_ || !scfilt_ || !lenfilt_ || !qcfilt_ || !lcfilt_;
 	}
 	
 	/**
@@ -537,6 +541,7 @@ protected:
 	bool scfilt_;  // read/mate filtered b/c length can't provide min score
 	bool lenfilt_; // read/mate filtered b/c less than or equal to seed mms
 	bool qcfilt_;  // read/mate filtered by upstream qc
+	bool lcfilt_;  // read/mate filtered b/c low complexity (--dust)
 	
 	// Whether both paired and unpaired alignments are considered for pairs &
 	// their constituent mates
@@ -632,7 +637,8 @@ public:
 		cigRun_(RES_CAT),
 		mdzOp_(RES_CAT),
 		mdzChr_(RES_CAT),
-		mdzRun_(RES_CAT)
+		mdzRun_(RES_CAT),
+		mms_(RES_CAT)
 	{
 		reset();
 	}
@@ -653,6 +659,9 @@ public:
 		mdzOp_.clear();
 		mdzChr_.clear();
 		mdzRun_.clear();
+		ungapped_ = false;
+		alnlen_ = 0;
+		mms_.clear();
 	}
 	
 	/**
@@ -671,6 +680,12 @@ public:
 	 * trimLH: # bases hard-trimmed from LHS
 	 * trimRS: # bases soft-trimmed from RHS
 	 * trimRH: # bases hard-trimmed from RHS
+	 *
+	 * If the alignment has no gaps, only the mismatches are kept, and the
+	 * CIGAR and MD:Z strings are later written straight from them (debug
+	 * builds stack the columns too and check that the two agree).
+	 * Otherwise the read and reference are stacked column by column so
+	 * that gaps can be left-aligned.
 	 */
 	void init(
 		const BTDnaString& s,
@@ -736,6 +751,14 @@ public:
 
 protected:
 
+	void writeCigarUngapped(BTString* o, char* occ) const;
+
+	void writeMdzUngapped(BTString* o, char* occ) const;
+
+	void writeCigarStacked(BTString* o, char* occ) const;
+
+	void writeMdzStacked(BTString* o, char* occ) const;
+
 	bool          inited_;    // true iff stacked alignment is initialized
 
 	size_t        trimLS_;    // amount soft-trimmed from the LHS
@@ -756,6 +779,10 @@ protected:
 	EList<char>   mdzOp_;     // MD:Z operations
 	EList<char>   mdzChr_;    // MD:Z operations
 	EList<size_t> mdzRun_;    // MD:Z run lengths
+
+	bool          ungapped_;  // no gaps; stacks above only kept to check
+	size_t        alnlen_;    // # read chars aligned, if ungapped_
+	EList<Edit>   mms_;       // mismatches, left to right, if ungapped_
 };
 
 /**
@@ -1401,6 +1428,16 @@ public:
 		return fw() ? trimmed3p(soft) : trimmed5p(soft);
 	}
 
+	/**
+	 * Shift the reference id by the given amount, e.g. to number references
+	 * consecutively across several indexes.
+	 */
+	void adjustRefId(TRefId off) {
+		refcoord_.setRef(refcoord_.ref() + off);
+		refival_.setUpstream(Coord(
+			refival_.ref() + off, refival_.off(), refival_.orient() == 1));
+	}
+
 	/**
 	 * Set the number of reference Ns covered by the alignment.
 	 */
@@ -1551,82 +1588,62 @@ protected:
 };
 
 /**
- * Unique ID for a cell in the overall DP table.  This is a helpful concept
+ * A run of cells in the overall DP table.  This is a helpful concept
  * because of our definition of "redundnant".  Two alignments are redundant iff
  * they have at least one cell in common in the overall DP table.
+ *
+ * Rather than by reference column, cells are identified here by diagonal
+ * (column minus row), since an alignment stays on one diagonal between
+ * gaps.  A run covers read rows [rdlo, rdhi) and, in each of those rows,
+ * the cells on diagonals [dglo, dghi).  An ungapped stretch of an alignment
+ * is a run one diagonal wide; a row with a read gap is a run one row tall.
  */
-struct RedundantCell {
-	
-	RedundantCell() {
+struct RedundantRun {
+
+	RedundantRun() {
 		rfid = 0;
 		fw = true;
-		rfoff = 0;
-		rdoff = 0;
+		dglo = dghi = 0;
+		rdlo = rdhi = 0;
 	}
-	
-	RedundantCell(
-		TRefId  rfid_,
-		bool    fw_,
-		TRefOff rfoff_,
-		size_t  rdoff_)
-	{
-		init(rfid_, fw_, rfoff_, rdoff_);
-	}
-	
-	void init(
-		TRefId  rfid_,
-		bool    fw_,
-		TRefOff rfoff_,
-		size_t  rdoff_)
-	{
-		rfid  = rfid_;
-		fw    = fw_;
-		rfoff = rfoff_;
-		rdoff = rdoff_;
-	}
-	
+
 	/**
-	 * Return true iff this RedundantCell is less than the given RedundantCell.
+	 * Return true iff this run comes before the given run when runs are
+	 * sorted by reference, strand, lowest diagonal and first row.
 	 */
-	inline bool operator<(const RedundantCell& c) const {
-		if(rfid  <  c.rfid) return true;
-		if(rfid  >  c.rfid) return false;
-		if(!fw   &&   c.fw) return true;
-		if( fw   &&  !c.fw) return false;
-		if(rfoff < c.rfoff) return true;
-		if(rfoff > c.rfoff) return false;
-		return rdoff < c.rdoff;
+	inline bool operator<(const RedundantRun& c) const {
+		if(rfid != c.rfid) return rfid < c.rfid;
+		if(fw   != c.fw)   return !fw;
+		if(dglo != c.dglo) return dglo < c.dglo;
+		return rdlo < c.rdlo;
 	}
 
 	/**
-	 * Return true iff this RedundantCell is greater than the given
-	 * RedundantCell.
+	 * Return true iff this run is identical to the given run.
 	 */
-	inline bool operator>(const RedundantCell& c) const {
-		if(rfid  >  c.rfid) return true;
-		if(rfid  <  c.rfid) return false;
-		if( fw   &&  !c.fw) return true;
-		if(!fw   &&   c.fw) return false;
-		if(rfoff > c.rfoff) return true;
-		if(rfoff < c.rfoff) return false;
-		return rdoff > c.rdoff;
+	inline bool operator==(const RedundantRun& c) const {
+		return
+			rfid == c.rfid && fw   == c.fw   &&
+			dglo == c.dglo && dghi == c.dghi &&
+			rdlo == c.rdlo && rdhi == c.rdhi;
 	}
 
 	/**
-	 * Return true iff this RedundantCell is equal to the given RedundantCell.
+	 * Return true iff this run and the given run have a cell in common.
 	 */
-	inline bool operator==(const RedundantCell& c) const {
+	inline bool overlaps(const RedundantRun& c) const {
 		return
-			rfid  == c.rfid  &&
-			fw    == c.fw    &&
-			rfoff == c.rfoff &&
-			rdoff == c.rdoff;
+			rfid == c.rfid && fw == c.fw &&
+			dglo < c.dghi && c.dglo < dghi &&
+			rdlo < c.rdhi && c.rdlo < rdhi;
 	}
 
-	TRefId  rfid;  // reference id
-	bool    fw;    // orientation
-	TRefOff rfoff; // column
-	size_t  rdoff; // row
+	TRefId  rfid; // reference id
+	bool    fw;   // orientation
+	int64_t dglo; // first diagonal
+	int64_t dghi; // last diagonal + 1
+	size_t  rdlo; // first row
+	size_t  rdhi; // last row + 1
 };
 
 /**
@@ -1634,29 +1651,37 @@ struct RedundantCell {
  * whether one alignment is redundant (has a DP cell in common with) with a set
  * of others.
  *
- * Adding cells to and checking cell against this data structure can get rather
- * slow when there are many alignments in play.  Dividing the burden over
- * read-position bins helps some.
+ * Each alignment is stored as a handful of runs of cells, one per stretch
+ * between gaps, kept sorted so that only runs on nearby diagonals need to
+ * be compared against a new alignment.  Debug builds also keep every cell
+ * individually and check each answer against them.
  */
 class RedundantAlns {
 
 public:
 
-	RedundantAlns(int cat = DP_CAT) : cells_(cat) { }
+	RedundantAlns(int cat = DP_CAT) :
+		runs_(cat),
+		tmp_(cat),
+		maxWidth_(1),
+		npos_(0) { }
 
 	/**
 	 * Empty the cell database.
 	 */
-	void reset() { cells_.clear(); }
+	void reset() {
+		runs_.clear();
+		maxWidth_ = 1;
+		npos_ = 0;
+		ASSERT_ONLY(cells_.clear());
+	}
 	
 	/**
-	 * Initialize and set the list of sets to equal the read length.
+	 * Empty the database and note the read length.
 	 */
 	void init(size_t npos) {
-		cells_.resize(npos);
-		for(size_t i = 0; i < npos; i++) {
-			cells_[i].clear();
-		}
+		reset();
+		npos_ = npos;
 	}
 
 	/**
@@ -1672,7 +1697,22 @@ public:
 
 protected:
 
-	EList<ESet<RedundantCell> > cells_;
+	/**
+	 * Set tmp_ to the runs of cells making up the given alignment.
+	 */
+	void runs(const AlnRes& res);
+
+	/**
+	 * Return true iff the given run overlaps a run in the database.
+	 */
+	bool overlapsAny(const RedundantRun& q) const;
+
+	EList<RedundantRun> runs_;     // runs of all alignments added, sorted
+	EList<RedundantRun> tmp_;      // runs of the alignment being considered
+	int64_t             maxWidth_; // widest run in runs_, in diagonals
+	size_t              npos_;     // read length
+	ASSERT_ONLY(ESet<RedundantRun>  cells_);    // all cells added, one per run
+	ASSERT_ONLY(EList<RedundantRun> tmpCells_); // cells of the alignment being considered
 };
 
 typedef uint64_t TNumAlns;
@@ -364,6 +364,87 @@ SeedAligner::instantiateSeq(
 	}
 }
 
+/**
+ * Scramble the bits of a packed k-mer so that minimizers are not biased
+ * toward A-rich k-mers.  Uses the 64-bit finalizer from MurmurHash3.
+ */
+static inline uint64_t mixKmer(uint64_t x) {
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return x;
+}
+
+/**
+ * Fill in offIdx2off_ with the offsets of the (win, len) minimizers of the
+ * read, considering only offsets >= off.  Each k-mer is ranked by a hash of
+ * the smaller of its forward and reverse-complement encodings, since the
+ * same read window is used to instantiate both the fw and rc seeds.
+ * K-mers containing Ns rank last.  Within each window of win consecutive
+ * offsets, the lowest-ranked offset is selected (leftmost on ties) and
+ * duplicates from overlapping windows are removed.
+ */
+void SeedAligner::selectMinimizers(
+	const Read& read, // read to select seed offsets from
+	size_t off,       // first eligible offset
+	int len,          // seed length
+	int win)          // # consecutive offsets per window
+{
+	assert_gt(win, 0);
+	assert_leq(len, 32);
+	offIdx2off_.clear();
+	minHash_.clear();
+	const int rdlen = (int)read.length();
+	if(rdlen - (int)off <= len) {
+		// Only room for one seed
+		offIdx2off_.push_back((uint32_t)off);
+		return;
+	}
+	const int nk = rdlen - len + 1; // # k-mer offsets in read
+	const uint64_t mask = (len == 32) ? ~(uint64_t)0 : (((uint64_t)1 << (2*len)) - 1);
+	const uint64_t salt = mixKmer((uint64_t)off + 1);
+	uint64_t kfw = 0, krc = 0;
+	int lastn = -1; // offset of most recent N
+	for(int i = 0; i < rdlen; i++) {
+		int c = read.patFw[i];
+		if(c > 3) {
+			lastn = i;
+			c = 0;
+		}
+		kfw = ((kfw << 2) | (uint64_t)c) & mask;
+		krc = (krc >> 2) | ((uint64_t)(3 - c) << (2*(len-1)));
+		int kmoff = i - len + 1;
+		if(kmoff < (int)off) {
+			continue;
+		}
+		if(lastn >= kmoff) {
+			minHash_.push_back(MAX_U64);
+		} else {
+			minHash_.push_back(mixKmer(min(kfw, krc) ^ salt));
+		}
+	}
+	const int nk_off = nk - (int)off;
+	assert_eq(nk_off, (int)minHash_.size());
+	if(win > nk_off) {
+		win = nk_off;
+	}
+	for(int s = 0; s + win <= nk_off; s++) {
+		int best = s;
+		for(int j = s + 1; j < s + win; j++) {
+			if(minHash_[j] < minHash_[best]) {
+				best = j;
+			}
+		}
+		uint32_t boff = (uint32_t)(best + off);
+		if(offIdx2off_.empty() || offIdx2off_.back() != boff) {
+			offIdx2off_.push_back(boff);
+		}
+	}
+	assert(!offIdx2off_.empty());
+}
+
 /**
  * We assume that all seeds are the same length.
  *
@@ -373,6 +454,7 @@ pair<int, int> SeedAligner::instantiateSeeds(
 	const EList<Seed>& seeds,  // search seeds
 	size_t off,                // offset into read to start extracting
 	int per,                   // interval between seeds
+	int win,                   // minimizer window; 0 = fixed interval
 	const Read& read,          // read to align
 	const Scoring& pens,       // scoring scheme
 	bool nofw,                 // don't align forward read
@@ -381,7 +463,8 @@ pair<int, int> SeedAligner::instantiateSeeds(
 	SeedResults& sr,           // holds all the seed hits
 	SeedSearchMetrics& met,    // metrics
 	pair<int, int>& instFw,
-	pair<int, int>& instRc)
+	pair<int, int>& instRc,
+	const RepeatKmers* rep)    // repeat k-mers to mask, or NULL
 {
 	assert(!seeds.empty());
 	assert_gt(read.length(), 0);
@@ -393,13 +476,19 @@ pair<int, int> SeedAligner::instantiateSeeds(
 		assert_eq(len, seeds[i].len);
 	}
 #endif
-	// Calc # seeds within read interval
 	int nseeds = 1;
-	if((int)read.length() - (int)off > len) {
-		nseeds += ((int)read.length() - (int)off - len) / per;
-	}
-	for(int i = 0; i < nseeds; i++) {
-		offIdx2off_.push_back(per * i + (int)off);
+	if(win > 0) {
+		// Choose seed offsets by minimizer
+		selectMinimizers(read, off, len, win);
+		nseeds = (int)offIdx2off_.size();
+	} else {
+		// Calc # seeds within read interval
+		if((int)read.length() - (int)off > len) {
+			nseeds += ((int)read.length() - (int)off - len) / per;
+		}
+		for(int i = 0; i < nseeds; i++) {
+			offIdx2off_.push_back(per * i + (int)off);
+		}
 	}
 	pair<int, int> ret;
 	ret.first = 0;  // # seeds that require alignment
@@ -415,8 +504,6 @@ pair<int, int> SeedAligner::instantiateSeeds(
 		}
 		// For each seed position
 		for(int i = 0; i < nseeds; i++) {
-			int depth = i * per + (int)off;
-			int seedlen = seeds[0].len;
 			// Extract the seed sequence at this offset
 			// If fw == true, we extract the characters from i*per to
 			// i*(per-1) (exclusive).  If fw == false, 
@@ -424,9 +511,46 @@ pair<int, int> SeedAligner::instantiateSeeds(
 				read,
 				sr.seqs(fw)[i],
 				sr.quals(fw)[i],
-				std::min<int>((int)seedlen, (int)read.length()),
-				depth,
+				std::min<int>((int)seeds[0].len, (int)read.length()),
+				(int)offIdx2off_[i],
 				fw);
+		}
+	}
+	// Mask seeds lying entirely within over-represented reference
+	// k-mers, unless that would leave the read with no seeds at all
+	repMasked_.resize(2 * nseeds);
+	repMasked_.fill(false);
+	if(rep != NULL && !rep->empty()) {
+		int nunmasked = 0;
+		for(int fwi = 0; fwi < 2; fwi++) {
+			bool fw = (fwi == 0);
+			if((fw && nofw) || (!fw && norc)) {
+				continue;
+			}
+			for(int i = 0; i < nseeds; i++) {
+				if(rep->seqCount(sr.seqs(fw)[i]) > 0) {
+					repMasked_[fwi * nseeds + i] = true;
+				} else {
+					nunmasked++;
+				}
+			}
+		}
+		if(nunmasked == 0) {
+			repMasked_.fill(false);
+		}
+	}
+	for(int fwi = 0; fwi < 2; fwi++) {
+		bool fw = (fwi == 0);
+		if((fw && nofw) || (!fw && norc)) {
+			continue;
+		}
+		for(int i = 0; i < nseeds; i++) {
+			if(repMasked_[fwi * nseeds + i]) {
+				met.repseed++;
+				continue;
+			}
+			int depth = (int)offIdx2off_[i];
+			ASSERT_ONLY(int seedlen = seeds[0].len);
 			QKey qk(sr.seqs(fw)[i] ASSERT_ONLY(, tmpdnastr_));
 			// For each search strategy
 			EList<InstantiatedSeed>& iss = sr.instantiatedSeeds(fw, i);
@@ -476,6 +600,7 @@ void SeedAligner::searchAllSeeds(
 	const Scoring& pens,         // scoring scheme
 	AlignmentCacheIface& cache,  // local cache for seed alignments
 	SeedResults& sr,             // holds all the seed hits
+	size_t maxelt,               // frequency cap; 0 = none
 	SeedSearchMetrics& met,      // metrics
 	PerReadMetrics& prm)         // per-read metrics
 {
@@ -489,6 +614,8 @@ void SeedAligner::searchAllSeeds(
 	read_ = &read;
 	ca_ = &cache;
 	bwops_ = bwedits_ = 0;
+	pendQv_.clear();
+	pendIdx_.clear();
 	uint64_t possearches = 0, seedsearches = 0, intrahits = 0, interhits = 0, ooms = 0;
 	// For each instantiated seed
 	for(int i = 0; i < (int)sr.numOffs(); i++) {
@@ -547,6 +674,12 @@ void SeedAligner::searchAllSeeds(
 			}
 			assert(abort || !cache.aligning());
 			if(qv.valid()) {
+				if(maxelt > 0) {
+					// Hold back until we know whether any seed is under the cap
+					pendQv_.push_back(qv);
+					pendIdx_.push_back(((uint32_t)i << 1) | (fw ? 1 : 0));
+					continue;
+				}
 				sr.add(
 					qv,    // range of ranges in cache
 					cache.current(), // cache
@@ -555,6 +688,28 @@ void SeedAligner::searchAllSeeds(
 			}
 		}
 	}
+	if(maxelt > 0) {
+		// Drop seeds that exceed the frequency cap, but only if doing so
+		// leaves at least one seed with hits
+		bool anyUnder = false;
+		for(size_t i = 0; i < pendQv_.size(); i++) {
+			if(!pendQv_[i].empty() && pendQv_[i].numElts() <= maxelt) {
+				anyUnder = true;
+				break;
+			}
+		}
+		for(size_t i = 0; i < pendQv_.size(); i++) {
+			if(anyUnder && pendQv_[i].numElts() > maxelt) {
+				met.cappedseed++;
+				continue;
+			}
+			sr.add(
+				pendQv_[i],                // range of ranges in cache
+				cache.current(),           // cache
+				pendIdx_[i] >> 1,          // seed index (from 5' end)
+				(pendIdx_[i] & 1) != 0);   // whether seed is from forward read
+		}
+	}
 	prm.nSeedRanges = sr.numRanges();
 	prm.nSeedElts = sr.numElts();
 	prm.nSeedRangesFw = sr.numRangesFw();
@@ -39,6 +39,7 @@
 #include "mem_ids.h"
 #include "simple_func.h"
 #include "btypes.h"
+#include "ref_repeats.h"
 
 /**
  * A constraint to apply to an alignment zone, or to an overall
@@ -1408,6 +1409,8 @@ struct SeedSearchMetrics {
 		intrahit     += m.intrahit;
 		interhit     += m.interhit;
 		filteredseed += m.filteredseed;
+		cappedseed   += m.cappedseed;
+		repseed      += m.repseed;
 		ooms         += m.ooms;
 		bwops        += m.bwops;
 		bweds        += m.bweds;
@@ -1427,6 +1430,8 @@ struct SeedSearchMetrics {
 		intrahit =
 		interhit =
 		filteredseed =
+		cappedseed =
+		repseed =
 		ooms =
 		bwops =
 		bweds =
@@ -1442,6 +1447,8 @@ struct SeedSearchMetrics {
 	uint64_t intrahit;     // # offsets where current-read cache gave answer
 	uint64_t interhit;     // # offsets where across-read cache gave answer
 	uint64_t filteredseed; // # seed instantiations skipped due to Ns
+	uint64_t cappedseed;   // # seeds dropped for exceeding frequency cap
+	uint64_t repseed;      // # seeds masked by the repeat k-mer table
 	uint64_t ooms;         // out-of-memory errors
 	uint64_t bwops;        // Burrows-Wheeler operations
 	uint64_t bweds;        // Burrows-Wheeler edits
@@ -1461,7 +1468,13 @@ public:
 	/**
 	 * Initialize with index.
 	 */
-	SeedAligner() : edits_(AL_CAT), offIdx2off_(AL_CAT) { }
+	SeedAligner() :
+		edits_(AL_CAT),
+		offIdx2off_(AL_CAT),
+		minHash_(AL_CAT),
+		pendQv_(AL_CAT),
+		pendIdx_(AL_CAT),
+		repMasked_(AL_CAT) { }
 
 	/**
 	 * Given a read and a few coordinates that describe a substring of the
@@ -1478,12 +1491,17 @@ public:
 
 	/**
 	 * Iterate through the seeds that cover the read and initiate a
-	 * search for each seed.
+	 * search for each seed.  If win > 0, seed offsets are chosen as
+	 * the (win, seed length) minimizers of the read rather than at
+	 * fixed intervals of per.  If rep is non-NULL, seeds made up entirely
+	 * of k-mers in the repeat table are skipped, provided some other seed
+	 * for the read is not.
 	 */
 	std::pair<int, int> instantiateSeeds(
 		const EList<Seed>& seeds,   // search seeds
 		size_t off,                 // offset into read to start extracting
 		int per,                    // interval between seeds
+		int win,                    // minimizer window; 0 = fixed interval
 		const Read& read,           // read to align
 		const Scoring& pens,        // scoring scheme
 		bool nofw,                  // don't align forward read
@@ -1492,11 +1510,14 @@ public:
 		SeedResults& sr,            // holds all the seed hits
 		SeedSearchMetrics& met,     // metrics
 		std::pair<int, int>& instFw,
-		std::pair<int, int>& instRc);
+		std::pair<int, int>& instRc,
+		const RepeatKmers* rep = NULL); // repeat k-mers to mask, or NULL
 
 	/**
 	 * Iterate through the seeds that cover the read and initiate a
-	 * search for each seed.
+	 * search for each seed.  If maxelt > 0, seeds with more than maxelt
+	 * elements are dropped, provided some other seed for the read has
+	 * between 1 and maxelt elements.
 	 */
 	void searchAllSeeds(
 		const EList<Seed>& seeds,   // search seeds
@@ -1506,6 +1527,7 @@ public:
 		const Scoring& pens,        // scoring scheme
 		AlignmentCacheIface& cache, // local seed alignment cache
 		SeedResults& hits,          // holds all the seed hits
+		size_t maxelt,              // frequency cap; 0 = none
 		SeedSearchMetrics& met,     // metrics
 		PerReadMetrics& prm);       // per-read metrics
 
@@ -1560,6 +1582,18 @@ public:
 
 protected:
 
+	/**
+	 * Fill in offIdx2off_ with the offsets of the (win, len) minimizers
+	 * of the read at or after offset off.  K-mers are ranked by a hash
+	 * of their canonical 2-bit encoding salted with off, so that
+	 * re-seeding rounds choose different offsets.
+	 */
+	void selectMinimizers(
+		const Read& read, // read to select seed offsets from
+		size_t off,       // first eligible offset
+		int len,          // seed length
+		int win);         // # consecutive offsets per window
+
 	/**
 	 * Report a seed hit found by searchSeedBi(), but first try to extend it out in
 	 * either direction as far as possible without hitting any edits.  This will
@@ -1640,6 +1674,10 @@ protected:
 	EList<Edit> edits_;        // temporary place to sort edits
 	AlignmentCacheIface *ca_;  // local alignment cache for seed alignments
 	EList<uint32_t> offIdx2off_;// offset idx to read offset map, set up instantiateSeeds()
+	EList<uint64_t> minHash_;  // per-offset k-mer ranks, set up by selectMinimizers()
+	EList<QVal>     pendQv_;   // seed hits held back until frequency cap applied
+	EList<uint32_t> pendIdx_;  // seed offset idx << 1 | fw for each of pendQv_
+	EList<bool>     repMasked_;// seeds masked as repeats, set up by instantiateSeeds()
 	uint64_t bwops_;           // Burrows-Wheeler operations
 	uint64_t bwedits_;         // Burrows-Wheeler edits
 	BTDnaString tmprfdnastr_;  // used in reportHit
@@ -444,13 +444,18 @@ struct DescentRedundancyKey {
 };
 
 /**
- * Map from pairs to top, bot, penalty triples.
+ * Set of DescentRedundancyKeys (plus orientation, direction and 5' offset)
+ * already explored for the current read.  Entries live in a single flat,
+ * open-addressed table that is allocated once and reused for every read:
+ * each slot is stamped with the generation of the read that filled it, so
+ * moving on to the next read is O(1) and never touches the allocator.  The
+ * table doubles (and rehashes) when it becomes more than half full.
  */
 class DescentRedundancyChecker {
 
 public:
 
-	DescentRedundancyChecker() { reset(); }
+	DescentRedundancyChecker() : slots_(MISC_CAT), gen_(0) { reset(); }
 
 	void clear() { reset(); }
 	
@@ -458,44 +463,22 @@ public:
 	 * Reset to uninitialized state.
 	 */
 	void reset() {
-		bits_.reset();
+		bumpGen();
+		nent_ = 0;
 		inited_ = false;
-		totsz_ = 0;  // total size
-		totcap_ = 0; // total capacity
 	}
 	
-	const static int NPARTS = 8;
-	const static int PART_MASK = 7;
-	const static int NBITS = (1 << 16);
+	const static size_t INIT_SLOTS = 1024;
 
 	/**
 	 * Initialize using given read length.
 	 */
 	void init(TReadOff rdlen) {
 		reset();
-		bits_.resize(NBITS);
-		maplist_fl_.resize(NPARTS);
-		maplist_fr_.resize(NPARTS);
-		maplist_rl_.resize(NPARTS);
-		maplist_rr_.resize(NPARTS);
-		for(int i = 0; i < NPARTS; i++) {
-			maplist_fl_[i].resize(rdlen);
-			maplist_fr_[i].resize(rdlen);
-			maplist_rl_[i].resize(rdlen);
-			maplist_rr_[i].resize(rdlen);
-			totcap_ += maplist_fl_[i].totalCapacityBytes();
-			totcap_ += maplist_fr_[i].totalCapacityBytes();
-			totcap_ += maplist_rl_[i].totalCapacityBytes();
-			totcap_ += maplist_rr_[i].totalCapacityBytes();
-			for(size_t j = 0; j < rdlen; j++) {
-				maplist_fl_[i][j].clear();
-				maplist_fr_[i][j].clear();
-				maplist_rl_[i][j].clear();
-				maplist_rr_[i][j].clear();
-				totcap_ += maplist_fl_[i][j].totalCapacityBytes();
-				totcap_ += maplist_fr_[i][j].totalCapacityBytes();
-				totcap_ += maplist_rl_[i][j].totalCapacityBytes();
-				totcap_ += maplist_rr_[i][j].totalCapacityBytes();
+		if(slots_.empty()) {
+			slots_.resize(INIT_SLOTS);
+			for(size_t i = 0; i < slots_.size(); i++) {
+				slots_[i].gen = 0;
 			}
 		}
 		inited_ = true;
@@ -510,7 +493,9 @@ public:
 
 	/**
 	 * Check if this partial alignment is redundant with one that we've already
-	 * explored.
+	 * explored.  If not, add it so that subsequent identical partial
+	 * alignments are recognized as redundant.  Return true iff it was not
+	 * already present.
 	 */
 	bool check(
 		bool fw,
@@ -524,26 +509,23 @@ public:
 	{
 		assert(inited_);
 		assert(topf > 0 || botf > 0);
-		DescentRedundancyKey k(al5pf, rflen, topf, botf);
-		size_t i = std::numeric_limits<size_t>::max();
-		size_t mask = topf & PART_MASK;
-		EMap<DescentRedundancyKey, TScore>& map =
-			(fw ? (l2r ? maplist_fl_[mask][al5pi] : maplist_fr_[mask][al5pi]) :
-			      (l2r ? maplist_rl_[mask][al5pi] : maplist_rr_[mask][al5pi]));
-		size_t key = (topf & 255) | ((botf & 255) << 8);
-		if(bits_.test(key) && map.containsEx(k, i)) {
+		Entry e;
+		e.set(fw, l2r, al5pi, al5pf, rflen, topf, botf);
+		size_t i = find(e);
+		if(slots_[i].gen == gen_) {
 			// Already contains the key
-			assert_lt(i, map.size());
-			assert_geq(pen, map[i].second);
+			assert_geq(pen, slots_[i].pen);
 			return false;
 		}
-		assert(!map.containsEx(k, i));
-		size_t oldsz = map.totalSizeBytes();
-		size_t oldcap = map.totalCapacityBytes();
-		map.insert(make_pair(k, pen));
-		bits_.set(key);
-		totsz_ += (map.totalSizeBytes() - oldsz);
-		totcap_ += (map.totalCapacityBytes() - oldcap);
+		if((nent_ + 1) * 2 > slots_.size()) {
+			grow();
+			i = find(e);
+			assert_neq(gen_, slots_[i].gen);
+		}
+		e.pen = pen;
+		e.gen = gen_;
+		slots_[i] = e;
+		nent_++;
 		return true;
 	}
 
@@ -562,46 +544,126 @@ public:
 		TScore pen)
 	{
 		assert(inited_);
-		size_t key = (topf & 255) | ((botf & 255) << 8);
-		if(!bits_.test(key)) {
-			return false;
-		}
-		DescentRedundancyKey k(al5pf, rflen, topf, botf);
-		size_t mask = topf & PART_MASK;
-		EMap<DescentRedundancyKey, TScore>& map =
-			(fw ? (l2r ? maplist_fl_[mask][al5pi] : maplist_fr_[mask][al5pi]) :
-			      (l2r ? maplist_rl_[mask][al5pi] : maplist_rr_[mask][al5pi]));
-		return map.contains(k);
+		Entry e;
+		e.set(fw, l2r, al5pi, al5pf, rflen, topf, botf);
+		return slots_[find(e)].gen == gen_;
 	}
 	
 	/**
-	 * Return the total size of the redundancy map.
+	 * Return the total size of the redundancy map, i.e. the bytes occupied
+	 * by entries for the current read.
 	 */
 	size_t totalSizeBytes() const {
-		return totsz_;
+		return nent_ * sizeof(Entry);
 	}
 
 	/**
 	 * Return the total capacity of the redundancy map.
 	 */
 	size_t totalCapacityBytes() const {
-		return totcap_;
+		return slots_.totalCapacityBytes();
 	}
 
 protected:
 
-	bool inited_;   // initialized?
-	size_t totsz_;  // total size
-	size_t totcap_; // total capacity
-	
-	// List of maps.  Each entry is a map for all the DescentRedundancyKeys
-	// with al5pi equal to the offset into the list.
-	ELList<EMap<DescentRedundancyKey, TScore>, NPARTS, 100> maplist_fl_; //  fw,  l2r
-	ELList<EMap<DescentRedundancyKey, TScore>, NPARTS, 100> maplist_rl_; // !fw,  l2r
-	ELList<EMap<DescentRedundancyKey, TScore>, NPARTS, 100> maplist_fr_; //  fw, !l2r
-	ELList<EMap<DescentRedundancyKey, TScore>, NPARTS, 100> maplist_rr_; // !fw, !l2r
-		
-	EBitList<128> bits_;
+	/**
+	 * One slot in the table.  The slot is occupied iff gen equals the
+	 * checker's current generation.
+	 */
+	struct Entry {
+
+		void set(
+			bool fw_,
+			bool l2r_,
+			TReadOff al5pi_,
+			TReadOff al5pf_,
+			size_t rflen_,
+			TIndexOffU topf_,
+			TIndexOffU botf_)
+		{
+			orient = (fw_ ? 2 : 0) | (l2r_ ? 1 : 0);
+			al5pi = al5pi_;
+			al5pf = al5pf_;
+			rflen = (uint32_t)rflen_;
+			topf = topf_;
+			botf = botf_;
+		}
+
+		bool sameKey(const Entry& o) const {
+			return topf == o.topf && botf == o.botf && al5pi == o.al5pi &&
+			       al5pf == o.al5pf && rflen == o.rflen && orient == o.orient;
+		}
+
+		size_t hash() const {
+			uint64_t h = (uint64_t)topf * 0x9E3779B97F4A7C15ull;
+			h ^= ((uint64_t)botf + ((uint64_t)al5pi << 32)) * 0xC2B2AE3D27D4EB4Full;
+			h ^= ((uint64_t)al5pf | ((uint64_t)rflen << 24) | ((uint64_t)orient << 56)) *
+			     0x165667B19E3779F9ull;
+			h ^= (h >> 29);
+			return (size_t)h;
+		}
+
+		TIndexOffU topf;   // top w/r/t forward index
+		TIndexOffU botf;   // bot w/r/t forward index
+		TScore     pen;    // penalty when first explored
+		uint32_t   gen;    // generation of the read that filled the slot
+		TReadOff   al5pi;  // 5'-most aligned char, as offset from 5' end
+		TReadOff   al5pf;  // 3'-most aligned char, as offset from 5' end
+		uint32_t   rflen;  // # reference characters involved
+		uint8_t    orient; // bit 1: fw, bit 0: l2r
+	};
+
+	/**
+	 * Return the index of the slot holding the given key, or of the empty
+	 * slot where it would be inserted.
+	 */
+	size_t find(const Entry& e) const {
+		assert_gt(slots_.size(), 0);
+		const size_t mask = slots_.size() - 1;
+		size_t i = e.hash() & mask;
+		while(slots_[i].gen == gen_ && !slots_[i].sameKey(e)) {
+			i = (i + 1) & mask;
+		}
+		return i;
+	}
+
+	/**
+	 * Double the number of slots and re-insert the current read's entries.
+	 */
+	void grow() {
+		tmp_.clear();
+		for(size_t i = 0; i < slots_.size(); i++) {
+			if(slots_[i].gen == gen_) {
+				tmp_.push_back(slots_[i]);
+			}
+		}
+		slots_.resize(slots_.size() * 2);
+		for(size_t i = 0; i < slots_.size(); i++) {
+			slots_[i].gen = 0;
+		}
+		for(size_t i = 0; i < tmp_.size(); i++) {
+			slots_[find(tmp_[i])] = tmp_[i];
+		}
+	}
+
+	/**
+	 * Start a new generation, invalidating all occupied slots.  Slots are
+	 * cleared explicitly only when the generation counter wraps.
+	 */
+	void bumpGen() {
+		if(++gen_ == 0) {
+			for(size_t i = 0; i < slots_.size(); i++) {
+				slots_[i].gen = 0;
+			}
+			gen_ = 1;
+		}
+	}
+
+	bool inited_;         // initialized?
+	size_t nent_;         // # entries for the current read
+	EList<Entry> slots_;  // open-addressed table; size is a power of 2
+	EList<Entry> tmp_;    // scratch space for grow()
+	uint32_t gen_;        // current generation; 0 is never current
 };
 
 /**
@@ -1286,6 +1348,13 @@ public:
 	TIndexOffU topf() const { return topf_; }
 	TIndexOffU botf() const { return botf_; }
 
+	/**
+	 * Return the number of reference characters spanned by this descent.
+	 */
+	size_t refLen() const {
+		return (size_t)((int64_t)al5pf_ - (int64_t)al5pi_ + 1 + gapadd_);
+	}
+
 protected:
 
 	/**
@@ -2157,7 +2226,13 @@ public:
 		size_t ei = 0;
 		for(size_t i = 0; i < sas_.size(); i++) {
 			size_t en = sink[i].botf - sink[i].topf;
-			sas_[i].init(sink[i].topf, EListSlice<TIndexOffU, 16>(offs_, ei, en));
+			// Length of the reference substring covered by the alignment
+			size_t rflen = q.length();
+			for(size_t j = sink[i].ei; j < sink[i].ei + sink[i].en; j++) {
+				if(sink.edits()[j].isReadGap()) rflen++;
+				else if(sink.edits()[j].isRefGap()) rflen--;
+			}
+			sas_[i].init(sink[i].topf, rflen, EListSlice<TIndexOffU, 16>(offs_, ei, en));
 			gws_[i].init(ebwtFw, ref, sas_[i], rnd, met);
 			ei += en;
 		}
@@ -2508,7 +2583,7 @@ protected:
 		rnd_.init(botf - topf, true); // without replacement
 		sas_.resize(1);
 		gws_.resize(1);
-		sas_[0].init(topf, EListSlice<TIndexOffU, 16>(offs_, 0, botf - topf));
+		sas_[0].init(topf, df[p.second].refLen(), EListSlice<TIndexOffU, 16>(offs_, 0, botf - topf));
 		gws_[0].init(ebwtFw, ref, sas_[0], rnd, met);
 	}
 	
@@ -737,6 +737,170 @@ void SwDriver::prioritizeSATups(
 	return;
 }
 
+/**
+ * Resolve the reference offset of BW row 'row' ('off' if it is already known)
+ * for a seed of length 'seedlen' that starts 'rdoff' characters from the
+ * upstream end of the read, and set 'diag' to the diagonal it implies.
+ * Returns false if the hit straddles a reference boundary.
+ */
+static bool seedDiag(
+	const Ebwt& ebwt,
+	TIndexOffU row,
+	TIndexOffU off,
+	size_t seedlen,
+	size_t rdoff,
+	bool fw,
+	Coord& diag)
+{
+	if(off == OFF_MASK) {
+		off = ebwt.getOffset(row);
+	}
+	TIndexOffU tidx = 0, toff = 0, tlen = 0;
+	bool straddled = false;
+	ebwt.joinedToTextOff(
+		(TIndexOffU)seedlen, off, tidx, toff, tlen, true, straddled);
+	if(tidx == OFF_MASK) {
+		return false;
+	}
+	diag.init(tidx, (int64_t)toff - (int64_t)rdoff, fw);
+	return true;
+}
+
+/**
+ * Before extending the anchor mate's seed hits, resolve the reference
+ * offsets of a bounded number of hits for both mates and intersect them: an
+ * anchor diagonal and an opposite-mate diagonal that make a concordant pair
+ * (ignoring gaps) are recorded in jointLoci_.  If 'reorder' is true, anchor
+ * ranges with such a diagonal go to the front of extOrder_ so they're
+ * extended first.  When an anchor alignment turns up at a joint locus, the
+ * opposite mate is aligned in a narrow band around its own seed diagonal
+ * rather than across the whole window allowed by the fragment length.
+ */
+void SwDriver::intersectMateSeeds(
+	const Read& rd,              // anchor mate
+	const Read& ord,             // opposite mate
+	bool anchor1,                // true iff anchor mate is mate1
+	SeedResults& osh,            // seed hits for opposite mate
+	const Ebwt& ebwtFw,          // BWT
+	const PairedEndPolicy& pepol,// paired-end policy
+	AlignmentCacheIface& ca,     // alignment cache for seed hits
+	bool reorder)                // put ranges with joint loci first?
+{
+	const size_t maxres = 16; // max offsets to resolve for each mate
+	const size_t rdlen = rd.length();
+	const size_t ordlen = ord.length();
+	Coord diag;
+	// 1. Resolve opposite-mate diagonals: end-to-end hits, then seed hits
+	// from the smallest ranges
+	oppDiags_.clear();
+	size_t nres = 0;
+	for(int fwi = 0; fwi < 2 && nres < maxres; fwi++) {
+		EEHit h = (fwi == 0) ? osh.exactFwEEHit() : osh.exactRcEEHit();
+		for(TIndexOffU r = h.top; r < h.bot && nres < maxres; r++, nres++) {
+			if(seedDiag(ebwtFw, r, OFF_MASK, ordlen, 0, h.fw, diag)) {
+				oppDiags_.push_back(diag);
+			}
+		}
+	}
+	for(size_t i = 0; i < osh.mm1EEHits().size() && nres < maxres; i++) {
+		const EEHit& h = osh.mm1EEHits()[i];
+		for(TIndexOffU r = h.top; r < h.bot && nres < maxres; r++, nres++) {
+			if(seedDiag(ebwtFw, r, OFF_MASK, ordlen, 0, h.fw, diag)) {
+				oppDiags_.push_back(diag);
+			}
+		}
+	}
+	for(size_t pass = 0; pass < 2 && nres < maxres; pass++) {
+		for(size_t i = 0; i < osh.numOffs() * 2 && nres < maxres; i++) {
+			bool fw = (i & 1) == 0;
+			size_t offidx = i >> 1;
+			const QVal& qv = osh.hitsAtOffIdx(fw, offidx);
+			if(!qv.valid() || qv.numElts() == 0) {
+				continue;
+			}
+			// Small ranges on the first pass, the rest on the second
+			if((qv.numElts() <= 4) != (pass == 0)) {
+				continue;
+			}
+			size_t nrange = 0, nelt = 0;
+			satups_.clear();
+			ca.queryQval(qv, satups_, nrange, nelt);
+			size_t seedlen = osh.seqs(fw)[offidx].length();
+			size_t rdoff = osh.idx2off(offidx);
+			if(!fw) {
+				rdoff = ordlen - rdoff - seedlen;
+			}
+			for(size_t j = 0; j < satups_.size() && nres < maxres; j++) {
+				const SATuple& sat = satups_[j];
+				for(size_t k = 0; k < sat.size() && nres < maxres; k++, nres++) {
+					if(seedDiag(
+						ebwtFw, (TIndexOffU)(sat.topf + k), sat.offs[k],
+						seedlen, rdoff, fw, diag))
+					{
+						oppDiags_.push_back(diag);
+					}
+				}
+			}
+		}
+	}
+	satups_.clear();
+	// 2. Resolve anchor diagonals and keep those with a concordant partner
+	jointLoci_.clear();
+	extOrder_.resize(satpos_.size());
+	for(size_t i = 0; i < extOrder_.size(); i++) {
+		extOrder_[i] = i;
+	}
+	size_t njoint = 0;
+	nres = 0;
+	for(size_t i = 0; i < satpos_.size() && nres < maxres && !oppDiags_.empty(); i++) {
+		const SATuple& sat = satpos_[i].sat;
+		bool fw = satpos_[i].pos.fw;
+		size_t seedlen = satpos_[i].pos.seedlen;
+		size_t rdoff = satpos_[i].pos.rdoff;
+		if(!fw) {
+			rdoff = rdlen - rdoff - seedlen;
+		}
+		bool joint = false;
+		for(size_t k = 0; k < sat.size() && nres < maxres; k++, nres++) {
+			if(!seedDiag(
+				ebwtFw, (TIndexOffU)(sat.topf + k), sat.offs[k],
+				seedlen, rdoff, fw, diag))
+			{
+				continue;
+			}
+			for(size_t j = 0; j < oppDiags_.size(); j++) {
+				const Coord& od = oppDiags_[j];
+				if(od.ref() != diag.ref()) {
+					continue;
+				}
+				int pairCl = pepol.peClassifyPair(
+					anchor1 ? diag.off() : od.off(),
+					anchor1 ? rdlen : ordlen,
+					anchor1 ? diag.fw() : od.fw(),
+					anchor1 ? od.off() : diag.off(),
+					anchor1 ? ordlen : rdlen,
+					anchor1 ? od.fw() : diag.fw());
+				if(pairCl == PE_ALS_DISCORD) {
+					continue;
+				}
+				jointLoci_.expand();
+				jointLoci_.back().adiag = diag;
+				jointLoci_.back().ooff = od.off();
+				jointLoci_.back().ofw = od.fw();
+				joint = true;
+				break;
+			}
+		}
+		if(joint && reorder) {
+			// Move the range up behind the other joint ranges
+			for(size_t j = i; j > njoint; j--) {
+				extOrder_[j] = extOrder_[j-1];
+			}
+			extOrder_[njoint++] = i;
+		}
+	}
+}
+
 enum {
 	FOUND_NONE = 0,
 	FOUND_EE,
@@ -1388,6 +1552,7 @@ int SwDriver::extendSeedsPaired(
 	bool anchor1,                // true iff anchor mate is mate1
 	bool oppFilt,                // true iff opposite mate was filtered out
 	SeedResults& sh,             // seed hits for anchor
+	SeedResults* osh,            // seed hits for opposite, to intersect
 	const Ebwt& ebwtFw,          // BWT
 	const Ebwt* ebwtBw,          // BWT'
 	const BitPairReference& ref, // Reference strings
@@ -1502,6 +1667,7 @@ int SwDriver::extendSeedsPaired(
 	const size_t rows = rdlen;
 	const size_t orows  = ordlen;
 	size_t eltsDone = 0;
+	jointLoci_.clear();
 	while(true) {
 		if(eeMode) {
 			if(firstEe) {
@@ -1524,6 +1690,23 @@ int SwDriver::extendSeedsPaired(
 				// streak for each range
 				mateStreaks_.resize(gws_.size());
 				mateStreaks_.fill(0);
+				extOrder_.resize(gws_.size());
+				for(size_t i = 0; i < extOrder_.size(); i++) {
+					extOrder_[i] = i;
+				}
+				if(osh != NULL && !oppFilt) {
+					// End-to-end hits stay in best-first order, but note
+					// which are supported by the opposite mate
+					intersectMateSeeds(
+						rd,       // anchor mate
+						ord,      // opposite mate
+						anchor1,  // anchor is mate 1?
+						*osh,     // seed hits for opposite mate
+						ebwtFw,   // BWT
+						pepol,    // paired-end policy
+						ca,       // alignment cache for seed hits
+						false);   // keep order
+				}
 			} else {
 				eeMode = false;
 			}
@@ -1563,13 +1746,31 @@ int SwDriver::extendSeedsPaired(
 				firstExtend = false;
 				mateStreaks_.resize(gws_.size());
 				mateStreaks_.fill(0);
+				if(osh != NULL && !oppFilt) {
+					// Extend loci supported by both mates first
+					intersectMateSeeds(
+						rd,       // anchor mate
+						ord,      // opposite mate
+						anchor1,  // anchor is mate 1?
+						*osh,     // seed hits for opposite mate
+						ebwtFw,   // BWT
+						pepol,    // paired-end policy
+						ca,       // alignment cache for seed hits
+						true);    // extend joint loci first
+				} else {
+					extOrder_.resize(gws_.size());
+					for(size_t i = 0; i < extOrder_.size(); i++) {
+						extOrder_[i] = i;
+					}
+				}
 			}
 			if(neltLeft == 0) {
 				// Finished examining gapped candidates
 				break;
 			}
 		}
-		for(size_t i = 0; i < gws_.size(); i++) {
+		for(size_t ii = 0; ii < gws_.size(); ii++) {
+			const size_t i = extOrder_[ii];
 			if(eeMode && eehits_[i].score < minsc) {
 				return EXTEND_PERFECT_SCORE;
 			}
@@ -1673,6 +1874,14 @@ int SwDriver::extendSeedsPaired(
 					swmSeed.rshit++;
 					continue;
 				}
+				// Is the opposite mate's seed hit for this locus known?
+				const JointLocus *joint = NULL;
+				for(size_t j = 0; j < jointLoci_.size(); j++) {
+					if(jointLoci_[j].adiag == refcoord) {
+						joint = &jointLoci_[j];
+						break;
+					}
+				}
 				// Now that we have a seed hit, there are many issues to solve
 				// before we have a completely framed dynamic programming problem.
 				// They include:
@@ -2007,7 +2216,20 @@ int SwDriver::extendSeedsPaired(
 								ofw);
 						}
 						DPRect orect;
-						if(foundMate) {
+						if(foundMate && joint != NULL && joint->ofw == ofw) {
+							// The opposite mate has a seed hit consistent with
+							// this anchor; align it around that diagonal
+							// rather than across the whole window
+							foundMate = dpframe.frameSeedExtensionRect(
+								joint->ooff, // ref offset implied by opp seed hit
+								orows,       // length of opposite mate
+								tlen,        // length of reference sequence aligned to
+								oreadGaps,   // max # of read gaps in opp mate aln
+								orefGaps,    // max # of ref gaps in opp mate aln
+								(size_t)onceil, // max # Ns on opp mate
+								maxhalf,     // max width in either direction
+								orect);      // DP rectangle
+						} else if(foundMate) {
 							foundMate = dpframe.frameFindMateRect(
 								!oleft,      // true iff anchor alignment is to the left
 								oll,         // leftmost Watson off for LHS of opp aln
@@ -2396,7 +2618,7 @@ int SwDriver::extendSeedsPaired(
 				// At this point we know that we aren't bailing, and will continue to resolve seed hits.  
 
 			} // while(!gw.done())
-		} // for(size_t i = 0; i < gws_.size(); i++)
+		} // for(size_t ii = 0; ii < gws_.size(); ii++)
 	}
 	return EXTEND_EXHAUSTED_CANDIDATES;
 }
@@ -291,6 +291,18 @@ struct ExtendRange {
 	size_t sz;  // # of elements in SA range
 };
 
+/**
+ * A locus where seed hits for both mates agree: an anchor diagonal and an
+ * opposite-mate diagonal on the same reference that together make a
+ * concordant pair, not counting gaps.
+ */
+struct JointLocus {
+
+	Coord   adiag; // anchor diagonal: ref, upstream offset, orientation
+	int64_t ooff;  // opposite mate's upstream offset assuming no gaps
+	bool    ofw;   // opposite mate's orientation
+};
+
 class SwDriver {
 
 	typedef PList<TIndexOffU, CACHE_PAGE_SZ> TSAList;
@@ -372,6 +384,7 @@ public:
 		bool anchor1,                // true iff anchor mate is mate1
 		bool oppFilt,                // true iff opposite mate was filtered out
 		SeedResults& sh,             // seed hits for anchor
+		SeedResults* osh,            // seed hits for opposite, to intersect
 		const Ebwt& ebwtFw,          // BWT
 		const Ebwt* ebwtBw,          // BWT'
 		const BitPairReference& ref, // Reference strings
@@ -488,6 +501,16 @@ protected:
 		size_t& nelt_out,            // out: # elements total
 		bool all);                   // report all hits?
 
+	void intersectMateSeeds(
+		const Read& rd,              // anchor mate
+		const Read& ord,             // opposite mate
+		bool anchor1,                // true iff anchor mate is mate1
+		SeedResults& osh,            // seed hits for opposite mate
+		const Ebwt& ebwtFw,          // BWT
+		const PairedEndPolicy& pepol,// paired-end policy
+		AlignmentCacheIface& ca,     // alignment cache for seed hits
+		bool reorder);               // put ranges with joint loci first?
+
 	Random1toN               rand_;    // random number generators
 	EList<Random1toN, 16>    rands_;   // random number generators
 	EList<Random1toN, 16>    rands2_;  // random number generators
@@ -497,6 +520,9 @@ protected:
 	EList<SATuple, 16>       satups_;  // holds SATuples to explore elements from
 	EList<GroupWalk2S<TSlice, 16> > gws_;   // list of GroupWalks; no particular order
 	EList<size_t>            mateStreaks_; // mate-find fail streaks
+	EList<size_t>            extOrder_;    // order in which to extend satpos_
+	EList<JointLocus>        jointLoci_;   // loci supported by both mates
+	EList<Coord>             oppDiags_;    // opposite-mate seed diagonals
 	RowSampler               rowsamp_;     // row sampler
 	
 	// Ranges that we've extended through when extending seed hits
@@ -139,6 +139,46 @@ bool ReportingState::foundUnpaired(bool mate1) {
 	}
 	return done();
 }
+
+/**
+ * Caller uses this member function to indicate that the best score and MAPQ
+ * for concordant alignments can no longer change.  As with -k, unpaired
+ * alignments are no longer of interest either.
+ */
+bool ReportingState::settledConcordant() {
+	assert(paired_);
+	assert_gt(nconcord_, 0);
+	if(!doneConcord_) {
+		doneConcord_ = true;
+		exitConcord_ = ReportingState::EXIT_SHORT_CIRCUIT_MAPQ;
+		if(!doneUnpair1_) {
+			doneUnpair1_ = true;
+			exitUnpair1_ = ReportingState::EXIT_SHORT_CIRCUIT_TRUMPED;
+		}
+		if(!doneUnpair2_) {
+			doneUnpair2_ = true;
+			exitUnpair2_ = ReportingState::EXIT_SHORT_CIRCUIT_TRUMPED;
+		}
+		updateDone();
+	}
+	return done();
+}
+
+/**
+ * Caller uses this member function to indicate that the best score and MAPQ
+ * for unpaired alignments of the specified mate can no longer change.
+ */
+bool ReportingState::settledUnpaired(bool mate1) {
+	bool& doneUnpair = mate1 ? doneUnpair1_ : doneUnpair2_;
+	int& exitUnpair = mate1 ? exitUnpair1_ : exitUnpair2_;
+	assert_gt(mate1 ? nunpair1_ : nunpair2_, 0);
+	if(!doneUnpair) {
+		doneUnpair = true;
+		exitUnpair = ReportingState::EXIT_SHORT_CIRCUIT_MAPQ;
+		updateDone();
+	}
+	return done();
+}
 	
 /**
  * Called to indicate that the aligner has finished searching for
@@ -239,7 +279,9 @@ void ReportingState::getReport(
 			// Not sure if this is OK
 			nconcordAln = 1; // 1 at random
 			return;
-		} else if(exitConcord_ == ReportingState::EXIT_WITH_ALIGNMENTS) {
+		} else if(exitConcord_ == ReportingState::EXIT_WITH_ALIGNMENTS ||
+		          exitConcord_ == ReportingState::EXIT_SHORT_CIRCUIT_MAPQ)
+		{
 			assert_gt(nconcord_, 0);
 			// <= k at random
 			nconcordAln = min<uint64_t>(nconcord_, p_.khits);
@@ -274,7 +316,9 @@ void ReportingState::getReport(
 		assert_gt(nunpair1_, 0);
 		unpair1Max = true;  // repetitive alignments for mate #1
 		nunpair1Aln = 1; // 1 at random
-	} else if(exitUnpair1_ == ReportingState::EXIT_WITH_ALIGNMENTS) {
+	} else if(exitUnpair1_ == ReportingState::EXIT_WITH_ALIGNMENTS ||
+	          exitUnpair1_ == ReportingState::EXIT_SHORT_CIRCUIT_MAPQ)
+	{
 		assert_gt(nunpair1_, 0);
 		// <= k at random
 		nunpair1Aln = min<uint64_t>(nunpair1_, (uint64_t)p_.khits);
@@ -290,7 +334,9 @@ void ReportingState::getReport(
 		assert_gt(nunpair2_, 0);
 		unpair2Max = true;  // repetitive alignments for mate #1
 		nunpair2Aln = 1; // 1 at random
-	} else if(exitUnpair2_ == ReportingState::EXIT_WITH_ALIGNMENTS) {
+	} else if(exitUnpair2_ == ReportingState::EXIT_WITH_ALIGNMENTS ||
+	          exitUnpair2_ == ReportingState::EXIT_SHORT_CIRCUIT_MAPQ)
+	{
 		assert_gt(nunpair2_, 0);
 		// <= k at random
 		nunpair2Aln = min<uint64_t>(nunpair2_, (uint64_t)p_.khits);
@@ -514,14 +560,8 @@ void AlnSink::printAlSumm(
 			cerr << ") aligned >1 times" << endl;
 		}
 	}
-	uint64_t tot_al_cand = totunpair + totpair*2;
-	uint64_t tot_al =
-		(met.nconcord_uni + met.nconcord_rep)*2 +
-		(met.ndiscord)*2 +
-		met.nunp_0_uni +
-		met.nunp_0_rep + 
-		met.nunp_uni +
-		met.nunp_rep;
+	uint64_t tot_al_cand = met.mates();
+	uint64_t tot_al = met.matesAligned();
 	assert_leq(tot_al, tot_al_cand);
 	printPct(cerr, tot_al, tot_al_cand);
 	cerr << " overall alignment rate" << endl;
@@ -585,7 +625,9 @@ int AlnSinkWrap::nextRead(
 	const Read* rd1,      // new mate #1
 	const Read* rd2,      // new mate #2
 	TReadId rdid,         // read ID for new pair
-	bool qualitiesMatter) // aln policy distinguishes b/t quals?
+	bool qualitiesMatter, // aln policy distinguishes b/t quals?
+	TAlScore perfect1,    // best possible score for mate #1
+	TAlScore perfect2)    // best possible score for mate #2
 {
 	assert(!init_);
 	assert(rd1 != NULL || rd2 != NULL);
@@ -606,6 +648,9 @@ int AlnSinkWrap::nextRead(
 	bestPair_ = best2Pair_ =
 	bestUnp1_ = best2Unp1_ =
 	bestUnp2_ = best2Unp2_ = std::numeric_limits<THitInt>::min();
+	perfect1_ = perfect1;
+	perfect2_ = perfect2;
+	refOff_ = 0;
 	rs1_.clear();     // clear out paired-end alignments
 	rs2_.clear();     // clear out paired-end alignments
 	rs1u_.clear();    // clear out unpaired alignments for mate #1
@@ -653,6 +698,8 @@ void AlnSinkWrap::finishRead(
 	bool               lenfilt2,    // mate 2 length-filtered?
 	bool               qcfilt1,     // mate 1 qc-filtered?
 	bool               qcfilt2,     // mate 2 qc-filtered?
+	bool               lcfilt1,     // mate 1 low-complexity-filtered?
+	bool               lcfilt2,     // mate 2 low-complexity-filtered?
 	RandomSource&      rnd,         // pseudo-random generator
 	ReportingMetrics&  met,         // reporting metrics
 	const PerReadMetrics& prm,      // per-read metrics
@@ -705,6 +752,15 @@ void AlnSinkWrap::finishRead(
 		assert(!pairMax    || rs1_.size()  >= (uint64_t)rp_.mhits);
 		assert(!unpair1Max || rs1u_.size() >= (uint64_t)rp_.mhits);
 		assert(!unpair2Max || rs2u_.size() >= (uint64_t)rp_.mhits);
+		if(g_.readOut() != NULL) {
+			// Write the raw read(s) to --un/--al/--un-conc/--al-conc files
+			g_.readOut()->write(
+				rd1_,
+				rd2_,
+				readIsPair() ? (nconcord > 0) : (nunpair1 > 0 || nunpair2 > 0),
+				rdid_,
+				threadid_);
+		}
 		met.nread++;
 		if(readIsPair()) {
 			met.npaired++;
@@ -775,6 +831,7 @@ void AlnSinkWrap::finishRead(
 				scfilt1,
 				lenfilt1,
 				qcfilt1,
+				lcfilt1,
 				st_.params().mixed,
 				true,       // primary
 				true,       // opp aligned
@@ -790,6 +847,7 @@ void AlnSinkWrap::finishRead(
 				scfilt2,
 				lenfilt2,
 				qcfilt2,
+				lcfilt2,
 				st_.params().mixed,
 				false,      // primary
 				true,       // opp aligned
@@ -800,8 +858,8 @@ void AlnSinkWrap::finishRead(
 			// vary from pair to pair among the pairs we're reporting.  For
 			// instance, whether the a given mate aligns to the forward strand.
 			SeedAlSumm ssm1, ssm2;
-			sr1->toSeedAlSumm(ssm1);
-			sr2->toSeedAlSumm(ssm2);
+			if(sr1 != NULL) sr1->toSeedAlSumm(ssm1);
+			if(sr2 != NULL) sr2->toSeedAlSumm(ssm2);
 			for(size_t i = 0; i < rs1_.size(); i++) {
 				rs1_[i].setMateParams(ALN_RES_TYPE_MATE1, &rs2_[i], flags1);
 				rs2_[i].setMateParams(ALN_RES_TYPE_MATE2, &rs1_[i], flags2);
@@ -864,6 +922,7 @@ void AlnSinkWrap::finishRead(
 				scfilt1,
 				lenfilt1,
 				qcfilt1,
+				lcfilt1,
 				st_.params().mixed,
 				true,       // primary
 				true,       // opp aligned
@@ -879,6 +938,7 @@ void AlnSinkWrap::finishRead(
 				scfilt2,
 				lenfilt2,
 				qcfilt2,
+				lcfilt2,
 				st_.params().mixed,
 				false,      // primary
 				true,       // opp aligned
@@ -886,8 +946,8 @@ void AlnSinkWrap::finishRead(
 				scUnMapped,
 				xeq);
 			SeedAlSumm ssm1, ssm2;
-			sr1->toSeedAlSumm(ssm1);
-			sr2->toSeedAlSumm(ssm2);
+			if(sr1 != NULL) sr1->toSeedAlSumm(ssm1);
+			if(sr2 != NULL) sr2->toSeedAlSumm(ssm2);
 			for(size_t i = 0; i < rs1_.size(); i++) {
 				rs1_[i].setMateParams(ALN_RES_TYPE_MATE1, &rs2_[i], flags1);
 				rs2_[i].setMateParams(ALN_RES_TYPE_MATE2, &rs1_[i], flags2);
@@ -1181,6 +1241,7 @@ void AlnSinkWrap::finishRead(
 				scfilt1,
 				lenfilt1,
 				qcfilt1,
+				lcfilt1,
 				st_.params().mixed,
 				true,   // primary
 				repRs2 != NULL,                    // opp aligned
@@ -1205,6 +1266,7 @@ void AlnSinkWrap::finishRead(
 				scfilt2,
 				lenfilt2,
 				qcfilt2,
+				lcfilt2,
 				st_.params().mixed,
 				true,   // primary
 				repRs1 != NULL,                  // opp aligned
@@ -1306,6 +1368,7 @@ void AlnSinkWrap::finishRead(
 				scfilt1,
 				lenfilt1,
 				qcfilt1,
+				lcfilt1,
 				st_.params().mixed,
 				true,           // primary
 				repRs2 != NULL, // opp aligned
@@ -1354,6 +1417,7 @@ void AlnSinkWrap::finishRead(
 				scfilt2,
 				lenfilt2,
 				qcfilt2,
+				lcfilt2,
 				st_.params().mixed,
 				true,           // primary
 				repRs1 != NULL, // opp aligned
@@ -1377,6 +1441,9 @@ void AlnSinkWrap::finishRead(
 				sc,      // scoring scheme
 				true);   // get lock?
 		}
+	} else if(g_.readOut() != NULL) {
+		// Keep --reorder of --un/--al files from waiting on this read
+		g_.readOut()->skip(rdid_, threadid_);
 	} // if(suppress alignments)
 	init_ = false;
 	return;
@@ -1411,12 +1478,16 @@ bool AlnSinkWrap::report(
 		st_.foundConcordant();
 		rs1_.push_back(*rs1);
 		rs2_.push_back(*rs2);
+		if(refOff_ != 0) {
+			rs1_.back().adjustRefId(refOff_);
+			rs2_.back().adjustRefId(refOff_);
+		}
 	} else {
 		st_.foundUnpaired(one);
-		if(one) {
-			rs1u_.push_back(*rs1);
-		} else {
-			rs2u_.push_back(*rs2);
+		EList<AlnRes>& rs = one ? rs1u_ : rs2u_;
+		rs.push_back(one ? *rs1 : *rs2);
+		if(refOff_ != 0) {
+			rs.back().adjustRefId(refOff_);
 		}
 	}
 	// Tally overall alignment score
@@ -1447,6 +1518,28 @@ bool AlnSinkWrap::report(
 			}
 		}
 	}
+	// With -M, MAPQ is a function of the best and second-best scores that
+	// can only fall as the second-best rises and can only rise as the best
+	// rises.  Once the best alignment is perfect and another alignment ties
+	// it, neither score can change, so the outcome is settled.
+	if(rp_.mapqStop && rp_.msample && !st_.done()) {
+		if(paired) {
+			if(!st_.doneConcordant() &&
+			   perfect1_ < std::numeric_limits<TAlScore>::max() &&
+			   perfect2_ < std::numeric_limits<TAlScore>::max() &&
+			   best2Pair_ == bestPair_ && bestPair_ >= perfect1_ + perfect2_)
+			{
+				st_.settledConcordant();
+			}
+		} else {
+			TAlScore best  = one ? bestUnp1_  : bestUnp2_;
+			TAlScore best2 = one ? best2Unp1_ : best2Unp2_;
+			TAlScore perf  = one ? perfect1_  : perfect2_;
+			if(!st_.doneUnpaired(one) && best2 == best && best >= perf) {
+				st_.settledUnpaired(one);
+			}
+		}
+	}
 	return st_.done();
 }
 
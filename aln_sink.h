@@ -27,6 +27,7 @@
 #include "ds.h"
 #include "simple_func.h"
 #include "outq.h"
+#include "read_out.h"
 #include <utility>
 
 // Forward decl	
@@ -116,6 +117,27 @@ struct ReportingMetrics {
 		sum_best      = sum_best_;
 	}
 	
+	/**
+	 * Return the number of mates that could have aligned: unpaired reads
+	 * plus both mates of each pair.
+	 */
+	uint64_t mates() const {
+		return nunpaired + npaired * 2;
+	}
+
+	/**
+	 * Return the number of mates that aligned, as counted by the overall
+	 * alignment rate.
+	 */
+	uint64_t matesAligned() const {
+		return (nconcord_uni + nconcord_rep) * 2 +
+		       ndiscord * 2 +
+		       nunp_0_uni +
+		       nunp_0_rep +
+		       nunp_uni +
+		       nunp_rep;
+	}
+
 	/**
 	 * Merge (add) the counters in the given ReportingMetrics object
 	 * into this object.  This is the only safe way to update a
@@ -219,9 +241,10 @@ struct ReportingParams {
 		THitInt pengap_,
 		bool msample_,
 		bool discord_,
-		bool mixed_)
+		bool mixed_,
+		bool mapqStop_ = false)
 	{
-		init(khits_, mhits_, pengap_, msample_, discord_, mixed_);
+		init(khits_, mhits_, pengap_, msample_, discord_, mixed_, mapqStop_);
 	}
 
 	void init(
@@ -230,7 +253,8 @@ struct ReportingParams {
 		THitInt pengap_,
 		bool msample_,
 		bool discord_,
-		bool mixed_)
+		bool mixed_,
+		bool mapqStop_ = false)
 	{
 		khits   = khits_;     // -k (or high if -a)
 		mhits   = ((mhits_ == 0) ? std::numeric_limits<THitInt>::max() : mhits_);
@@ -238,6 +262,7 @@ struct ReportingParams {
 		msample = msample_;
 		discord = discord_;
 		mixed   = mixed_;
+		mapqStop = mapqStop_;
 	}
 	
 #ifndef NDEBUG
@@ -310,6 +335,10 @@ struct ReportingParams {
 	// are paired-end alignments for a paired-end read, or if the number of
 	// paired-end alignments exceeds the -m ceiling.
 	bool mixed;
+
+	// true iff we should stop looking for alignments in a category once
+	// the -M primary alignment score and MAPQ can no longer change
+	bool mapqStop;
 };
 
 /**
@@ -346,6 +375,7 @@ public:
 		EXIT_SHORT_CIRCUIT_k,         // -k exceeded
 		EXIT_SHORT_CIRCUIT_M,         // -M exceeded
 		EXIT_SHORT_CIRCUIT_TRUMPED,   // made irrelevant
+		EXIT_SHORT_CIRCUIT_MAPQ,      // best & MAPQ can't change
 		EXIT_CONVERTED_TO_DISCORDANT, // unpair became discord
 		EXIT_NO_ALIGNMENTS,           // none found
 		EXIT_WITH_ALIGNMENTS          // some found
@@ -398,6 +428,20 @@ public:
 	 * discordant alignment has been found.
 	 */
 	bool foundUnpaired(bool mate1);
+
+	/**
+	 * Caller uses this member function to indicate that the best score and
+	 * MAPQ for concordant alignments can no longer change, so there is no
+	 * need to look for more.
+	 */
+	bool settledConcordant();
+
+	/**
+	 * Caller uses this member function to indicate that the best score and
+	 * MAPQ for unpaired alignments of the specified mate can no longer
+	 * change, so there is no need to look for more.
+	 */
+	bool settledUnpaired(bool mate1);
 	
 	/**
 	 * Called to indicate that the aligner has finished searching for
@@ -601,7 +645,8 @@ public:
 		bool quiet) :
 		oq_(oq),
 		refnames_(refnames),
-		quiet_(quiet)
+		quiet_(quiet),
+		readOut_(NULL)
 	{ }
 
 	/**
@@ -858,11 +903,28 @@ public:
 		return oq_;
 	}
 
+	/**
+	 * Set the files that reads are written to according to whether they
+	 * aligned (--un, --al, --un-conc, --al-conc).  NULL means none.
+	 */
+	void setReadOut(ReadOutFiles *readOut) {
+		readOut_ = readOut;
+	}
+
+	/**
+	 * Return the files that reads are written to according to whether they
+	 * aligned, or NULL if there are none.
+	 */
+	ReadOutFiles* readOut() {
+		return readOut_;
+	}
+
 protected:
 
 	OutputQueue&       oq_;           // output queue
 	const StrList&     refnames_;     // reference names
 	bool               quiet_;        // true -> don't print alignment stats at the end
+	ReadOutFiles      *readOut_;      // --un/--al/--un-conc/--al-conc files
 	ReportingMetrics   met_;          // global repository of reporting metrics
 };
 
@@ -976,6 +1038,9 @@ public:
 		best2Unp1_(std::numeric_limits<TAlScore>::min()),
 		bestUnp2_(std::numeric_limits<TAlScore>::min()),
 		best2Unp2_(std::numeric_limits<TAlScore>::min()),
+		perfect1_(std::numeric_limits<TAlScore>::max()),
+		perfect2_(std::numeric_limits<TAlScore>::max()),
+		refOff_(0),
 		rd1_(NULL),    // mate 1
 		rd2_(NULL),    // mate 2
 		rdid_(std::numeric_limits<TReadId>::max()), // read id
@@ -1003,7 +1068,9 @@ public:
 		const Read* rd1,      // new mate #1
 		const Read* rd2,      // new mate #2
 		TReadId rdid,         // read ID for new pair
-		bool qualitiesMatter);// aln policy distinguishes b/t quals?
+		bool qualitiesMatter, // aln policy distinguishes b/t quals?
+		TAlScore perfect1 = std::numeric_limits<TAlScore>::max(),  // best possible score for mate #1
+		TAlScore perfect2 = std::numeric_limits<TAlScore>::max()); // best possible score for mate #2
 
 	/**
 	 * Inform global, shared AlnSink object that we're finished with
@@ -1024,6 +1091,8 @@ public:
 		bool               lenfilt2,    // mate 2 length-filtered?
 		bool               qcfilt1,     // mate 1 qc-filtered?
 		bool               qcfilt2,     // mate 2 qc-filtered?
+		bool               lcfilt1,     // mate 1 low-complexity-filtered?
+		bool               lcfilt2,     // mate 2 low-complexity-filtered?
 		RandomSource&      rnd,         // pseudo-random generator
 		ReportingMetrics&  met,         // reporting metrics
 		const PerReadMetrics& prm,      // per-read metrics
@@ -1079,6 +1148,15 @@ public:
 	bool empty() const {
 		return rs1_.empty() && rs1u_.empty() && rs2u_.empty();
 	}
+
+	/**
+	 * Set the amount added to the reference id of each alignment reported
+	 * from now on.  Used when aligning to several indexes, whose references
+	 * are numbered consecutively in the SAM header.
+	 */
+	void setRefIdOffset(TRefId off) {
+		refOff_ = off;
+	}
 	
 	/**
 	 * Return true iff we have already encountered a number of alignments that
@@ -1267,6 +1345,9 @@ protected:
 	TAlScore        best2Unp1_;    // second-greatest score so far for unpaired/mate1
 	TAlScore        bestUnp2_;     // greatest score so far for mate 2
 	TAlScore        best2Unp2_;    // second-greatest score so far for mate 2
+	TAlScore        perfect1_;     // upper bound on mate 1 score, for --mapq-stop
+	TAlScore        perfect2_;     // upper bound on mate 2 score, for --mapq-stop
+	TRefId          refOff_;       // added to ref ids of reported alignments
 	const Read*     rd1_;   // mate #1
 	const Read*     rd2_;   // mate #2
 	TReadId         rdid_;  // read ID (potentially used for ordering)
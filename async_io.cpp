@@ -0,0 +1,473 @@
+/*
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of Bowtie 2.
+ *
+ * Bowtie 2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bowtie 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bowtie 2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <iostream>
+#include "async_io.h"
+
+#ifdef WITH_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#ifndef __NR_io_uring_setup
+// C library older than the kernel headers; use the I/O thread
+#undef WITH_IO_URING
+#endif
+#endif
+
+using namespace std;
+
+/**
+ * Finish a short read or write of 'r' with blocking calls.  A read that
+ * hits the end of the file stays short.
+ */
+void AsyncIo::finish(AioRequest& r) {
+	while(r.err == 0 && (size_t)r.res < r.len) {
+		ssize_t n = r.write ?
+			pwrite(r.fd, r.buf + r.res, r.len - r.res, (off_t)(r.off + r.res)) :
+			pread(r.fd, r.buf + r.res, r.len - r.res, (off_t)(r.off + r.res));
+		if(n < 0) {
+			if(errno != EINTR) {
+				r.err = errno;
+			}
+		} else if(n == 0) {
+			if(r.write) {
+				r.err = EIO;
+			}
+			break;
+		} else {
+			r.res += n;
+		}
+	}
+}
+
+#ifdef WITH_IO_URING
+
+/**
+ * io_uring backend, driven with raw system calls.  Only the thread holding
+ * the caller's lock touches the rings, so they need no locking of their
+ * own, just the ordering the kernel expects on the head and tail indexes.
+ */
+class IoUring : public AsyncIo {
+
+public:
+
+	IoUring() : fd_(-1), sq_(MAP_FAILED), cq_(MAP_FAILED), sqes_(MAP_FAILED) { }
+
+	virtual ~IoUring() {
+		if(sqes_ != MAP_FAILED) munmap(sqes_, sqesSz_);
+		if(cq_ != MAP_FAILED) munmap(cq_, cqSz_);
+		if(sq_ != MAP_FAILED) munmap(sq_, sqSz_);
+		if(fd_ >= 0) close(fd_);
+	}
+
+	/**
+	 * Set up a ring with room for 'entries' requests.  Returns false if
+	 * the kernel won't.
+	 */
+	bool init(unsigned entries) {
+		struct io_uring_params p;
+		memset(&p, 0, sizeof(p));
+		fd_ = (int)syscall(__NR_io_uring_setup, entries, &p);
+		if(fd_ < 0) {
+			return false;
+		}
+		sqSz_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+		cqSz_ = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+		sqesSz_ = p.sq_entries * sizeof(struct io_uring_sqe);
+		sq_ = mmap(NULL, sqSz_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+		cq_ = mmap(NULL, cqSz_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+		sqes_ = mmap(NULL, sqesSz_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+		if(sq_ == MAP_FAILED || cq_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+			return false;
+		}
+		char *sq = (char *)sq_, *cq = (char *)cq_;
+		sqTail_  = (unsigned *)(sq + p.sq_off.tail);
+		sqMask_  = *(unsigned *)(sq + p.sq_off.ring_mask);
+		sqArray_ = (unsigned *)(sq + p.sq_off.array);
+		cqHead_  = (unsigned *)(cq + p.cq_off.head);
+		cqTail_  = (unsigned *)(cq + p.cq_off.tail);
+		cqMask_  = *(unsigned *)(cq + p.cq_off.ring_mask);
+		cqes_    = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+		return true;
+	}
+
+	virtual void submit(AioRequest& r) {
+		assert(!r.busy);
+		r.res = 0;
+		r.err = 0;
+		r.busy = true;
+		r.done = false;
+		r.iov.iov_base = r.buf;
+		r.iov.iov_len = r.len;
+		unsigned tail = *sqTail_;
+		unsigned idx = tail & sqMask_;
+		struct io_uring_sqe *sqe = (struct io_uring_sqe *)sqes_ + idx;
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = r.write ? IORING_OP_WRITEV : IORING_OP_READV;
+		sqe->fd = r.fd;
+		sqe->addr = (uint64_t)(uintptr_t)&r.iov;
+		sqe->len = 1;
+		sqe->off = (uint64_t)r.off;
+		sqe->user_data = (uint64_t)(uintptr_t)&r;
+		sqArray_[idx] = idx;
+		__atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+		while(syscall(__NR_io_uring_enter, fd_, 1, 0, 0, NULL, 0) < 0) {
+			if(errno != EINTR && errno != EAGAIN) {
+				cerr << "Error: io_uring_enter failed: " << strerror(errno) << endl;
+				throw 1;
+			}
+		}
+	}
+
+	virtual void wait(AioRequest& r) {
+		assert(r.busy);
+		reap();
+		while(!r.done) {
+			if(syscall(__NR_io_uring_enter, fd_, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 &&
+			   errno != EINTR)
+			{
+				cerr << "Error: io_uring_enter failed: " << strerror(errno) << endl;
+				throw 1;
+			}
+			reap();
+		}
+		finish(r);
+		r.busy = false;
+	}
+
+	virtual const char *name() const { return "io_uring"; }
+
+protected:
+
+	/**
+	 * Mark every completed request as done.
+	 */
+	void reap() {
+		unsigned head = *cqHead_;
+		unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+		for(; head != tail; head++) {
+			const struct io_uring_cqe *cqe = &cqes_[head & cqMask_];
+			AioRequest *r = (AioRequest *)(uintptr_t)cqe->user_data;
+			if(cqe->res < 0) {
+				r->err = -cqe->res;
+			} else {
+				r->res = cqe->res;
+			}
+			r->done = true;
+		}
+		__atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+	}
+
+	int      fd_;
+	void    *sq_, *cq_, *sqes_;
+	size_t   sqSz_, cqSz_, sqesSz_;
+	unsigned *sqTail_, *sqArray_, sqMask_;
+	unsigned *cqHead_, *cqTail_, cqMask_;
+	struct io_uring_cqe *cqes_;
+};
+
+#endif /*def WITH_IO_URING*/
+
+/**
+ * Fallback backend: a helper thread carries out requests one after another
+ * with blocking pread()/pwrite() calls.
+ */
+class IoThread : public AsyncIo {
+
+public:
+
+	IoThread() : queue_(MISC_CAT), qhead_(0), stop_(false) {
+		pthread_mutex_init(&mutex_, NULL);
+		pthread_cond_init(&work_, NULL);
+		pthread_cond_init(&done_, NULL);
+		if(pthread_create(&thread_, NULL, IoThread::run, this) != 0) {
+			cerr << "Error: Could not start I/O thread" << endl;
+			throw 1;
+		}
+	}
+
+	virtual ~IoThread() {
+		pthread_mutex_lock(&mutex_);
+		stop_ = true;
+		pthread_cond_signal(&work_);
+		pthread_mutex_unlock(&mutex_);
+		pthread_join(thread_, NULL);
+		pthread_cond_destroy(&done_);
+		pthread_cond_destroy(&work_);
+		pthread_mutex_destroy(&mutex_);
+	}
+
+	virtual void submit(AioRequest& r) {
+		pthread_mutex_lock(&mutex_);
+		assert(!r.busy);
+		r.res = 0;
+		r.err = 0;
+		r.busy = true;
+		r.done = false;
+		queue_.push_back(&r);
+		pthread_cond_signal(&work_);
+		pthread_mutex_unlock(&mutex_);
+	}
+
+	virtual void wait(AioRequest& r) {
+		assert(r.busy);
+		pthread_mutex_lock(&mutex_);
+		while(!r.done) {
+			pthread_cond_wait(&done_, &mutex_);
+		}
+		r.busy = false;
+		pthread_mutex_unlock(&mutex_);
+	}
+
+	virtual const char *name() const { return "I/O thread"; }
+
+protected:
+
+	static void *run(void *arg) {
+		IoThread *t = (IoThread *)arg;
+		pthread_mutex_lock(&t->mutex_);
+		while(true) {
+			while(t->qhead_ == t->queue_.size() && !t->stop_) {
+				pthread_cond_wait(&t->work_, &t->mutex_);
+			}
+			if(t->qhead_ == t->queue_.size()) {
+				break;
+			}
+			AioRequest *r = t->queue_[t->qhead_++];
+			if(t->qhead_ == t->queue_.size()) {
+				t->queue_.clear();
+				t->qhead_ = 0;
+			}
+			pthread_mutex_unlock(&t->mutex_);
+			finish(*r);
+			pthread_mutex_lock(&t->mutex_);
+			r->done = true;
+			pthread_cond_broadcast(&t->done_);
+		}
+		pthread_mutex_unlock(&t->mutex_);
+		return NULL;
+	}
+
+	pthread_t            thread_;
+	pthread_mutex_t      mutex_;
+	pthread_cond_t       work_;  // signalled when a request is queued
+	pthread_cond_t       done_;  // signalled when a request finishes
+	EList<AioRequest*>   queue_;
+	size_t               qhead_; // next request in queue_ to carry out
+	bool                 stop_;
+};
+
+/**
+ * Make the best backend available that can keep 'depth' requests in
+ * flight.
+ */
+AsyncIo *AsyncIo::create(int depth) {
+#ifdef WITH_IO_URING
+	IoUring *ring = new IoUring();
+	if(ring->init((unsigned)depth)) {
+		return ring;
+	}
+	delete ring;
+#else
+	(void)depth;
+#endif
+	return new IoThread();
+}
+
+AsyncReader::AsyncReader(int fd, int64_t off, size_t chunk, int depth) :
+	io_(AsyncIo::create(depth)),
+	fd_(fd),
+	chunk_(chunk),
+	reqs_(MISC_CAT),
+	bufs_(MISC_CAT),
+	head_(0),
+	nextOff_(off),
+	curOff_(off),
+	eof_(false),
+	handed_(false)
+{
+	assert_gt(depth, 0);
+	reqs_.resizeExact(depth);
+	bufs_.resizeExact(chunk_ * depth);
+	for(size_t i = 0; i < reqs_.size(); i++) {
+		reqs_[i].buf = bufs_.ptr() + i * chunk_;
+		submit(reqs_[i]);
+	}
+}
+
+AsyncReader::~AsyncReader() {
+	for(size_t i = 0; i < reqs_.size(); i++) {
+		if(reqs_[i].busy) {
+			io_->wait(reqs_[i]);
+		}
+	}
+	delete io_;
+}
+
+/**
+ * Request the chunk after the last one requested into 'r'.
+ */
+void AsyncReader::submit(AioRequest& r) {
+	r.fd = fd_;
+	r.write = false;
+	r.len = chunk_;
+	r.off = nextOff_;
+	nextOff_ += (int64_t)chunk_;
+	io_->submit(r);
+}
+
+/**
+ * Return the next chunk of the file.  The chunk handed out last time is
+ * finished with, so its buffer goes back to reading further ahead.
+ */
+bool AsyncReader::next(char*& buf, size_t& len) {
+	if(handed_) {
+		handed_ = false;
+		curOff_ = reqs_[head_].off + (int64_t)reqs_[head_].res;
+		if(!eof_) {
+			submit(reqs_[head_]);
+		}
+		head_ = (head_ + 1) % reqs_.size();
+	}
+	AioRequest& r = reqs_[head_];
+	if(!r.busy) {
+		// Wasn't requested because the end of the file came first
+		return false;
+	}
+	io_->wait(r);
+	if(r.err != 0) {
+		cerr << "Error: Could not read input file: " << strerror(r.err) << endl;
+		throw 1;
+	}
+	if((size_t)r.res < chunk_) {
+		eof_ = true;
+	}
+	if(r.res == 0) {
+		return false;
+	}
+	curOff_ = r.off;
+	buf = r.buf;
+	len = (size_t)r.res;
+	handed_ = true;
+	return true;
+}
+
+AsyncWriter::AsyncWriter(int fd, int64_t off, size_t chunk, int depth) :
+	io_(AsyncIo::create(depth)),
+	fd_(fd),
+	chunk_(chunk),
+	reqs_(MISC_CAT),
+	bufs_(MISC_CAT),
+	head_(0),
+	cur_(0),
+	off_(off),
+	failed_(false)
+{
+	assert_gt(depth, 0);
+	reqs_.resizeExact(depth);
+	bufs_.resizeExact(chunk_ * depth);
+	for(size_t i = 0; i < reqs_.size(); i++) {
+		reqs_[i].fd = fd_;
+		reqs_[i].write = true;
+		reqs_[i].buf = bufs_.ptr() + i * chunk_;
+	}
+}
+
+AsyncWriter::~AsyncWriter() {
+	drain();
+	delete io_;
+}
+
+/**
+ * Append 'len' bytes to the output, starting a write each time a buffer
+ * fills.  Throws if an earlier write failed.
+ */
+void AsyncWriter::write(const char *s, size_t len) {
+	while(len > 0) {
+		AioRequest& r = reqs_[head_];
+		if(r.busy) {
+			// Buffer's still being written from last time round
+			reap(r);
+		}
+		if(failed_) {
+			cerr << "Error while flushing and closing output" << endl;
+			throw 1;
+		}
+		size_t n = std::min(len, chunk_ - cur_);
+		memcpy(r.buf + cur_, s, n);
+		cur_ += n;
+		s += n;
+		len -= n;
+		if(cur_ == chunk_) {
+			submitCurrent();
+		}
+	}
+}
+
+/**
+ * Start writing the current buffer and move on to the next one.
+ */
+void AsyncWriter::submitCurrent() {
+	assert_gt(cur_, 0);
+	AioRequest& r = reqs_[head_];
+	r.len = cur_;
+	r.off = off_;
+	io_->submit(r);
+	off_ += (int64_t)cur_;
+	cur_ = 0;
+	head_ = (head_ + 1) % reqs_.size();
+}
+
+/**
+ * Wait for the given write and note whether it failed.
+ */
+void AsyncWriter::reap(AioRequest& r) {
+	io_->wait(r);
+	if(r.err != 0 || (size_t)r.res != r.len) {
+		if(!failed_) {
+			cerr << "Error: Could not write output: "
+			     << strerror(r.err != 0 ? r.err : EIO) << endl;
+		}
+		failed_ = true;
+	}
+}
+
+/**
+ * Start writing whatever is buffered, wait for every write to finish and
+ * return false if any failed.
+ */
+bool AsyncWriter::drain() {
+	if(cur_ > 0) {
+		submitCurrent();
+	}
+	for(size_t i = 0; i < reqs_.size(); i++) {
+		if(reqs_[i].busy) {
+			reap(reqs_[i]);
+		}
+	}
+	return !failed_;
+}
+
+#endif /*ndef _WIN32*/
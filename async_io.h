@@ -0,0 +1,219 @@
+/*
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of Bowtie 2.
+ *
+ * Bowtie 2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bowtie 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bowtie 2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * async_io.h
+ *
+ * Read-ahead and write-behind for --async-io.  An AsyncReader keeps
+ * several large reads of a file in flight ahead of the parser, and an
+ * AsyncWriter hands full buffers of output off to be written while the
+ * caller carries on, so whichever thread holds the input or output lock
+ * doesn't sit waiting on slow storage (e.g. a network filesystem) with
+ * everyone else queued behind it.
+ *
+ * Requests go to an AsyncIo backend.  On Linux builds with WITH_IO_URING
+ * the backend is an io_uring set up with raw system calls; if the kernel
+ * refuses to set one up (too old, or disabled in a container) or on other
+ * platforms, a helper thread issues plain pread()/pwrite() calls instead.
+ * Each reader or writer has its own backend and is only ever used by one
+ * thread at a time, under the caller's lock.
+ */
+
+#ifndef ASYNC_IO_H_
+#define ASYNC_IO_H_
+
+#ifndef _WIN32
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include "ds.h"
+#include "mem_ids.h"
+
+/**
+ * A read or write of one buffer at a given file offset.
+ */
+struct AioRequest {
+
+	AioRequest() : fd(-1), write(false), buf(NULL), len(0), off(0), res(0), err(0), busy(false), done(false) { }
+
+	int     fd;
+	bool    write;  // write rather than read
+	char   *buf;
+	size_t  len;
+	int64_t off;
+	ssize_t res;    // bytes transferred, once complete
+	int     err;    // errno if it failed, 0 otherwise
+	bool    busy;   // submitted and not yet waited for
+	bool    done;   // the backend has finished with it
+	struct iovec iov; // for backends that take a vector
+};
+
+/**
+ * Backend that carries out requests in the background.
+ */
+class AsyncIo {
+
+public:
+
+	virtual ~AsyncIo() { }
+
+	/**
+	 * Start carrying out 'r'.
+	 */
+	virtual void submit(AioRequest& r) = 0;
+
+	/**
+	 * Wait for 'r' to finish.  A read is complete when 'len' bytes have
+	 * been read or the end of the file is reached, a write when all 'len'
+	 * bytes are written or an error occurs.
+	 */
+	virtual void wait(AioRequest& r) = 0;
+
+	/**
+	 * Return the name of the backend, for verbose output.
+	 */
+	virtual const char *name() const = 0;
+
+	/**
+	 * Make the best backend available that can keep 'depth' requests in
+	 * flight.
+	 */
+	static AsyncIo *create(int depth);
+
+protected:
+
+	/**
+	 * Finish a short read or write of 'r' with blocking calls.
+	 */
+	static void finish(AioRequest& r);
+};
+
+/**
+ * Reads a file in chunks, keeping the next few in flight.
+ */
+class AsyncReader {
+
+public:
+
+	/**
+	 * Read file descriptor 'fd' starting at offset 'off', 'depth' chunks
+	 * of 'chunk' bytes ahead.
+	 */
+	AsyncReader(int fd, int64_t off, size_t chunk = 1024 * 1024, int depth = 4);
+
+	~AsyncReader();
+
+	/**
+	 * Return the next chunk of the file in 'buf' and 'len'; the caller may
+	 * use it (and write to it) until the next call.  Returns false at the
+	 * end of the file.
+	 */
+	bool next(char*& buf, size_t& len);
+
+	/**
+	 * Return the file offset of the start of the chunk last returned by
+	 * next(), or of the end of the file once next() has returned false.
+	 */
+	int64_t offset() const { return curOff_; }
+
+	/**
+	 * Return the name of the backend.
+	 */
+	const char *backend() const { return io_->name(); }
+
+protected:
+
+	void submit(AioRequest& r);
+
+	AsyncIo            *io_;
+	int                 fd_;
+	size_t              chunk_;
+	EList<AioRequest>   reqs_;   // one per chunk, used round-robin
+	EList<char>         bufs_;   // chunk buffers, back to back
+	size_t              head_;   // request whose data is returned next
+	int64_t             nextOff_; // offset of the next chunk to request
+	int64_t             curOff_;  // offset of the chunk last returned
+	bool                eof_;    // a short read has been seen
+	bool                handed_; // a chunk is out with the caller
+};
+
+/**
+ * Collects output into large buffers and writes them in the background.
+ */
+class AsyncWriter {
+
+public:
+
+	/**
+	 * Write to file descriptor 'fd' starting at offset 'off', with up to
+	 * 'depth' buffers of 'chunk' bytes being written at once.
+	 */
+	AsyncWriter(int fd, int64_t off, size_t chunk = 1024 * 1024, int depth = 4);
+
+	~AsyncWriter();
+
+	/**
+	 * Append 'len' bytes to the output.
+	 */
+	void write(const char *s, size_t len);
+
+	/**
+	 * Start writing whatever is buffered, wait for every write to finish
+	 * and return false if any failed.
+	 */
+	bool drain();
+
+	/**
+	 * Return the length of the output so far, counting buffered bytes.
+	 */
+	int64_t tell() const { return off_ + (int64_t)cur_; }
+
+	/**
+	 * Return the name of the backend.
+	 */
+	const char *backend() const { return io_->name(); }
+
+protected:
+
+	/**
+	 * Start writing the current buffer and move on to the next one.
+	 */
+	void submitCurrent();
+
+	/**
+	 * Wait for the given request and report a failed write.
+	 */
+	void reap(AioRequest& r);
+
+	AsyncIo            *io_;
+	int                 fd_;
+	size_t              chunk_;
+	EList<AioRequest>   reqs_;   // one per buffer, used round-robin
+	EList<char>         bufs_;   // buffers, back to back
+	size_t              head_;   // buffer being filled
+	size_t              cur_;    // bytes in it
+	int64_t             off_;    // file offset of its first byte
+	bool                failed_; // a write failed
+};
+
+#endif /*ndef _WIN32*/
+
+#endif /*ndef ASYNC_IO_H_*/
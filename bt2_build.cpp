@@ -67,6 +67,8 @@ static bool justRef;
 static bool reverseEach;
 static int nthreads;
 static string wrapper;
+static int repK;          // k for repeat k-mer table (.rep file); 0 = none
+static uint64_t repMin;   // min # occurrences for a k-mer to be in .rep file
 
 static void resetOptions() {
 	verbose      = true;  // be talkative (default)
@@ -96,6 +98,8 @@ static void resetOptions() {
 	reverseEach  = false;
     nthreads     = 1;
 	wrapper.clear();
+	repK         = 0;     // don't write a repeat k-mer table
+	repMin       = 100;   // k-mers occurring >= 100 times go in the table
 }
 
 // Argument constants for getopts
@@ -112,7 +116,9 @@ enum {
 	ARG_REVERSE_EACH,
 	ARG_SA,
     ARG_THREADS,
-	ARG_WRAPPER
+	ARG_WRAPPER,
+	ARG_REP_K,
+	ARG_REP_MIN
 };
 
 /**
@@ -155,6 +161,8 @@ static void printUsage(ostream& out) {
 	    << "    -o/--offrate <int>      SA is sampled every 2^<int> BWT chars (default: 5)" << endl
 	    << "    -t/--ftabchars <int>    # of chars consumed in initial lookup (default: 10)" << endl
         << "    --threads <int>         # of threads" << endl
+	    << "    --rep-k <int>           write table of repeated <int>-mers (max 32) to .rep" << endl
+	    << "    --rep-min <int>         min # occurrences for --rep-k table (default: 100)" << endl
 	    //<< "    --ntoa                  convert Ns in reference to As" << endl
 	    //<< "    --big --little          endianness (default: little, this host: "
 	    //<< (currentlyBigEndian()? "big":"little") << ")" << endl
@@ -204,6 +212,8 @@ static struct option long_options[] = {
     {(char*)"threads",      required_argument, 0,            ARG_THREADS},
 	{(char*)"usage",        no_argument,       0,            ARG_USAGE},
 	{(char*)"wrapper",      required_argument, 0,            ARG_WRAPPER},
+	{(char*)"rep-k",        required_argument, 0,            ARG_REP_K},
+	{(char*)"rep-min",      required_argument, 0,            ARG_REP_MIN},
 	{(char*)0, 0, 0, 0} // terminator
 };
 
@@ -305,6 +315,17 @@ static bool parseOptions(int argc, const char **argv) {
             case ARG_THREADS:
                 nthreads = parseNumber<int>(0, "--threads arg must be at least 1");
                 break;
+			case ARG_REP_K:
+				repK = parseNumber<int>(1, "--rep-k arg must be at least 1");
+				if(repK > 32) {
+					cerr << "--rep-k arg must be at most 32" << endl;
+					printUsage(cerr);
+					throw 1;
+				}
+				break;
+			case ARG_REP_MIN:
+				repMin = parseNumber<uint64_t>(2, "--rep-min arg must be at least 2");
+				break;
 			case 'a': autoMem = false; break;
 			case 'q': verbose = false; break;
 			case 's': sanityCheck = true; break;
@@ -448,6 +469,9 @@ static void driver(
 	// Construct index from input strings and parameters
 	filesWritten.push_back(outfile + ".1." + gEbwt_ext);
 	filesWritten.push_back(outfile + ".2." + gEbwt_ext);
+	if(!reverse && repK > 0) {
+		filesWritten.push_back(outfile + ".rep." + gEbwt_ext);
+	}
 	Ebwt ebwt(
 		TStr(),
 		packed,
@@ -474,7 +498,9 @@ static void driver(
 		doBwtFile,    // make a file with just the BWT string in it
 		verbose,      // be talkative
 		autoMem,      // pass exceptions up to the toplevel so that we can adjust memory settings automatically
-		sanityCheck); // verify results and internal consistency
+		sanityCheck,  // verify results and internal consistency
+		reverse ? 0 : repK, // repeat k-mer table, forward index only
+		repMin);      // min count for repeat k-mer table
 	// Note that the Ebwt is *not* resident in memory at this time.  To
 	// load it into memory, call ebwt.loadIntoMemory()
 	if(verbose) {
@@ -54,6 +54,7 @@
 #include "random_source.h"
 #include "mem_ids.h"
 #include "btypes.h"
+#include "ref_repeats.h"
 
 #ifdef POPCNT_CAPABILITY 
     #include "processor_support.h" 
@@ -507,6 +508,8 @@ public:
 	    _ftab(EBWT_CAT), \
 	    _eftab(EBWT_CAT), \
 	    _offs(EBWT_CAT), \
+	    _offsPk(EBWT_CAT), \
+	    _offsBits(0), \
 	    _ebwt(EBWT_CAT), \
 	    _useMm(false), \
 	    useShmem_(false), \
@@ -598,7 +601,9 @@ public:
 		bool doBwtFile = false,
 		bool verbose = false,
 		bool passMemExc = false,
-		bool sanityCheck = false) :
+		bool sanityCheck = false,
+		int repK = 0,         // k for repeat k-mer table; 0 = no table
+		uint64_t repMin = 0) : // min count for a k-mer to be in the table
 		Ebwt_INITS,
 		_eh(
 			joinedLen(szs),
@@ -651,6 +656,17 @@ public:
 				throw 1;
 			}
 		}
+		ofstream *repOut = NULL;
+		if(repK > 0) {
+			string repStr = file + ".rep." + gEbwt_ext;
+			repOut = new ofstream(repStr.c_str(), ios::binary);
+			if(!repOut->good()) {
+				cerr << "Could not open repeat k-mer file for writing: \"" << repStr.c_str() << "\"" << endl
+			         << "Please make sure the directory exists and that permissions allow writing by" << endl
+			         << "Bowtie." << endl;
+				throw 1;
+			}
+		}
 		// Build SA(T) and BWT(T) block by block
 		initFromVector<TStr>(
 			is,
@@ -662,6 +678,9 @@ public:
                              file,
 			saOut,
 			bwtOut,
+			repOut,
+			repK,
+			repMin,
             nthreads,
 		    useBlockwise,
 		    bmax,
@@ -716,6 +735,16 @@ public:
 					 << " but is actually " << fileSize(_inBwtStr.c_str()) << "." << endl;
 			}
 		}
+
+		if(repOut != NULL) {
+			repOut->flush();
+			if(repOut->fail()) {
+				err = true;
+				cerr << "An error occurred writing the repeat k-mer table to disk." << endl;
+			}
+			repOut->close();
+			delete repOut;
+		}
 		
 		if(err) {
 			cerr << "Please check if there is a problem with the disk or if disk is full." << endl;
@@ -924,6 +953,9 @@ public:
                         const string& outfile,
 	                    ofstream* saOut,
 	                    ofstream* bwtOut,
+	                    ofstream* repOut,
+	                    int repK,
+	                    uint64_t repMin,
                         int nthreads,
 	                    bool useBlockwise,
 	                    TIndexOffU bmax,
@@ -1080,7 +1112,19 @@ public:
 				assert(bsa.suffixItrIsReset());
 				assert_eq(bsa.size(), s.length()+1);
 				VMSG_NL("Converting suffix-array elements to index image");
-				buildToDisk(bsa, s, out1, out2, saOut, bwtOut);
+				RepeatKmerText repText;
+				if(repOut != NULL) {
+					// Repeat k-mers are only counted for the forward index,
+					// whose fragments are in the same order as szs
+					assert_neq(refparams.reverse, REF_READ_REVERSE);
+					VMSG_NL("Packing reference for repeat " << repK << "-mer counting");
+					EList<TIndexOffU> fragLens(EBWTB_CAT);
+					for(size_t i = 0; i < szs.size(); i++) {
+						if(szs[i].len > 0) fragLens.push_back(szs[i].len);
+					}
+					repText.init(s, fragLens, repK);
+				}
+				buildToDisk(bsa, s, out1, out2, saOut, bwtOut, repOut, &repText, repMin);
 				out1.flush(); out2.flush();
 				bool failed = out1.fail() || out2.fail();
 				if(saOut != NULL) {
@@ -1144,6 +1188,7 @@ public:
 		_plen.reset();
 		_rstarts.reset();
 		_offs.reset();
+		_offsPk.reset();
 		_ebwt.reset();
 		if(offs() != NULL && useShmem_) {
 			FREE_SHARED(offs());
@@ -1176,6 +1221,48 @@ public:
 	inline const TIndexOffU* plen() const    { return _plen.get(); }
 	inline const TIndexOffU* rstarts() const { return _rstarts.get(); }
 	inline const uint8_t*  ebwt() const    { return _ebwt.get(); }
+	int         offsBits() const     { return _offsBits; }
+
+	/**
+	 * Return true iff the SA sample is loaded, either as a plain array
+	 * or bit-packed.
+	 */
+	bool offsLoaded() const {
+		return offs() != NULL || _offsPk.get() != NULL;
+	}
+
+	/**
+	 * Return element i of the SA sample.  When the sample is bit-packed,
+	 * entry i occupies bits [i*_offsBits, (i+1)*_offsBits) of _offsPk,
+	 * least significant bit first; _offsBits is at most 57, so one
+	 * unaligned 8-byte load always covers it.
+	 */
+	inline TIndexOffU offsAt(TIndexOffU i) const {
+		if(_offsBits == 0) {
+			return offs()[i];
+		}
+		uint64_t bit = (uint64_t)i * _offsBits;
+		uint64_t w;
+		memcpy(&w, _offsPk.get() + (bit >> 3), 8);
+		return (TIndexOffU)((w >> (bit & 7)) & (((uint64_t)1 << _offsBits) - 1));
+	}
+
+	/**
+	 * Set element i of the SA sample to 'off'.
+	 */
+	inline void setOffsAt(TIndexOffU i, TIndexOffU off) {
+		if(_offsBits == 0) {
+			offs()[i] = off;
+			return;
+		}
+		uint64_t bit = (uint64_t)i * _offsBits;
+		uint8_t *p = _offsPk.get() + (bit >> 3);
+		uint64_t mask = (((uint64_t)1 << _offsBits) - 1) << (bit & 7);
+		uint64_t w;
+		memcpy(&w, p, 8);
+		w = (w & ~mask) | (((uint64_t)off << (bit & 7)) & mask);
+		memcpy(p, &w, 8);
+	}
 	bool        toBe() const         { return _toBigEndian; }
 	bool        verbose() const      { return _verbose; }
 	bool        sanityCheck() const  { return _sanity; }
@@ -1227,7 +1314,7 @@ public:
 			assert(ftab() == NULL);
 			assert(eftab() == NULL);
 			assert(fchr() == NULL);
-			assert(offs() == NULL);
+			assert(!offsLoaded());
 			assert(rstarts() == NULL);
 			assert_eq(_zEbwtByteOff, OFF_MASK);
 			assert_eq(_zEbwtBpOff, -1);
@@ -1276,6 +1363,8 @@ public:
 		_eftab.free();
 		_rstarts.free();
 		_offs.free(); // might not be under control of APtrWrap
+		_offsPk.free();
+		_offsBits = 0;
 		_ebwt.free(); // might not be under control of APtrWrap
 		// Keep plen; it's small and the client may want to seq it
 		// even when the others are evicted.
@@ -1440,12 +1529,12 @@ public:
 	 * it cannot be resolved immediately, return max value.
 	 */
 	TIndexOffU tryOffset(TIndexOffU elt) const {
-		assert(offs() != NULL);
+		assert(offsLoaded());
 		if(elt == _zOff) return 0;
 		if((elt & _eh._offMask) == elt) {
 			TIndexOffU eltOff = elt >> _eh._offRate;
 			assert_lt(eltOff, _eh._offsLen);
-			TIndexOffU off = offs()[eltOff];
+			TIndexOffU off = offsAt(eltOff);
 			assert_neq(OFF_MASK, off);
 			return off;
 		} else {
@@ -1574,10 +1663,14 @@ public:
 			out << "non-NULL, [0] = " << eftab()[0] << endl;
 		}
 		out << "    offs: ";
-		if(offs() == NULL) {
+		if(!offsLoaded()) {
 			out << "NULL" << endl;
 		} else {
-			out << "non-NULL, [0] = " << offs()[0] << endl;
+			out << "non-NULL, [0] = " << offsAt(0);
+			if(_offsBits > 0) {
+				out << " (packed, " << _offsBits << " bits/entry)";
+			}
+			out << endl;
 		}
 	}
 
@@ -1585,7 +1678,7 @@ public:
 	template <typename TStr> static TStr join(EList<TStr>& l, uint32_t seed);
 	template <typename TStr> static TStr join(EList<FileBuf*>& l, EList<RefRecord>& szs, TIndexOffU sztot, const RefReadInParams& refparams, uint32_t seed);
 	template <typename TStr> void joinToDisk(EList<FileBuf*>& l, EList<RefRecord>& szs, TIndexOffU sztot, const RefReadInParams& refparams, TStr& ret, ostream& out1, ostream& out2);
-	template <typename TStr> void buildToDisk(InorderBlockwiseSA<TStr>& sa, const TStr& s, ostream& out1, ostream& out2, ostream* saOut, ostream* bwtOut);
+	template <typename TStr> void buildToDisk(InorderBlockwiseSA<TStr>& sa, const TStr& s, ostream& out1, ostream& out2, ostream* saOut, ostream* bwtOut, ostream* repOut = NULL, const RepeatKmerText* repText = NULL, uint64_t repMin = 0);
 
 	// I/O
 	void readIntoMemory(int color, int needEntireRev, bool loadSASamp, bool loadFtab, bool loadRstarts, bool justHeader, EbwtParams *params, bool mmSweep, bool loadNames, bool startVerbose);
@@ -2397,6 +2490,11 @@ template<typename Operation>
 	// offset every 16 rows), the total size of _offs is the same as
 	// the total size of the input sequence
 	APtrWrap<TIndexOffU> _offs;
+	// When the index is loaded into private memory, the SA sample is
+	// held here instead, packed to just enough bits to hold an offset
+	// into the joined text (see offsAt()).  _offsBits is 0 otherwise.
+	APtrWrap<uint8_t> _offsPk;
+	int        _offsBits;
 	// _ebwt is the Extended Burrows-Wheeler Transform itself, and thus
 	// is at least as large as the input sequence.
 	APtrWrap<uint8_t> _ebwt;
@@ -2704,7 +2802,10 @@ void Ebwt::buildToDisk(
 	ostream& out1,
 	ostream& out2,
 	ostream* saOut,
-	ostream* bwtOut)
+	ostream* bwtOut,
+	ostream* repOut,
+	const RepeatKmerText* repText,
+	uint64_t repMin)
 {
 	const EbwtParams& eh = this->_eh;
 
@@ -2731,6 +2832,13 @@ void Ebwt::buildToDisk(
 	// cutoff.
 	uint8_t absorbCnt = 0;
 	EList<uint8_t> absorbFtab(EBWT_CAT);
+
+	// Suffixes that share their first k characters are adjacent in the
+	// suffix array, so a k-mer's count is the length of its run
+	const int repK = (repOut != NULL) ? repText->k() : 0;
+	assert_leq(repK, 32);
+	EList<uint64_t> repKmers(EBWTB_CAT), repCounts(EBWTB_CAT);
+	uint64_t repCur = 0, repRun = 0;
 	try {
 		VMSG_NL("Allocating ftab, absorbFtab");
 		ftab.resize(ftabLen);
@@ -2876,6 +2984,21 @@ void Ebwt::buildToDisk(
 					assert_lt(absorbCnt, 255);
 					absorbCnt++;
 				}
+				// Update repeat k-mer runs; a k-mer that spans two fragments
+				// isn't in the reference, and skipping it doesn't split a run
+				uint64_t kmer = 0;
+				if(repOut != NULL && repText->get(saElt, kmer)) {
+					if(repRun > 0 && kmer == repCur) {
+						repRun++;
+					} else {
+						if(repRun >= repMin) {
+							repKmers.push_back(repCur);
+							repCounts.push_back(repRun);
+						}
+						repCur = kmer;
+						repRun = 1;
+					}
+				}
 				// Suffix array offset boundary? - update offset array
 				if((si & eh._offMask) == si) {
 					assert_lt((si >> eh._offRate), eh._offsLen);
@@ -3040,6 +3163,16 @@ void Ebwt::buildToDisk(
 		writeU<TIndexOffU>(out1, eftab[i], this->toBe());
 	}
 
+	// Write repeat k-mer table
+	if(repOut != NULL) {
+		if(repRun > 0 && repRun >= repMin) {
+			repKmers.push_back(repCur);
+			repCounts.push_back(repRun);
+		}
+		VMSG_NL("Writing " << repKmers.size() << " repeat " << repK << "-mers");
+		RepeatKmers::write(*repOut, repK, repMin, repKmers, repCounts, this->toBe());
+	}
+
 	// Note: if you'd like to sanity-check the Ebwt, you'll have to
 	// read it back into memory first!
 	assert(!isInMemory());
@@ -21,14 +21,21 @@
 
 #include <string>
 #include <iostream>
+#include <fstream>
+#include <cmath>
 #include <getopt.h>
 #include <stdexcept>
+#ifdef WITH_TBB
+#include <tbb/task_group.h>
+#endif
 
 #include "assert_helpers.h"
 #include "endian_swap.h"
 #include "bt2_idx.h"
 #include "reference.h"
 #include "ds.h"
+#include "alphabet.h"
+#include "random_source.h"
 
 using namespace std;
 
@@ -37,14 +44,23 @@ int verbose             = 0;  // be talkative
 static int names_only   = 0;  // just print the sequence names in the index
 static int summarize_only = 0; // just print summary of index and quit
 static int across       = 60; // number of characters across in FASTA output
+static int nthreads     = 1;  // threads for writing sequences
 static bool refFromEbwt = false; // true -> when printing reference, decode it from Ebwt instead of reading it from BitPairReference
+static int stats_only   = 0;  // just print index statistics and tuning advice
+static string statsReads;     // sample of reads to model seed search with
+static int statsSeedLen = 22; // seed length to model
+static uint64_t statsMemMb = 0; // memory budget in MB; 0 = index's own footprint
 static string wrapper;
-static const char *short_options = "vhnsea:";
+static const char *short_options = "vhnsea:p:";
 
 enum {
 	ARG_VERSION = 256,
 	ARG_WRAPPER,
 	ARG_USAGE,
+	ARG_STATS,
+	ARG_STATS_READS,
+	ARG_STATS_SEED_LEN,
+	ARG_STATS_MEM,
 };
 
 static struct option long_options[] = {
@@ -56,7 +72,12 @@ static struct option long_options[] = {
 	{(char*)"help",     no_argument,        0, 'h'},
 	{(char*)"across",   required_argument,  0, 'a'},
 	{(char*)"ebwt-ref", no_argument,        0, 'e'},
+	{(char*)"threads",  required_argument,  0, 'p'},
 	{(char*)"wrapper",  required_argument,  0, ARG_WRAPPER},
+	{(char*)"stats",    no_argument,        0, ARG_STATS},
+	{(char*)"stats-reads",    required_argument, 0, ARG_STATS_READS},
+	{(char*)"stats-seed-len", required_argument, 0, ARG_STATS_SEED_LEN},
+	{(char*)"stats-mem",      required_argument, 0, ARG_STATS_MEM},
 	{(char*)0, 0, 0, 0} // terminator
 };
 
@@ -71,7 +92,8 @@ static void printUsage(ostream& out) {
 	<< endl
 	<< "  By default, prints FASTA records of the indexed nucleotide sequences to" << endl
 	<< "  standard out.  With -n, just prints names.  With -s, just prints a summary of" << endl
-	<< "  the index parameters and sequences." << endl
+	<< "  the index parameters and sequences.  With --stats, prints statistics about" << endl
+	<< "  the index's lookup structures and suggests offrate/ftabchars settings." << endl
 	<< endl
 	<< "Options:" << endl;
 	if(wrapper == "basic-0") {
@@ -80,7 +102,13 @@ static void printUsage(ostream& out) {
 	}
 	out << "  -a/--across <int>  Number of characters across in FASTA output (default: 60)" << endl
 	<< "  -n/--names         Print reference sequence names only" << endl
+	<< "  -p/--threads <int> # of threads for writing sequences (default: 1)" << endl
 	<< "  -s/--summary       Print summary incl. ref names, lengths, index properties" << endl
+	<< "  --stats            Print ftab, SA sample and repeat statistics, and suggest" << endl
+	<< "                     offrate/ftabchars for a memory budget" << endl
+	<< "  --stats-reads <file>  FASTQ/FASTA reads to model seed searches with (--stats)" << endl
+	<< "  --stats-seed-len <int>  seed length to model (default: 22)" << endl
+	<< "  --stats-mem <int>  memory budget in MB (default: the index's own footprint)" << endl
 	<< "  -v/--verbose       Verbose output (for debugging)" << endl
 	<< "  -h/--help          print detailed description of tool and its options" << endl
 	<< "  --help             print this usage message" << endl
@@ -139,7 +167,16 @@ static void parseOptions(int argc, char **argv) {
 			case 'e': refFromEbwt = true; break;
 			case 'n': names_only = true; break;
 			case 's': summarize_only = true; break;
+			case ARG_STATS: stats_only = true; break;
+			case ARG_STATS_READS: statsReads = optarg; break;
+			case ARG_STATS_SEED_LEN:
+				statsSeedLen = parseInt(1, "--stats-seed-len arg must be at least 1");
+				break;
+			case ARG_STATS_MEM:
+				statsMemMb = (uint64_t)parseInt(1, "--stats-mem arg must be at least 1");
+				break;
 			case 'a': across = parseInt(-1, "-a/--across arg must be at least 1"); break;
+			case 'p': nthreads = parseInt(1, "-p/--threads arg must be at least 1"); break;
 			case -1: break; /* Done with options. */
 			case 0:
 				if (long_options[option_index].flag != 0)
@@ -151,65 +188,313 @@ static void parseOptions(int argc, char **argv) {
 	} while(next_option != -1);
 }
 
-static void print_fasta_record(
-	ostream& fout,
-	const string& defline,
-	const string& seq)
-{
-	fout << ">";
-	fout << defline.c_str() << endl;
+// Bases per unit of work when writing sequences with several threads
+static const size_t FASTA_CHUNK = 4 * 1024 * 1024;
 
-	if(across > 0) {
+#ifdef WITH_TBB
+/**
+ * Wraps a worker function so it can be run in a tbb::task_group.
+ */
+class InspectWorker {
+	void (*fn_)(void *);
+	void *vp_;
+
+public:
+
+	InspectWorker(const InspectWorker& W): fn_(W.fn_), vp_(W.vp_) {};
+	InspectWorker(void (*fn)(void *), void *vp): fn_(fn), vp_(vp) {};
+	void operator()() const { fn_(vp_); }
+};
+#endif
+
+/**
+ * Run 'fn' on 'n' threads and wait for them all to finish.  Each call of
+ * 'fn' takes work from 'vp' until there's none left.
+ */
+static void run_workers(void (*fn)(void *), void *vp, int n) {
+	if(n <= 1) {
+		fn(vp);
+		return;
+	}
+#ifdef WITH_TBB
+	tbb::task_group tbb_grp;
+	for(int i = 0; i < n; i++) {
+		tbb_grp.run(InspectWorker(fn, vp));
+	}
+	tbb_grp.wait();
+#else
+	EList<tthread::thread*> threads;
+	for(int i = 0; i < n; i++) {
+		threads.push_back(new tthread::thread(fn, vp));
+	}
+	for(int i = 0; i < n; i++) {
+		threads[i]->join();
+		delete threads[i];
+	}
+#endif
+}
+
+/**
+ * A stretch [beg, end) of the joined text, restored by walking left from
+ * BWT row 'row', whose suffix starts at 'end'.
+ */
+struct RestoreSeg {
+	TIndexOffU row;
+	TIndexOffU beg;
+	TIndexOffU end;
+};
+
+/**
+ * Work shared by the threads restoring the joined text.
+ */
+struct RestoreJob {
+	const Ebwt *ebwt;
+	char *text;
+	const EList<RestoreSeg> *segs;
+	size_t next; // next segment to restore
+	MUTEX_T lock;
+};
+
+/**
+ * Restore segments from a RestoreJob until there are none left.
+ */
+static void restore_worker(void *vp) {
+	RestoreJob& job = *(RestoreJob*)vp;
+	const Ebwt& ebwt = *job.ebwt;
+	while(true) {
 		size_t i = 0;
-		while (i + across < seq.length())
 		{
-			fout << seq.substr(i, across).c_str() << endl;
-			i += across;
+			ThreadSafe ts(job.lock);
+			if(job.next == job.segs->size()) break;
+			i = job.next++;
+		}
+		const RestoreSeg& seg = (*job.segs)[i];
+		SideLocus l(seg.row, ebwt.eh(), ebwt.ebwt());
+		for(TIndexOffU off = seg.end; off > seg.beg; off--) {
+			job.text[off-1] = (char)ebwt.rowL(l);
+			TIndexOffU row = ebwt.mapLF(l ASSERT_ONLY(, false));
+			l.initFromRow(row, ebwt.eh(), ebwt.ebwt());
 		}
-		if (i < seq.length())
-			fout << seq.substr(i).c_str() << endl;
-	} else {
-		fout << seq.c_str() << endl;
 	}
 }
 
 /**
- * Given output stream, BitPairReference, reference index, name and
- * length, print the whole nucleotide reference with the appropriate
- * number of columns.
+ * Restore the joined text like Ebwt::restore(), but with several threads
+ * each walking left from a different sampled row.  Each walk starts from
+ * the furthest-right sample in one of many equal stretches of the text and
+ * stops where the walk before it started, so the walks cover the text
+ * between them.
  */
-static void print_ref_sequence(
-	ostream& fout,
-	BitPairReference& ref,
-	const string& name,
-	size_t refi,
-	size_t len)
-{
+static void restore_text(const Ebwt& ebwt, SString<char>& s) {
+	if(nthreads <= 1) {
+		ebwt.restore(s);
+		return;
+	}
+	const EbwtParams& eh = ebwt.eh();
+	TIndexOffU len = eh.len();
+	s.resize(len);
+	size_t nsegs = (size_t)nthreads * 16;
+	EList<RestoreSeg> segs;
+	segs.resize(nsegs + 1);
+	for(size_t i = 0; i <= nsegs; i++) {
+		segs[i].row = OFF_MASK;
+		segs[i].end = 0;
+	}
+	for(TIndexOffU i = 0; i < eh.offsLen(); i++) {
+		TIndexOffU off = ebwt.offsAt(i);
+		if(off == 0 || off >= len) continue;
+		size_t b = (size_t)((uint64_t)off * nsegs / len);
+		if(segs[b].row == OFF_MASK || off > segs[b].end) {
+			segs[b].row = i << eh.offRate();
+			segs[b].end = off;
+		}
+	}
+	// The last walk starts from the '$' row, as Ebwt::restore() does
+	segs[nsegs].row = len;
+	segs[nsegs].end = len;
+	size_t n = 0;
+	TIndexOffU prev = 0;
+	for(size_t i = 0; i <= nsegs; i++) {
+		if(segs[i].row == OFF_MASK) continue;
+		segs[i].beg = prev;
+		prev = segs[i].end;
+		segs[n++] = segs[i];
+	}
+	segs.resize(n);
+	RestoreJob job;
+	job.ebwt = &ebwt;
+	job.text = s.wbuf();
+	job.segs = &segs;
+	job.next = 0;
+	run_workers(restore_worker, &job, nthreads);
+}
+
+/**
+ * One FASTA record to write: a reference's name and length, and when
+ * decoding from the Ebwt, the range of its fragments in rstarts.
+ */
+struct FastaRec {
+	size_t refi;           // reference index
+	const string *name;
+	size_t len;
+	TIndexOffU fragBeg;    // first fragment (-e only)
+	TIndexOffU fragEnd;    // one past the last fragment (-e only)
+};
+
+/**
+ * Bases [off, off+len) of one record, and the FASTA text for them,
+ * starting with the header line if 'off' is 0.
+ */
+struct FastaChunk {
+	size_t rec;
+	size_t off;
+	size_t len;
+	string out;
+};
+
+/**
+ * Work shared by the threads formatting FASTA.  Sequence comes from
+ * 'ref' if it's non-NULL, otherwise from 'text', the restored joined text
+ * of 'ebwt'.
+ */
+struct FastaJob {
+	const EList<FastaRec> *recs;
+	EList<FastaChunk> *chunks;
+	BitPairReference *ref;
+	const Ebwt *ebwt;
+	const SString<char> *text;
+	size_t next; // next chunk to format
+	MUTEX_T lock;
+};
+
+/**
+ * Append bases [c.off, c.off+c.len) of a reference read from the
+ * BitPairReference, broken into lines as print_ref_sequence always has:
+ * every 'across' bases, and after every 1000 lines' worth even when
+ * 'across' is 0.
+ */
+static void format_ref_chunk(BitPairReference& ref, const FastaRec& rec, FastaChunk& c) {
 	bool newlines = across > 0;
-	int myacross = across > 0 ? across : 60;
+	size_t myacross = across > 0 ? across : 60;
 	size_t incr = myacross * 1000;
 	uint32_t *buf = new uint32_t[(incr + 128)/4];
-	fout << ">" << name.c_str() << "\n";
 	ASSERT_ONLY(SStringExpandable<uint32_t> destU32);
-	for(size_t i = 0; i < len; i += incr) {
-		size_t amt = min(incr, len-i);
-		assert_leq(amt, incr);
-		int off = ref.getStretch(buf, refi, i, amt ASSERT_ONLY(, destU32));
+	for(size_t i = c.off; i < c.off + c.len; i += incr) {
+		size_t amt = min(incr, c.off + c.len - i);
+		int off = ref.getStretch(buf, rec.refi, i, amt ASSERT_ONLY(, destU32));
 		uint8_t *cb = ((uint8_t*)buf) + off;
 		for(size_t j = 0; j < amt; j++) {
-			if(newlines && j > 0 && (j % myacross) == 0) fout << "\n";
+			if(newlines && j > 0 && (j % myacross) == 0) c.out.push_back('\n');
 			assert_range(0, 4, (int)cb[j]);
-			fout << "ACGTN"[(int)cb[j]];
+			c.out.push_back("ACGTN"[(int)cb[j]]);
 		}
-		fout << "\n";
+		c.out.push_back('\n');
 	}
 	delete [] buf;
 }
 
+/**
+ * Append bases [c.off, c.off+c.len) of a reference laid out from its
+ * fragments of the restored joined text, with Ns in the gaps, broken into
+ * lines of 'across' bases, or one line if 'across' is 0.
+ */
+static void format_ebwt_chunk(
+	const Ebwt& ebwt,
+	const SString<char>& text,
+	const FastaRec& rec,
+	FastaChunk& c)
+{
+	string bases(c.len, 'N');
+	const TIndexOffU *rstarts = ebwt.rstarts();
+	size_t cend = c.off + c.len;
+	for(TIndexOffU k = rec.fragBeg; k < rec.fragEnd; k++) {
+		TIndexOffU jbeg = rstarts[k*3];
+		TIndexOffU jend = (k+1 == ebwt.nFrag()) ? ebwt.eh().len() : rstarts[(k+1)*3];
+		size_t tbeg = rstarts[k*3+2];
+		size_t tend = tbeg + (jend - jbeg);
+		for(size_t t = max(tbeg, c.off); t < min(tend, cend); t++) {
+			bases[t - c.off] = "ACGT"[(int)text[jbeg + (t - tbeg)]];
+		}
+	}
+	if(across > 0) {
+		for(size_t i = 0; i < c.len; i += across) {
+			c.out.append(bases, i, across);
+			c.out.push_back('\n');
+		}
+	} else {
+		c.out += bases;
+		if(cend == rec.len) c.out.push_back('\n');
+	}
+}
+
+/**
+ * Format chunks from a FastaJob until there are none left.
+ */
+static void fasta_worker(void *vp) {
+	FastaJob& job = *(FastaJob*)vp;
+	while(true) {
+		size_t i = 0;
+		{
+			ThreadSafe ts(job.lock);
+			if(job.next == job.chunks->size()) break;
+			i = job.next++;
+		}
+		FastaChunk& c = (*job.chunks)[i];
+		const FastaRec& rec = (*job.recs)[c.rec];
+		c.out.clear();
+		if(c.off == 0) {
+			c.out.push_back('>');
+			c.out += *rec.name;
+			c.out.push_back('\n');
+		}
+		if(job.ref != NULL) {
+			format_ref_chunk(*job.ref, rec, c);
+		} else {
+			format_ebwt_chunk(*job.ebwt, *job.text, rec, c);
+		}
+	}
+}
+
+/**
+ * Write the records in 'job' as FASTA.  Records are cut into chunks of
+ * whole lines; a few chunks per thread are formatted at a time and then
+ * written in order.
+ */
+static void print_fasta_records(ostream& fout, FastaJob& job) {
+	const EList<FastaRec>& recs = *job.recs;
+	// Chunks must start on a line break; for the BitPairReference that
+	// means on a 1000-line block
+	size_t unit = (across > 0 ? across : (job.ref != NULL ? 60 : 1));
+	if(job.ref != NULL) unit *= 1000;
+	size_t chunkLen = max(unit, FASTA_CHUNK / unit * unit);
+	EList<FastaChunk> chunks;
+	job.chunks = &chunks;
+	size_t perRound = (size_t)nthreads * 4;
+	size_t rec = 0, off = 0;
+	while(rec < recs.size()) {
+		chunks.clear();
+		while(chunks.size() < perRound && rec < recs.size()) {
+			chunks.expand();
+			chunks.back().rec = rec;
+			chunks.back().off = off;
+			chunks.back().len = min(chunkLen, recs[rec].len - off);
+			off += chunks.back().len;
+			if(off >= recs[rec].len) {
+				rec++;
+				off = 0;
+			}
+		}
+		job.next = 0;
+		run_workers(fasta_worker, &job, (int)min<size_t>(nthreads, chunks.size()));
+		for(size_t i = 0; i < chunks.size(); i++) {
+			fout.write(chunks[i].out.data(), chunks[i].out.length());
+		}
+	}
+}
+
 /**
  * Create a BitPairReference encapsulating the reference portion of the
- * index at the given basename.  Iterate through the reference
- * sequences, sending each one to print_ref_sequence to print.
+ * index at the given basename and print each reference sequence in it.
  */
 static void print_ref_sequences(
 	ostream& fout,
@@ -231,80 +516,51 @@ static void print_ref_sequences(
 		verbose,              // be talkative
 		verbose);             // be talkative at startup
 	assert_eq(ref.numRefs(), refnames.size());
+	EList<FastaRec> recs;
 	for(size_t i = 0; i < ref.numRefs(); i++) {
-		print_ref_sequence(
-			fout,
-			ref,
-			refnames[i],
-			i,
-			plen[i] + (color ? 1 : 0));
+		recs.expand();
+		recs.back().refi = i;
+		recs.back().name = &refnames[i];
+		recs.back().len = plen[i] + (color ? 1 : 0);
 	}
+	FastaJob job;
+	job.recs = &recs;
+	job.ref = &ref;
+	job.ebwt = NULL;
+	job.text = NULL;
+	print_fasta_records(fout, job);
 }
 
 /**
  * Given an index, reconstruct the reference by LF mapping through the
- * entire thing.
+ * entire thing, then lay each reference out from its fragments.
+ * References that are entirely ambiguous aren't in the joined text and
+ * aren't printed.
  */
-template<typename TStr>
 static void print_index_sequences(ostream& fout, Ebwt& ebwt)
 {
-	EList<string>* refnames = &(ebwt.refnames());
-
-	TStr cat_ref;
-	ebwt.restore(cat_ref);
-
-	TIndexOffU curr_ref = OFF_MASK;
-	string curr_ref_seq = "";
-	TIndexOffU curr_ref_len = OFF_MASK;
-	TIndexOffU last_text_off = 0;
-	size_t orig_len = cat_ref.length();
-	TIndexOffU tlen = OFF_MASK;
-	bool first = true;
-	for(size_t i = 0; i < orig_len; i++) {
-		TIndexOffU tidx = OFF_MASK;
-		TIndexOffU textoff = OFF_MASK;
-		tlen = OFF_MASK;
-		bool straddled = false;
-		ebwt.joinedToTextOff(1 /* qlen */, (TIndexOffU)i, tidx, textoff, tlen, true, straddled);
-
-		if (tidx != OFF_MASK && textoff < tlen)
-		{
-			if (curr_ref != tidx)
-			{
-				if (curr_ref != OFF_MASK)
-				{
-					// Add trailing gaps, if any exist
-					if(curr_ref_seq.length() < curr_ref_len) {
-						curr_ref_seq += string(curr_ref_len - curr_ref_seq.length(), 'N');
-					}
-					print_fasta_record(fout, (*refnames)[curr_ref], curr_ref_seq);
-				}
-				curr_ref = tidx;
-				curr_ref_seq = "";
-				curr_ref_len = tlen;
-				last_text_off = 0;
-				first = true;
-			}
-
-			TIndexOffU textoff_adj = textoff;
-			if(first && textoff > 0) textoff_adj++;
-			if (textoff_adj - last_text_off > 1)
-				curr_ref_seq += string(textoff_adj - last_text_off - 1, 'N');
-
-			curr_ref_seq.push_back("ACGT"[int(cat_ref[i])]);
-			last_text_off = textoff;
-			first = false;
-		}
-	}
-	if (curr_ref < refnames->size())
-	{
-		// Add trailing gaps, if any exist
-		if(curr_ref_seq.length() < curr_ref_len) {
-			curr_ref_seq += string(curr_ref_len - curr_ref_seq.length(), 'N');
+	const EList<string>& refnames = ebwt.refnames();
+	SString<char> cat_ref;
+	restore_text(ebwt, cat_ref);
+	EList<FastaRec> recs;
+	const TIndexOffU *rstarts = ebwt.rstarts();
+	for(TIndexOffU k = 0; k < ebwt.nFrag(); k++) {
+		TIndexOffU tidx = rstarts[k*3+1];
+		if(recs.empty() || recs.back().refi != tidx) {
+			recs.expand();
+			recs.back().refi = tidx;
+			recs.back().name = &refnames[tidx];
+			recs.back().len = ebwt.plen()[tidx];
+			recs.back().fragBeg = k;
 		}
-		print_fasta_record(fout, (*refnames)[curr_ref], curr_ref_seq);
+		recs.back().fragEnd = k+1;
 	}
-
+	FastaJob job;
+	job.recs = &recs;
+	job.ref = NULL;
+	job.ebwt = &ebwt;
+	job.text = &cat_ref;
+	print_fasta_records(fout, job);
 }
 
 static char *argv0 = NULL;
@@ -363,6 +619,469 @@ static void print_index_summary(
 	}
 }
 
+// Limits on how much --stats samples, so it stays quick on large genomes
+static const size_t STATS_MAX_READS  = 10000; // reads taken from --stats-reads
+static const size_t STATS_ROW_SAMPLE = 10000; // rows sampled for seed-length repeats
+static const uint64_t STATS_MAX_HITS = 400;   // per-read cap, as --max-iters by default
+
+static const char *repClassNames[] = { "1", "2-10", "11-100", "101-1000", ">1000" };
+
+/**
+ * Return the repeat class for a k-mer occurring 'n' times.
+ */
+static int repClass(uint64_t n) {
+	if(n <= 1) return 0;
+	if(n <= 10) return 1;
+	if(n <= 100) return 2;
+	if(n <= 1000) return 3;
+	return 4;
+}
+
+/**
+ * Return floor(log2(n)) for n > 0, used to bin counts by power of two.
+ */
+static int log2Class(uint64_t n) {
+	assert_gt(n, 0);
+	int k = 0;
+	while(n > 1) {
+		n >>= 1;
+		k++;
+	}
+	return k;
+}
+
+/**
+ * Add 'by' to bin 'k' of 'hist', growing it as needed.
+ */
+static void add_to_bin(EList<uint64_t>& hist, size_t k, uint64_t by) {
+	while(hist.size() <= k) hist.push_back(0);
+	hist[k] += by;
+}
+
+/**
+ * Print one line per non-empty power-of-two bin in 'hist', labeled with
+ * the range of values it covers, followed by the matching entry of
+ * 'weights' if that's non-NULL.
+ */
+static void print_pow2_hist(
+	ostream& fout,
+	const char *key,
+	const EList<uint64_t>& hist,
+	const EList<uint64_t>* weights)
+{
+	for(size_t k = 0; k < hist.size(); k++) {
+		if(hist[k] == 0) continue;
+		fout << key << '\t' << ((uint64_t)1 << k) << '-' << (((uint64_t)1 << (k+1)) - 1)
+		     << '\t' << hist[k];
+		if(weights != NULL) {
+			fout << '\t' << (*weights)[k];
+		}
+		fout << endl;
+	}
+}
+
+/**
+ * Search for 'seq' (2-bit characters) from right to left with plain
+ * backward search, as the aligner does for an exact seed.  Set 'depth' to
+ * the number of characters matched before the range emptied and return
+ * the size of the final range.
+ */
+static TIndexOffU searchDepth(
+	const Ebwt& ebwt,
+	const char *seq,
+	size_t len,
+	size_t& depth)
+{
+	assert_gt(len, 0);
+	depth = 0;
+	int c = seq[len-1];
+	TIndexOffU top = ebwt.fchr()[c], bot = ebwt.fchr()[c+1];
+	SideLocus tloc, bloc;
+	for(size_t i = len - 1; top < bot; i--) {
+		depth++;
+		if(i == 0) break;
+		tloc.initFromRow(top, ebwt.eh(), ebwt.ebwt());
+		bloc.initFromRow(bot, ebwt.eh(), ebwt.ebwt());
+		top = ebwt.mapLF(tloc, seq[i-1]);
+		bot = ebwt.mapLF(bloc, seq[i-1]);
+	}
+	return bot - top;
+}
+
+/**
+ * Account for 'g' consecutive text offsets starting at a sampled one: from
+ * the i'th of them getOffset() takes i steps to reach the sample.
+ */
+static void add_sa_gap(
+	uint64_t g,
+	uint64_t& steps,
+	uint64_t& mx,
+	EList<uint64_t>* hist)
+{
+	steps += g * (g - 1) / 2;
+	mx = max<uint64_t>(mx, g - 1);
+	if(hist != NULL) {
+		add_to_bin(*hist, log2Class(g), 1);
+	}
+}
+
+/**
+ * Mark the text offsets that would be sampled at 'offRate', which must be
+ * at least the index's own rate, and set 'mean' and 'mx' to the mean and
+ * maximum number of LF steps getOffset() would take from a row to reach a
+ * sampled one.  The samples for a coarser rate are exactly the entries of
+ * the index's own sample whose index is a multiple of the ratio.  If
+ * 'hist' is non-NULL, also bin the gaps between consecutive samples.
+ */
+static void sa_spacing(
+	const Ebwt& ebwt,
+	int offRate,
+	EList<uint64_t>& bits,
+	double& mean,
+	uint64_t& mx,
+	EList<uint64_t>* hist)
+{
+	const EbwtParams& eh = ebwt.eh();
+	assert_geq(offRate, eh.offRate());
+	uint64_t n = eh.bwtLen(); // one text offset per row
+	uint64_t every = (uint64_t)1 << (offRate - eh.offRate());
+	bits.resizeExact((size_t)((n + 63) / 64));
+	bits.fillZero();
+	bits[0] |= 1; // getOffset() stops at the '$' row, offset 0, too
+	for(uint64_t i = 0; i < eh.offsLen(); i += every) {
+		uint64_t off = ebwt.offsAt((TIndexOffU)i);
+		assert_lt(off, n);
+		bits[off >> 6] |= (uint64_t)1 << (off & 63);
+	}
+	uint64_t prev = 0, steps = 0;
+	mx = 0;
+	for(size_t w = 0; w < bits.size(); w++) {
+		for(uint64_t word = bits[w]; word != 0; word &= word - 1) {
+			uint64_t p = w * 64 + __builtin_ctzll(word);
+			if(p == 0) continue;
+			add_sa_gap(p - prev, steps, mx, hist);
+			prev = p;
+		}
+	}
+	add_sa_gap(n - prev, steps, mx, hist);
+	mean = (double)steps / (double)n;
+}
+
+/**
+ * Bytes the SA sample takes at the given offrate, bit-packed as it is
+ * once loaded into private memory.
+ */
+static uint64_t sa_bytes(const Ebwt& ebwt, int offRate) {
+	uint64_t bits = ebwt.offsBits() > 0 ? (uint64_t)ebwt.offsBits() : OFF_SIZE * 8;
+	uint64_t offsLen = ((uint64_t)ebwt.eh().bwtLen() + ((uint64_t)1 << offRate) - 1) >> offRate;
+	return (offsLen * bits + 7) / 8;
+}
+
+/**
+ * Bytes the ftab takes for the given ftabchars.
+ */
+static uint64_t ftab_bytes(int ftabChars) {
+	return (((uint64_t)1 << (2 * ftabChars)) + 1) * OFF_SIZE;
+}
+
+/**
+ * Bytes an aligner holds for the index, both directions, if it were built
+ * with the given offrate and ftabchars.  The BWT and the 2-bit reference
+ * don't depend on either.
+ */
+static uint64_t model_bytes(const Ebwt& ebwt, int offRate, int ftabChars) {
+	const EbwtParams& eh = ebwt.eh();
+	return 2 * ((uint64_t)eh.ebwtTotSz() + sa_bytes(ebwt, offRate) + ftab_bytes(ftabChars)) +
+	       ((uint64_t)eh.len() + 3) / 4;
+}
+
+/**
+ * Read up to STATS_MAX_READS reads from a FASTQ or FASTA file into
+ * 'reads', as 2-bit characters with 4 for anything ambiguous.
+ */
+static void read_stats_sample(const string& fname, EList<string>& reads) {
+	ifstream in(fname.c_str());
+	if(!in.good()) {
+		cerr << "Error: Could not open --stats-reads file " << fname.c_str() << endl;
+		throw 1;
+	}
+	string line, seq;
+	bool fasta = false;
+	while(reads.size() < STATS_MAX_READS && getline(in, line)) {
+		if(line.empty()) continue;
+		if(line[0] == '>') {
+			if(fasta && !seq.empty()) reads.push_back(seq);
+			fasta = true;
+			seq.clear();
+			continue;
+		}
+		if(fasta) {
+			seq += line;
+			continue;
+		}
+		if(line[0] != '@') {
+			cerr << "Error: --stats-reads file " << fname.c_str()
+			     << " is not FASTQ or FASTA" << endl;
+			throw 1;
+		}
+		// FASTQ: sequence, '+' line, qualities
+		getline(in, seq);
+		getline(in, line);
+		getline(in, line);
+		reads.push_back(seq);
+	}
+	if(fasta && !seq.empty() && reads.size() < STATS_MAX_READS) {
+		reads.push_back(seq);
+	}
+	for(size_t i = 0; i < reads.size(); i++) {
+		string& r = reads[i];
+		for(size_t j = 0; j < r.length(); j++) {
+			int ch = (unsigned char)r[j];
+			r[j] = (char)(asc2dnacat[ch] == 1 ? asc2dna[ch] : 4);
+		}
+	}
+}
+
+/**
+ * Print statistics about the index's ftab, SA sample and repeat content,
+ * and model how offrate and ftabchars trade memory against lookup work.
+ * If a sample of reads is given, seeds are extracted from it as the
+ * aligner would by default and searched, so the model can count the LF
+ * steps spent on seed search and on resolving seed hits to offsets.
+ */
+static void print_index_stats(
+	const string& fname,
+	ostream& fout)
+{
+	bool color = readEbwtColor(fname);
+	Ebwt ebwt(
+		fname,
+		color,                // index is colorspace
+		-1,                   // don't care about entire-reverse
+		true,                 // index is for the forward direction
+		-1,                   // offrate (-1 = index default)
+		0,                    // offrate-plus (0 = index default)
+		false,                // use memory-mapped IO
+		false,                // use shared memory
+		false,                // sweep memory-mapped memory
+		true,                 // load names?
+		true,                 // load SA sample?
+		true,                 // load ftab?
+		true,                 // load rstarts?
+		verbose,              // be talkative?
+		verbose,              // be talkative at startup?
+		false,                // pass up memory exceptions?
+		false);               // sanity check?
+	ebwt.loadIntoMemory(
+		-1,     // color
+		-1,     // need entire reverse
+		true,   // load SA sample
+		true,   // load ftab
+		true,   // load rstarts
+		true,   // load names
+		false); // verbose
+	const EbwtParams& eh = ebwt.eh();
+	int offRate = eh.offRate();
+	int ftabChars = eh.ftabChars();
+	fout << "Length" << '\t' << eh.len() << endl;
+	fout << "BWT-Bytes" << '\t' << eh.ebwtTotSz() << endl;
+	fout << "SA-Sample" << "\t1 in " << (1 << offRate) << endl;
+	fout << "SA-Bytes" << '\t' << sa_bytes(ebwt, offRate) << endl;
+	fout << "FTab-Chars" << '\t' << ftabChars << endl;
+	fout << "FTab-Bytes" << '\t' << ftab_bytes(ftabChars) << endl;
+
+	// ftab buckets: how many rows each ftabChars-mer narrows the search
+	// to, and the repeat profile of ftabChars-mers that falls out of it
+	uint64_t nbuckets = eh.ftabLen() - 1, empty = 0, maxBucket = 0, occupied = 0;
+	EList<uint64_t> bucketHist, bucketRows;
+	uint64_t kmers[5] = { 0, 0, 0, 0, 0 }, kmerPos[5] = { 0, 0, 0, 0, 0 };
+	for(uint64_t i = 0; i < nbuckets; i++) {
+		uint64_t sz = ebwt.ftabLo((TIndexOffU)(i+1)) - ebwt.ftabHi((TIndexOffU)i);
+		if(sz == 0) {
+			empty++;
+			continue;
+		}
+		occupied += sz;
+		maxBucket = max(maxBucket, sz);
+		add_to_bin(bucketHist, log2Class(sz), 1);
+		add_to_bin(bucketRows, log2Class(sz), sz);
+		kmers[repClass(sz)]++;
+		kmerPos[repClass(sz)] += sz;
+	}
+	fout << "FTab-Buckets" << '\t' << nbuckets << endl;
+	fout << "FTab-Empty" << '\t' << empty << endl;
+	fout << "FTab-Mean" << '\t'
+	     << (nbuckets > empty ? (double)occupied / (nbuckets - empty) : 0.0) << endl;
+	fout << "FTab-Max" << '\t' << maxBucket << endl;
+	print_pow2_hist(fout, "FTab-Size", bucketHist, &bucketRows);
+	for(int c = 0; c < 5; c++) {
+		fout << "Repeat-" << ftabChars << '\t' << repClassNames[c]
+		     << '\t' << kmers[c]
+		     << '\t' << (occupied > 0 ? (double)kmerPos[c] / occupied : 0.0) << endl;
+	}
+
+	// Spacing of the SA sample and what it costs to resolve an offset, at
+	// the index's own offrate and the coarser ones it can be thinned to
+	EList<uint64_t> bits, gapHist;
+	uint64_t walkMax = 0;
+	int maxOffRate = offRate + 4;
+	EList<double> walk;
+	walk.resize(maxOffRate + 1);
+	for(int o = offRate; o <= maxOffRate; o++) {
+		sa_spacing(ebwt, o, bits, walk[o], walkMax, o == offRate ? &gapHist : NULL);
+		if(o == offRate) {
+			fout << "SA-Gap-Max" << '\t' << (walkMax + 1) << endl;
+			print_pow2_hist(fout, "SA-Gap", gapHist, NULL);
+			fout << "WalkLeft-Mean" << '\t' << walk[o] << endl;
+			fout << "WalkLeft-Max" << '\t' << walkMax << endl;
+		}
+	}
+	bits.clear();
+	// Finer offrates can't be measured from this sample; halve the cost
+	// per step down
+	for(int o = offRate - 1; o >= 0; o--) {
+		walk[o] = walk[o+1] / 2.0;
+	}
+
+	// Repeat profile of seed-length k-mers at sampled text offsets: walk
+	// left from a random row to spell the k-mer that ends there, then
+	// count it
+	size_t seedLen = (size_t)statsSeedLen;
+	RandomSource rnd;
+	rnd.init(0);
+	string kmer(seedLen, 0);
+	uint64_t seedKmerPos[5] = { 0, 0, 0, 0, 0 }, sampled = 0;
+	for(size_t s = 0; s < STATS_ROW_SAMPLE; s++) {
+		TIndexOffU row = (TIndexOffU)(rnd.nextU64() % eh.bwtLen());
+		size_t j = 0;
+		for(; j < seedLen; j++) {
+			SideLocus l;
+			l.initFromRow(row, eh, ebwt.ebwt());
+			int c = ebwt.mapLF1(row, l);
+			if(c < 0) break; // ran into the start of the text
+			kmer[seedLen - j - 1] = (char)c;
+		}
+		if(j < seedLen) continue;
+		size_t depth = 0;
+		TIndexOffU cnt = searchDepth(ebwt, kmer.c_str(), seedLen, depth);
+		assert_eq(seedLen, depth);
+		seedKmerPos[repClass(cnt)]++;
+		sampled++;
+	}
+	for(int c = 0; c < 5; c++) {
+		fout << "Repeat-" << seedLen << '\t' << repClassNames[c]
+		     << "\t-\t" << (sampled > 0 ? (double)seedKmerPos[c] / sampled : 0.0) << endl;
+	}
+
+	// Seeds from the read sample: how deep each gets before its range
+	// empties (which decides how many LF steps a given ftabchars saves)
+	// and how many offsets have to be resolved per read
+	EList<string> reads;
+	EList<uint64_t> depthCnt, rangeHist;
+	depthCnt.resize(seedLen + 1);
+	depthCnt.fillZero();
+	uint64_t nseeds = 0, hits = 0, seedDepth = 0;
+	if(!statsReads.empty()) {
+		read_stats_sample(statsReads, reads);
+		string rc;
+		for(size_t i = 0; i < reads.size(); i++) {
+			const string& fw = reads[i];
+			size_t len = fw.length();
+			if(len == 0) continue;
+			rc.resize(len);
+			for(size_t j = 0; j < len; j++) {
+				int c = fw[len - j - 1];
+				rc[j] = (char)(c < 4 ? 3 - c : 4);
+			}
+			// Default seed interval: 1 + 1.15 * sqrt(read length)
+			size_t ival = max<size_t>(1, (size_t)(1.0 + 1.15 * sqrt((double)len)));
+			size_t slen = min(seedLen, len);
+			uint64_t readHits = 0;
+			for(int fwi = 0; fwi < 2; fwi++) {
+				const string& seq = (fwi == 0 ? fw : rc);
+				for(size_t off = 0; off + slen <= len; off += ival) {
+					if(seq.find((char)4, off) < off + slen) continue;
+					size_t depth = 0;
+					TIndexOffU sz = searchDepth(ebwt, seq.c_str() + off, slen, depth);
+					depthCnt[depth]++;
+					seedDepth += depth;
+					nseeds++;
+					readHits += sz;
+					add_to_bin(rangeHist, sz == 0 ? 0 : log2Class(sz) + 1, 1);
+				}
+			}
+			hits += min(readHits, STATS_MAX_HITS);
+		}
+		fout << "Reads" << '\t' << reads.size() << endl;
+		fout << "Seeds" << '\t' << nseeds << endl;
+		fout << "Seed-Depth-Mean" << '\t'
+		     << (nseeds > 0 ? (double)seedDepth / nseeds : 0.0) << endl;
+		for(size_t k = 0; k < rangeHist.size(); k++) {
+			if(rangeHist[k] == 0) continue;
+			fout << "Seed-Range" << '\t';
+			if(k == 0) {
+				fout << "0";
+			} else {
+				fout << ((uint64_t)1 << (k-1)) << '-' << (((uint64_t)1 << k) - 1);
+			}
+			fout << '\t' << rangeHist[k] << endl;
+		}
+		fout << "Hits-Per-Read" << '\t'
+		     << (reads.empty() ? 0.0 : (double)hits / reads.size()) << endl;
+	}
+
+	// The model: memory for each (offrate, ftabchars) against LF steps per
+	// read.  A seed step narrows both ends of a range; the ftab replaces
+	// the first ftabchars of them with one lookup, but only for seeds
+	// that match at least that far.  Every hit, up to the per-read cap,
+	// is resolved with WalkLeft-Mean steps.
+	uint64_t budget = statsMemMb > 0 ? statsMemMb * 1024 * 1024
+	                                 : model_bytes(ebwt, offRate, ftabChars);
+	fout << "Memory-Budget" << '\t' << budget << endl;
+	int minFtab = min(8, ftabChars), maxFtab = max(14, ftabChars);
+	bool haveReads = !reads.empty();
+	bool found = false;
+	int bestO = 0, bestF = 0;
+	double bestCost = 0.0;
+	uint64_t bestBytes = 0;
+	for(int o = 0; o <= maxOffRate; o++) {
+		for(int f = minFtab; f <= maxFtab; f++) {
+			uint64_t bytes = model_bytes(ebwt, o, f);
+			double cost = walk[o];
+			if(haveReads) {
+				size_t fe = ((size_t)f <= seedLen ? (size_t)f : 0);
+				uint64_t seedSteps = 0;
+				for(size_t d = 0; d <= seedLen; d++) {
+					size_t reach = min(seedLen, d + 1);
+					if(reach > fe) seedSteps += depthCnt[d] * 2 * (reach - fe);
+				}
+				cost = ((double)seedSteps + (double)hits * walk[o]) / reads.size();
+			}
+			fout << "Model" << '\t' << o << '\t' << f << '\t' << bytes
+			     << '\t' << walk[o] << '\t' << (o >= offRate ? "measured" : "estimated");
+			if(haveReads) fout << '\t' << cost;
+			fout << endl;
+			// Without reads there's nothing to say about ftabchars, so
+			// keep the index's own
+			if(bytes > budget || (!haveReads && f != ftabChars)) continue;
+			if(!found || cost < bestCost || (cost == bestCost && bytes < bestBytes)) {
+				found = true;
+				bestO = o;
+				bestF = f;
+				bestCost = cost;
+				bestBytes = bytes;
+			}
+		}
+	}
+	if(found) {
+		fout << "Recommend" << '\t' << "--offrate " << bestO
+		     << " --ftabchars " << bestF << '\t' << bestBytes << endl;
+	} else {
+		fout << "Recommend" << '\t' << "none" << endl;
+	}
+	ebwt.evictFromMemory();
+}
+
 static void driver(
 	const string& ebwtFileBase,
 	const string& query)
@@ -374,6 +1093,8 @@ static void driver(
 		print_index_sequence_names(adjustedEbwtFileBase, cout);
 	} else if(summarize_only) {
 		print_index_summary(adjustedEbwtFileBase, cout);
+	} else if(stats_only) {
+		print_index_stats(adjustedEbwtFileBase, cout);
 	} else {
 		// Initialize Ebwt object
 		bool color = readEbwtColor(adjustedEbwtFileBase);
@@ -405,7 +1126,7 @@ static void driver(
 				true,   // load rstarts
 				true,   // load names
 				false); // verbose
-			print_index_sequences<SString<char> >(cout, ebwt);
+			print_index_sequences(cout, ebwt);
 		} else {
 			EList<string> refnames;
 			readEbwtRefnames(adjustedEbwtFileBase, refnames);
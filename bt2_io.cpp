@@ -518,17 +518,44 @@ void Ebwt::readIntoMemory(
 	}
 	
 	_offs.reset();
+	_offsPk.reset();
+	_offsBits = 0;
 	if(loadSASamp) {
 		bytesRead = 4; // reset for secondary index file (already read 1-sentinel)
 		
 		shmemLeader = true;
+		// When the sample lives in private memory, pack each entry into
+		// just enough bits to hold an offset into the joined text.  Mapped
+		// and shared-memory indexes keep the on-disk word layout.
+		if(!_useMm && !useShmem_ && !currentlyBigEndian()) {
+			int bits = 1;
+			while(bits < 64 && ((uint64_t)len >> bits) != 0) bits++;
+			if(bits < OFF_SIZE*8 && bits <= 57) {
+				_offsBits = bits;
+			}
+		}
 		if(_verbose || startVerbose) {
-			cerr << "Reading offs (" << offsLenSampled << std::setw(2) << OFF_SIZE*8 <<"-bit words): ";
+			cerr << "Reading offs (" << offsLenSampled << std::setw(2) << OFF_SIZE*8 <<"-bit words";
+			if(_offsBits > 0) {
+				cerr << ", packed to " << _offsBits << " bits";
+			}
+			cerr << "): ";
 			logTime(cerr);
 		}
 		
 		if(!_useMm) {
-			if(!useShmem_) {
+			if(_offsBits > 0) {
+				// 8 bytes of padding let offsAt() always do a full 8-byte load
+				size_t pkSz = (size_t)(((uint64_t)offsLenSampled * _offsBits + 7) >> 3) + 8;
+				try {
+					_offsPk.init(new uint8_t[pkSz], pkSz, true);
+				} catch(bad_alloc& e) {
+					cerr << "Out of memory allocating the offs[] array  for the Bowtie index." << endl
+					<< "Please try again on a computer with more memory." << endl;
+					throw 1;
+				}
+				memset(_offsPk.get(), 0, pkSz);
+			} else if(!useShmem_) {
 				// Allocate offs_
 				try {
 					_offs.init(new TIndexOffU[offsLenSampled], offsLenSampled, true);
@@ -549,7 +576,7 @@ void Ebwt::readIntoMemory(
 		if(_overrideOffRate < 32) {
 			if(shmemLeader) {
 				// Allocate offs (big allocation)
-				if(switchEndian || offRateDiff > 0) {
+				if(switchEndian || offRateDiff > 0 || _offsBits > 0) {
 					assert(!_useMm);
 					const TIndexOffU blockMaxSz = (2 * 1024 * 1024); // 2 MB block size
 					const TIndexOffU blockMaxSzU = (blockMaxSz >> (OFF_SIZE/4 + 1)); // # U32s per block
@@ -570,10 +597,11 @@ void Ebwt::readIntoMemory(
 						TIndexOffU idx = i >> offRateDiff;
 						for(TIndexOffU j = 0; j < block; j += (1 << offRateDiff)) {
 							assert_lt(idx, offsLenSampled);
-							this->offs()[idx] = ((TIndexOffU*)buf)[j];
+							TIndexOffU off = ((TIndexOffU*)buf)[j];
 							if(switchEndian) {
-								this->offs()[idx] = endianSwapU(this->offs()[idx]);
+								off = endianSwapU(off);
 							}
+							this->setOffsAt(idx, off);
 							idx++;
 						}
 					}
@@ -922,7 +950,7 @@ void Ebwt::writeFromMemory(bool justHeader,
 		for(TIndexOffU i = 0; i < eh._eftabLen; i++)
 			assert_eq(this->eftab()[i], copy.eftab()[i]);
 		for(TIndexOffU i = 0; i < eh._offsLen; i++)
-			assert_eq(this->_offs[i], copy.offs()[i]);
+			assert_eq(this->_offs[i], copy.offsAt(i));
 		for(TIndexOffU i = 0; i < eh._ebwtTotLen; i++)
 			assert_eq(this->ebwt()[i], copy.ebwt()[i]);
 		copy.sanityCheckAll();
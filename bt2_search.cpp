@@ -55,7 +55,10 @@
 #include "presets.h"
 #include "opts.h"
 #include "outq.h"
+#include "checkpoint.h"
+#include "live_stats.h"
 #include "aligner_seed2.h"
+#include "dust.h"
 #include "bt2_search.h"
 #ifdef WITH_TBB
  #include <tbb/compat/thread>
@@ -87,6 +90,7 @@ static int metricsIval;   // interval between alignment metrics messages (0 = no
 static string metricsFile;// output file to put alignment metrics in
 static bool metricsStderr;// output file to put alignment metrics in
 static bool metricsPerRead; // report a metrics tuple for every read
+static string metricsLive; // file to publish live per-thread counters in
 static bool allHits;      // for multihits, report just one
 static bool showVersion;  // just print version and quit?
 static int ipause;        // pause before maching?
@@ -177,11 +181,13 @@ static bool gSeedLenIsSet;
 static float bwaSwLikeC;
 static float bwaSwLikeT;
 static bool qcFilter;
+static int dustThresh;        // filter reads with low-complexity score >= this; 0 = off
 bool gReportOverhangs;        // false -> filter out alignments that fall off the end of a reference sequence
 static string rgid;           // ID: setting for @RG header line
 static string rgs;            // SAM outputs for @RG header line
 static string rgs_optflag;    // SAM optional flag to add corresponding to @RG ID
 static bool msample;          // whether to report a random alignment when maxed-out via -m/-M
+static bool mapqStop;         // stop searching once best score & MAPQ can't change
 int      gGapBarrier;         // # diags on top/bot only to be entered diagonally
 int gDefaultSeedLen;
 static EList<string> qualities;
@@ -211,13 +217,19 @@ static bool descPrioritizeRoots; // whether to prioritize search roots with scor
 static size_t descLanding;    // don't place a search root if it's within this many positions of end
 static SimpleFunc descentTotSz;    // maximum space a DescentDriver can use in bytes
 static SimpleFunc descentTotFmops; // maximum # FM ops a DescentDriver can perform
+static size_t descMaxLen;     // try descent before seed-and-extend for unpaired reads up to this long
 static int    multiseedMms;   // mismatches permitted in a multiseed seed
 static int    multiseedLen;   // length of multiseed seeds
 static size_t multiseedOff;   // offset to begin extracting seeds
+static bool   seedMinimizers; // choose seed offsets by minimizer, not interval
+static int    seedMiniWin;    // minimizer window; 0 -> derive from interval
+static size_t seedFreqCap;    // drop seeds with more hits than this; 0 = no cap
+static uint64_t repMaskMin;   // mask seeds of k-mers in .rep table occurring >= this; 0 = off
 static uint32_t seedCacheLocalMB;   // # MB to use for non-shared seed alignment cacheing
 static uint32_t seedCacheCurrentMB; // # MB to use for current-read seed hit cacheing
 static uint32_t exactCacheCurrentMB; // # MB to use for current-read seed hit cacheing
 static size_t maxhalf;        // max width on one side of DP table
+static bool mateIsect;        // intersect both mates' seed hits before extending
 static bool seedSumm;         // print summary information about seed hits, not alignments
 static bool scUnMapped;       // consider soft-clipped bases unmapped when calculating TLEN
 static bool doUngapped;       // do ungapped alignment
@@ -250,12 +262,23 @@ static int seedBoostThresh;   // if average non-zero position has more than this
 static size_t nSeedRounds;    // # seed rounds
 static bool reorder;          // true -> reorder SAM recs in -p mode
 static float sampleFrac;      // only align random fraction of input reads
+static uint32_t shardIdx;     // align only reads with rdid % shardCount == shardIdx
+static uint32_t shardCount;   // # shards the input is split into; 1 = no sharding
 static bool arbitraryRandom;  // pseudo-randoms no longer a function of read properties
-static bool bowtie2p5;
+static bool bowtie2p5;        // align with the descent search (bowtie2 2.5 worker)
+static bool descentPreset;    // --descent: bowtie2p5 plus tuned --desc-* defaults
 static string logDps;         // log seed-extend dynamic programming problems
 static string logDpsOpp;      // log mate-search dynamic programming problems
+static string readOutFns[4];  // --un, --al, --un-conc, --al-conc file names
+static int readOutComp[4];    // READ_OUT_* compression for each of the above
 
 static string bt2index;      // read Bowtie 2 index from files with this prefix
+static EList<string> extraIndexes; // indexes given with later -x options, in priority order
+static bool allIndexes;      // true -> align to every index, not just until first hit
+static string checkpointFile; // periodically record progress here
+static TReadId checkpointEvery; // # reads between checkpoints
+static bool resume;          // true -> pick up where --checkpoint file says we left off
+static bool asyncIo;         // true -> read input and write output in the background
 static EList<pair<int, string> > extra_opts;
 static size_t extra_opts_cur;
 
@@ -278,6 +301,7 @@ static void resetOptions() {
 	metricsFile             = ""; // output file to put alignment metrics in
 	metricsStderr           = false; // print metrics to stderr (in addition to --metrics-file if it's specified
 	metricsPerRead          = false; // report a metrics tuple for every read?
+	metricsLive             = ""; // don't publish live counters
 	allHits					= false; // for multihits, report just one
 	showVersion				= false; // just print version and quit?
 	ipause					= 0; // pause before maching?
@@ -371,10 +395,12 @@ static void resetOptions() {
 	bwaSwLikeT              = 20.0f;
 	gDefaultSeedLen			= DEFAULT_SEEDLEN;
 	qcFilter                = false; // don't believe upstream qc by default
+	dustThresh              = 0;     // don't filter low-complexity reads
 	rgid					= "";    // SAM outputs for @RG header line
 	rgs						= "";    // SAM outputs for @RG header line
 	rgs_optflag				= "";    // SAM optional flag to add corresponding to @RG ID
 	msample				    = true;
+	mapqStop                = false; // search until -M/effort limits are hit
 	gGapBarrier				= 4;     // disallow gaps within this many chars of either end of alignment
 	qualities.clear();
 	qualities1.clear();
@@ -403,9 +429,15 @@ static void resetOptions() {
 	descLanding = 20;
 	descentTotSz.init(SIMPLE_FUNC_LINEAR, 1024.0, DMAX, 0.0, 1024.0);
 	descentTotFmops.init(SIMPLE_FUNC_LINEAR, 100.0, DMAX, 0.0, 10.0);
+	descMaxLen = 0;
 	multiseedMms    = DEFAULT_SEEDMMS;
 	multiseedLen    = gDefaultSeedLen;
 	multiseedOff    = 0;
+	seedMinimizers  = false; // choose seed offsets at fixed intervals
+	mateIsect       = false; // extend each mate's seed hits on their own
+	seedMiniWin     = 0;     // derive minimizer window from interval
+	seedFreqCap     = 0;     // no seed frequency cap
+	repMaskMin      = 0;     // don't mask repetitive seeds
 	seedCacheLocalMB   = 32; // # MB to use for non-shared seed alignment cacheing
 	seedCacheCurrentMB = 20; // # MB to use for current-read seed hit cacheing
 	exactCacheCurrentMB = 20; // # MB to use for current-read seed hit cacheing
@@ -432,6 +464,12 @@ static void resetOptions() {
 	extra_opts.clear();
 	extra_opts_cur = 0;
 	bt2index.clear();        // read Bowtie 2 index from files with this prefix
+	extraIndexes.clear();    // just one index
+	allIndexes = false;      // stop at the first index with an alignment
+	checkpointFile.clear();  // don't write checkpoints
+	checkpointEvery = 1000000; // checkpoint every million reads
+	resume = false;          // start from the first read
+	asyncIo = false;         // plain blocking reads and writes
 	ignoreQuals = false;     // all mms incur same penalty, regardless of qual
 	wrapper.clear();         // type of wrapper script, so we can print correct usage
 	queries.clear();         // list of query files
@@ -445,10 +483,17 @@ static void resetOptions() {
 	do1mmMinLen = 60;        // length below which we disable 1mm search
 	reorder = false;         // reorder SAM records with -p > 1
 	sampleFrac = 1.1f;       // align all reads
+	shardIdx = 0;            // no sharding
+	shardCount = 1;
 	arbitraryRandom = false; // let pseudo-random seeds be a function of read properties
 	bowtie2p5 = false;
+	descentPreset = false;
 	logDps.clear();          // log seed-extend dynamic programming problems
 	logDpsOpp.clear();       // log mate-search dynamic programming problems
+	for(int i = 0; i < 4; i++) {
+		readOutFns[i].clear();      // don't write reads to --un/--al/... files
+		readOutComp[i] = READ_OUT_PLAIN;
+	}
 }
 
 static const char *short_options = "fF:qbzhcu:rv:s:aP:t3:5:w:p:k:M:1:2:I:X:CQ:N:i:L:U:x:S:g:O:D:R:";
@@ -471,6 +516,7 @@ static struct option long_options[] = {
 {(char*)"met-read",                    no_argument,        0,                   ARG_METRIC_PER_READ},
 {(char*)"met",                         required_argument,  0,                   ARG_METRIC_IVAL},
 {(char*)"met-file",                    required_argument,  0,                   ARG_METRIC_FILE},
+{(char*)"met-live",                    required_argument,  0,                   ARG_METRIC_LIVE},
 {(char*)"met-stderr",                  no_argument,        0,                   ARG_METRIC_STDERR},
 {(char*)"time",                        no_argument,        0,                   't'},
 {(char*)"trim3",                       required_argument,  0,                   '3'},
@@ -551,6 +597,7 @@ static struct option long_options[] = {
 {(char*)"ion-torrent",                 no_argument,        0,                   ARG_NOISY_HPOLY},
 {(char*)"no-mixed",                    no_argument,        0,                   ARG_NO_MIXED},
 {(char*)"no-discordant",               no_argument,        0,                   ARG_NO_DISCORDANT},
+{(char*)"mate-isect",                  no_argument,        0,                   ARG_MATE_ISECT},
 {(char*)"local",                       no_argument,        0,                   ARG_LOCAL},
 {(char*)"end-to-end",                  no_argument,        0,                   ARG_END_TO_END},
 {(char*)"ungapped",                    no_argument,        0,                   ARG_UNGAPPED},
@@ -559,6 +606,13 @@ static struct option long_options[] = {
 {(char*)"no-sse8",                     no_argument,        0,                   ARG_SSE8_NO},
 {(char*)"scan-narrowed",               no_argument,        0,                   ARG_SCAN_NARROWED},
 {(char*)"qc-filter",                   no_argument,        0,                   ARG_QC_FILTER},
+{(char*)"dust",                        required_argument,  0,                   ARG_DUST},
+{(char*)"shard",                       required_argument,  0,                   ARG_SHARD},
+{(char*)"all-indexes",                 no_argument,        0,                   ARG_ALL_INDEXES},
+{(char*)"checkpoint",                  required_argument,  0,                   ARG_CHECKPOINT},
+{(char*)"checkpoint-every",            required_argument,  0,                   ARG_CHECKPOINT_EVERY},
+{(char*)"resume",                      no_argument,        0,                   ARG_RESUME},
+{(char*)"async-io",                    no_argument,        0,                   ARG_ASYNC_IO},
 {(char*)"bwa-sw-like",                 no_argument,        0,                   ARG_BWA_SW_LIKE},
 {(char*)"multiseed",                   required_argument,  0,                   ARG_MULTISEED_IVAL},
 {(char*)"ma",                          required_argument,  0,                   ARG_SCORE_MA},
@@ -603,6 +657,11 @@ static struct option long_options[] = {
 {(char*)"1mm-minlen",                  required_argument,  0,                   ARG_1MM_MINLEN},
 {(char*)"seed-off",                    required_argument,  0,                   'O'},
 {(char*)"seed-boost",                  required_argument,  0,                   ARG_SEED_BOOST_THRESH},
+{(char*)"minimizers",                  no_argument,        0,                   ARG_MINIMIZERS},
+{(char*)"mini-win",                    required_argument,  0,                   ARG_MINI_WIN},
+{(char*)"seed-cap",                    required_argument,  0,                   ARG_SEED_CAP},
+{(char*)"rep-mask",                    required_argument,  0,                   ARG_REP_MASK},
+{(char*)"mapq-stop",                   no_argument,        0,                   ARG_MAPQ_STOP},
 {(char*)"read-times",                  no_argument,        0,                   ARG_READ_TIMES},
 {(char*)"show-rand-seed",              no_argument,        0,                   ARG_SHOW_RAND_SEED},
 {(char*)"dp-fail-streak",              required_argument,  0,                   ARG_DP_FAIL_STREAK_THRESH},
@@ -617,6 +676,22 @@ static struct option long_options[] = {
 {(char*)"seed-rounds",                 required_argument,  0,                   'R'},
 {(char*)"reorder",                     no_argument,        0,                   ARG_REORDER},
 {(char*)"passthrough",                 no_argument,        0,                   ARG_READ_PASSTHRU},
+{(char*)"un",                         required_argument,  0,                   ARG_UN},
+{(char*)"un-gz",                      required_argument,  0,                   ARG_UN_GZ},
+{(char*)"un-bz2",                     required_argument,  0,                   ARG_UN_BZ2},
+{(char*)"un-lz4",                     required_argument,  0,                   ARG_UN_LZ4},
+{(char*)"al",                         required_argument,  0,                   ARG_AL},
+{(char*)"al-gz",                      required_argument,  0,                   ARG_AL_GZ},
+{(char*)"al-bz2",                     required_argument,  0,                   ARG_AL_BZ2},
+{(char*)"al-lz4",                     required_argument,  0,                   ARG_AL_LZ4},
+{(char*)"un-conc",                    required_argument,  0,                   ARG_UN_CONC},
+{(char*)"un-conc-gz",                 required_argument,  0,                   ARG_UN_CONC_GZ},
+{(char*)"un-conc-bz2",                required_argument,  0,                   ARG_UN_CONC_BZ2},
+{(char*)"un-conc-lz4",                required_argument,  0,                   ARG_UN_CONC_LZ4},
+{(char*)"al-conc",                    required_argument,  0,                   ARG_AL_CONC},
+{(char*)"al-conc-gz",                 required_argument,  0,                   ARG_AL_CONC_GZ},
+{(char*)"al-conc-bz2",                required_argument,  0,                   ARG_AL_CONC_BZ2},
+{(char*)"al-conc-lz4",                required_argument,  0,                   ARG_AL_CONC_LZ4},
 {(char*)"sample",                      required_argument,  0,                   ARG_SAMPLE},
 {(char*)"cp-min",                      required_argument,  0,                   ARG_CP_MIN},
 {(char*)"cp-ival",                     required_argument,  0,                   ARG_CP_IVAL},
@@ -627,12 +702,14 @@ static struct option long_options[] = {
 {(char*)"seed-cache-sz",               required_argument,  0,                   ARG_CURRENT_SEED_CACHE_SZ},
 {(char*)"no-unal",                     no_argument,        0,                   ARG_SAM_NO_UNAL},
 {(char*)"test-25",                     no_argument,        0,                   ARG_TEST_25},
+{(char*)"descent",                     no_argument,        0,                   ARG_DESCENT},
 // TODO: following should be a function of read length?
 {(char*)"desc-kb",                     required_argument,  0,                   ARG_DESC_KB},
 {(char*)"desc-landing",                required_argument,  0,                   ARG_DESC_LANDING},
 {(char*)"desc-exp",                    required_argument,  0,                   ARG_DESC_EXP},
 {(char*)"desc-prioritize",             no_argument,        0,                   ARG_DESC_PRIORITIZE},
 {(char*)"desc-fmops",                  required_argument,  0,                   ARG_DESC_FMOPS},
+{(char*)"desc-len",                    required_argument,  0,                   ARG_DESC_LEN},
 {(char*)"log-dp",                      required_argument,  0,                   ARG_LOG_DP},
 {(char*)"log-dp-opp",                  required_argument,  0,                   ARG_LOG_DP_OPP},
 {(char*)"soft-clipped-unmapped-tlen",  no_argument,        0,                   ARG_SC_UNMAPPED},
@@ -713,6 +790,7 @@ static void printUsage(ostream& out) {
 	    << endl
 	    << "  <m1>, <m2>, <r> can be comma-separated lists (no whitespace) and can be" << endl
 		<< "  specified many times.  E.g. '-U file1.fq,file2.fq -U file3.fq'." << endl
+		<< "  -x can be specified many times to align to several indexes in turn." << endl
 		// Wrapper script should write <bam> line next
 		<< endl
 	    << "Options (defaults in parentheses):" << endl
@@ -739,6 +817,7 @@ static void printUsage(ostream& out) {
 		<< "   --fast                 -D 10 -R 2 -N 0 -L 22 -i S,0,2.50" << endl
 		<< "   --sensitive            -D 15 -R 2 -N 0 -L 22 -i S,1,1.15 (default)" << endl
 		<< "   --very-sensitive       -D 20 -R 3 -N 0 -L 20 -i S,1,0.50" << endl
+		<< "   --descent              descent search, --desc-landing 12 --desc-exp 1.5" << endl
 		<< endl
 		<< "  For --local:" << endl
 		<< "   --very-fast-local      -D 5 -R 1 -N 0 -L 25 -i S,1,2.00" << endl
@@ -792,25 +871,26 @@ static void printUsage(ostream& out) {
 		<< "  --dovetail         concordant when mates extend past each other" << endl
 		<< "  --no-contain       not concordant when one mate alignment contains other" << endl
 		<< "  --no-overlap       not concordant when mates overlap at all" << endl
+		<< "  --mate-isect       extend loci seeded by both mates first, w/o mate rescue" << endl
 		<< endl
 	    << " Output:" << endl;
 	//if(wrapper == "basic-0") {
 	//	out << "  --bam              output directly to BAM (by piping through 'samtools view')" << endl;
 	//}
 	out << "  -t/--time          print wall-clock time taken by search phases" << endl;
-	if(wrapper == "basic-0") {
 	out << "  --un <path>           write unpaired reads that didn't align to <path>" << endl
 	    << "  --al <path>           write unpaired reads that aligned at least once to <path>" << endl
 	    << "  --un-conc <path>      write pairs that didn't align concordantly to <path>" << endl
 	    << "  --al-conc <path>      write pairs that aligned concordantly at least once to <path>" << endl
 	    << "  (Note: for --un, --al, --un-conc, or --al-conc, add '-gz' to the option name, e.g." << endl
-		<< "  --un-gz <path>, to gzip compress output, or add '-bz2' to bzip2 compress output.)" << endl;
-	}
+		<< "  --un-gz <path>, to gzip compress output, or add '-bz2' or '-lz4' to bzip2 or lz4" << endl
+		<< "  compress output.)" << endl;
 	out << "  --quiet            print nothing to stderr except serious errors" << endl
 	//  << "  --refidx           refer to ref. seqs by 0-based index rather than name" << endl
 		<< "  --met-file <path>  send metrics to file at <path> (off)" << endl
 		<< "  --met-stderr       send metrics to stderr (off)" << endl
 		<< "  --met <int>        report internal counters & metrics every <int> secs (1)" << endl
+		<< "  --met-live <path>  keep live per-thread counters in memory-mapped file <path>" << endl
 	// Following is supported in the wrapper instead
 	    << "  --no-unal          suppress SAM records for unaligned reads" << endl
 	    << "  --no-head          suppress header lines, i.e. lines starting with @" << endl
@@ -828,6 +908,12 @@ static void printUsage(ostream& out) {
 	//    << "  -o/--offrate <int> override offrate of index; must be >= index's offrate" << endl
 	    << "  -p/--threads <int> number of alignment threads to launch (1)" << endl
 	    << "  --reorder          force SAM output order to match order of input reads" << endl
+	    << "  --shard <i>/<N>    align only every Nth read, starting with read i (0-based)" << endl
+	    << "  --all-indexes      with several -x, align to all, not just up to first hit" << endl
+	    << "  --checkpoint <file> record progress in <file> so a crashed run can be resumed" << endl
+	    << "  --checkpoint-every <int> reads between checkpoints (1000000)" << endl
+	    << "  --resume           continue from --checkpoint file, appending to -S file" << endl
+	    << "  --async-io         read input files and write -S file in the background" << endl
 #ifdef BOWTIE_MM
 	    << "  --mm               use memory-mapped I/O for index; many 'bowtie's can share" << endl
 #endif
@@ -837,6 +923,7 @@ static void printUsage(ostream& out) {
 		<< endl
 	    << " Other:" << endl
 		<< "  --qc-filter        filter out reads that are bad according to QSEQ filter" << endl
+		<< "  --dust <int>       filter out reads with low-complexity score >= <int> (0-100; off)" << endl
 	    << "  --seed <int>       seed for random number generator (0)" << endl
 	    << "  --non-deterministic seed rand. gen. arbitrarily instead of using read attributes" << endl
 	//  << "  --verbose          verbose output for debugging" << endl
@@ -937,6 +1024,8 @@ static string applyPreset(const string& sorig, Presets& presets) {
 static bool saw_M;
 static bool saw_a;
 static bool saw_k;
+static bool saw_desc_landing;
+static bool saw_desc_exp;
 static EList<string> presetList;
 
 /**
@@ -949,11 +1038,13 @@ static EList<string> presetList;
 static void parseOption(int next_option, const char *arg) {
 	switch (next_option) {
 		case ARG_TEST_25: bowtie2p5 = true; break;
+		case ARG_DESCENT: bowtie2p5 = descentPreset = true; break;
 		case ARG_DESC_KB: descentTotSz = SimpleFunc::parse(arg, 0.0, 1024.0, 1024.0, DMAX); break;
 		case ARG_DESC_FMOPS: descentTotFmops = SimpleFunc::parse(arg, 0.0, 10.0, 100.0, DMAX); break;
 		case ARG_LOG_DP: logDps = arg; break;
 		case ARG_LOG_DP_OPP: logDpsOpp = arg; break;
 		case ARG_DESC_LANDING: {
+			saw_desc_landing = true;
 			descLanding = parse<int>(arg);
 			if(descLanding < 1) {
 				cerr << "Error: --desc-landing must be greater than or equal to 1" << endl;
@@ -962,6 +1053,7 @@ static void parseOption(int next_option, const char *arg) {
 			break;
 		}
 		case ARG_DESC_EXP: {
+			saw_desc_exp = true;
 			descConsExp = parse<double>(arg);
 			if(descConsExp < 0.0) {
 				cerr << "Error: --desc-exp must be greater than or equal to 0" << endl;
@@ -970,6 +1062,7 @@ static void parseOption(int next_option, const char *arg) {
 			break;
 		}
 		case ARG_DESC_PRIORITIZE: descPrioritizeRoots = true; break;
+		case ARG_DESC_LEN: descMaxLen = (size_t)parseInt(0, "--desc-len arg must be at least 0", arg); break;
 		case '1': tokenize(arg, ",", mates1); break;
 		case '2': tokenize(arg, ",", mates2); break;
 		case ARG_ONETWO: tokenize(arg, ",", mates12); format = TAB_MATE5; break;
@@ -1009,6 +1102,7 @@ static void parseOption(int next_option, const char *arg) {
 			break;
 		case ARG_NO_DISCORDANT: gReportDiscordant = false; break;
 		case ARG_NO_MIXED: gReportMixed = false; break;
+		case ARG_MATE_ISECT: mateIsect = true; break;
 		case 's':
 			skipReads = (uint32_t)parseInt(0, "-s arg must be positive", arg);
 			break;
@@ -1186,6 +1280,7 @@ static void parseOption(int next_option, const char *arg) {
 		case ARG_METRIC_FILE: metricsFile = arg; break;
 		case ARG_METRIC_STDERR: metricsStderr = true; break;
 		case ARG_METRIC_PER_READ: metricsPerRead = true; break;
+		case ARG_METRIC_LIVE: metricsLive = arg; break;
 		case ARG_NO_FW: gNofw = true; break;
 		case ARG_NO_RC: gNorc = true; break;
 		case ARG_SAM_NO_QNAME_TRUNC: samTruncQname = false; break;
@@ -1219,6 +1314,16 @@ static void parseOption(int next_option, const char *arg) {
 			sam_print_xr = true;
 			break;
 		}
+		case ARG_UN: case ARG_UN_GZ: case ARG_UN_BZ2: case ARG_UN_LZ4:
+		case ARG_AL: case ARG_AL_GZ: case ARG_AL_BZ2: case ARG_AL_LZ4:
+		case ARG_UN_CONC: case ARG_UN_CONC_GZ: case ARG_UN_CONC_BZ2: case ARG_UN_CONC_LZ4:
+		case ARG_AL_CONC: case ARG_AL_CONC_GZ: case ARG_AL_CONC_BZ2: case ARG_AL_CONC_LZ4: {
+			// Four variants (plain, -gz, -bz2, -lz4) of each of four options
+			int kind = (next_option - ARG_UN) / 4;
+			readOutFns[kind] = arg;
+			readOutComp[kind] = READ_OUT_PLAIN + (next_option - ARG_UN) % 4;
+			break;
+		}
 		case ARG_READ_TIMES: {
 			sam_print_xt = true;
 			sam_print_xd = true;
@@ -1285,8 +1390,29 @@ static void parseOption(int next_option, const char *arg) {
 		case ARG_CONTAIN:     gContainMatesOK  = true;  break;
 		case ARG_OVERLAP:     gOlapMatesOK     = true;  break;
 		case ARG_QC_FILTER: qcFilter = true; break;
+		case ARG_DUST: {
+			dustThresh = parseInt(0, 100, "--dust arg must be between 0 and 100", arg);
+			break;
+		}
+		case ARG_SHARD: {
+			// Argument is <i>/<N>, 0 <= i < N
+			EList<string> args;
+			tokenize(arg, "/", args);
+			if(args.size() != 2) {
+				cerr << "Error: --shard arg must be of the form <i>/<N>" << endl;
+				throw 1;
+			}
+			shardCount = (uint32_t)parseInt(1, "--shard <N> must be at least 1", args[1].c_str());
+			shardIdx = (uint32_t)parseInt(0, "--shard <i> must be at least 0", args[0].c_str());
+			if(shardIdx >= shardCount) {
+				cerr << "Error: --shard <i> must be less than <N>" << endl;
+				throw 1;
+			}
+			break;
+		}
 		case ARG_IGNORE_QUALS: ignoreQuals = true; break;
 		case ARG_MAPQ_V: mapqv = parse<int>(arg); break;
+		case ARG_MAPQ_STOP: mapqStop = true; break;
 		case ARG_TIGHTEN: tighten = parse<int>(arg); break;
 		case ARG_EXACT_UPFRONT:    doExactUpFront = true; break;
 		case ARG_1MM_UPFRONT:      do1mmUpFront   = true; break;
@@ -1294,7 +1420,24 @@ static void parseOption(int next_option, const char *arg) {
 		case ARG_1MM_UPFRONT_NO:   do1mmUpFront   = false; break;
 		case ARG_1MM_MINLEN:       do1mmMinLen = parse<size_t>(arg); break;
 		case ARG_NOISY_HPOLY: noisyHpolymer = true; break;
-		case 'x': bt2index = arg; break;
+		case 'x': {
+			// -x may be given several times; reads are aligned to the
+			// indexes in the order given
+			if(bt2index.empty()) {
+				bt2index = arg;
+			} else {
+				extraIndexes.push_back(arg);
+			}
+			break;
+		}
+		case ARG_ALL_INDEXES: allIndexes = true; break;
+		case ARG_CHECKPOINT: checkpointFile = arg; break;
+		case ARG_CHECKPOINT_EVERY: {
+			checkpointEvery = (TReadId)parseInt(1, "--checkpoint-every arg must be at least 1", arg);
+			break;
+		}
+		case ARG_RESUME: resume = true; break;
+		case ARG_ASYNC_IO: asyncIo = true; break;
 		case ARG_PRESET_VERY_FAST_LOCAL: localAlign = true;
 		case ARG_PRESET_VERY_FAST: {
 			presetList.push_back("very-fast%LOCAL%"); break;
@@ -1341,6 +1484,17 @@ static void parseOption(int next_option, const char *arg) {
 		case 'O':
 			multiseedOff = parse<size_t>(arg);
 			break;
+		case ARG_MINIMIZERS: seedMinimizers = true; break;
+		case ARG_MINI_WIN:
+			seedMiniWin = parseInt(1, "--mini-win arg must be at least 1", arg);
+			seedMinimizers = true;
+			break;
+		case ARG_SEED_CAP:
+			seedFreqCap = (size_t)parseInt(1, "--seed-cap arg must be at least 1", arg);
+			break;
+		case ARG_REP_MASK:
+			repMaskMin = (uint64_t)parseInt(1, "--rep-mask arg must be at least 1", arg);
+			break;
 		case 'i': {
 			EList<string> args;
 			tokenize(arg, ",", args);
@@ -1478,6 +1632,8 @@ static void parseOptions(int argc, const char **argv) {
 	saw_M = false;
 	saw_a = false;
 	saw_k = false;
+	saw_desc_landing = false;
+	saw_desc_exp = false;
 	presetList.clear();
 	if(startVerbose) { cerr << "Parsing options: "; logTime(cerr, true); }
 	while(true) {
@@ -1556,6 +1712,17 @@ static void parseOptions(int argc, const char **argv) {
 		assert_gt(mhits, 0);
 		msample = true;
 	}
+	if(descentPreset) {
+		// Shorter landing and a gentler ramp let the descent search admit
+		// edits closer to its roots, which matters for short reads
+		if(!saw_desc_landing) descLanding = 12;
+		if(!saw_desc_exp) descConsExp = 1.5;
+	}
+	if(bowtie2p5 && localAlign) {
+		cerr << "Error: " << (descentPreset ? "--descent" : "--test-25")
+		     << " is only available in --end-to-end mode" << endl;
+		throw 1;
+	}
 	if(mates1.size() != mates2.size()) {
 		cerr << "Error: " << mates1.size() << " mate files/sequences were specified with -1, but " << mates2.size() << endl
 		     << "mate files/sequences were specified with -2.  The same number of mate files/" << endl
@@ -1610,6 +1777,51 @@ static void parseOptions(int argc, const char **argv) {
 	if(qUpto + skipReads > qUpto) {
 		qUpto += skipReads;
 	}
+	// Per-shard output must be in input order for the shards to be merged
+	// back together.  bowtie2-merge-shards takes one read from each shard
+	// in turn, so every read must have a record and the first read kept
+	// must be in shard 0.
+	if(shardCount > 1) {
+		reorder = true;
+		if(samNoUnal) {
+			cerr << "Error: --shard can't be combined with --no-unal; "
+			     << "bowtie2-merge-shards needs a record for every read" << endl;
+			throw 1;
+		}
+		if(sampleFrac < 1.0f) {
+			cerr << "Error: --shard can't be combined with --sample; "
+			     << "bowtie2-merge-shards needs a record for every read" << endl;
+			throw 1;
+		}
+		if(skipReads % shardCount != 0) {
+			cerr << "Error: with --shard <i>/<N>, -s/--skip must be a multiple of <N>" << endl;
+			throw 1;
+		}
+	}
+	// Checkpoints count reads whose output has been written, which only
+	// means something if output is in input order
+	if(!checkpointFile.empty()) {
+		reorder = true;
+		for(int i = 0; i < 4; i++) {
+			if(!readOutFns[i].empty()) {
+				cerr << "Error: --checkpoint doesn't record how much of the --un, "
+				     << "--al, --un-conc and --al-conc files was written, so it "
+				     << "can't be combined with them" << endl;
+				throw 1;
+			}
+		}
+	} else if(resume) {
+		cerr << "Error: --resume requires --checkpoint" << endl;
+		throw 1;
+	}
+	if(!extraIndexes.empty()) {
+		if(bowtie2p5) {
+			cerr << "Error: --descent can't be combined with more than one -x index" << endl;
+			throw 1;
+		}
+		// Cached seed hits are specific to one index
+		msNoCache = true;
+	}
 	if(useShmem && useMm && !gQuiet) {
 		cerr << "Warning: --shmem overrides --mm..." << endl;
 		useMm = false;
@@ -1662,15 +1874,157 @@ createPatsrcFactory(
 
 #define PTHREAD_ATTRS (PTHREAD_CREATE_JOINABLE | PTHREAD_CREATE_DETACHED)
 
+/**
+ * One of the indexes given with -x, along with everything the workers need
+ * to align to it.
+ */
+struct SearchIndex {
+	string            base;   // index basename
+	Ebwt             *ebwtFw; // index of original text
+	Ebwt             *ebwtBw; // index of mirror text, or NULL
+	BitPairReference *refs;   // packed reference strings, or NULL
+	RepeatKmers      *rep;    // repeat k-mers, or NULL
+	TRefId            refOff; // id of its first reference in the SAM header
+	bool              loaded; // true -> components above are in memory
+};
+
 static PatternComposer*         multiseed_patsrc;
 static PatternParams            multiseed_pp;
-static Ebwt*                    multiseed_ebwtFw;
-static Ebwt*                    multiseed_ebwtBw;
+static EList<SearchIndex>       multiseed_idxs; // indexes, in priority order
 static Scoring*                 multiseed_sc;
-static BitPairReference*        multiseed_refs;
 static AlignmentCache*          multiseed_ca; // seed cache
 static AlnSink*                 multiseed_msink;
 static OutFileBuf*              multiseed_metricsOfb;
+static LiveStats*               multiseed_liveStats;
+static MUTEX_T                  multiseed_idx_mutex; // guards lazy index loads
+
+/**
+ * Return true iff the configured alignment mode searches the mirror index,
+ * i.e. seeds may have mismatches, 1-mismatch end-to-end search is on or
+ * reads may go through descent search.
+ */
+static bool needMirrorIndex() {
+	return multiseedMms > 0 || (do1mmUpFront && !seedSumm) ||
+	       bowtie2p5 || descMaxLen > 0;
+}
+
+/**
+ * Return true iff the configured alignment mode resolves reference offsets
+ * and so needs the SA sample, the rstarts and the packed reference.  With
+ * --seed-summ, the multiseed worker only searches for seed hits and needs
+ * none of them.
+ */
+static bool needOffsets() {
+	return !seedSumm || bowtie2p5;
+}
+
+/**
+ * Check that every file the configured alignment mode reads for the index
+ * with the given basename can be opened.  Later indexes are loaded from
+ * inside a worker thread, where an exception can't be reported, so
+ * driver() calls this for each index before any of them is constructed.
+ * Prints an error and throws 1 if a file is missing.
+ */
+static void checkSearchIndexFiles(const string& base) {
+	EList<string> fns;
+	fns.push_back(base + ".1." + gEbwt_ext);
+	fns.push_back(base + ".2." + gEbwt_ext);
+	if(needMirrorIndex()) {
+		fns.push_back(base + ".rev.1." + gEbwt_ext);
+		fns.push_back(base + ".rev.2." + gEbwt_ext);
+	}
+	if(needOffsets()) {
+		fns.push_back(base + ".3." + gEbwt_ext);
+		fns.push_back(base + ".4." + gEbwt_ext);
+	}
+	for(size_t i = 0; i < fns.size(); i++) {
+		FILE *f = fopen(fns[i].c_str(), "rb");
+		if(f == NULL) {
+			cerr << "Could not open index file " << fns[i].c_str() << endl;
+			throw 1;
+		}
+		fclose(f);
+	}
+	if(repMaskMin > 0) {
+		string repFile = base + ".rep." + gEbwt_ext;
+		FILE *f = fopen(repFile.c_str(), "rb");
+		if(f == NULL) {
+			cerr << "Error: could not load repeat k-mer table \"" << repFile.c_str()
+			     << "\" needed by --rep-mask; build the index with --rep-k" << endl;
+			throw 1;
+		}
+		fclose(f);
+	}
+}
+
+/**
+ * Load the parts of the given index that the configured alignment mode
+ * needs.  The first index is loaded before the workers start.  With
+ * several -x indexes and no --all-indexes, the others are loaded by the
+ * first worker whose read falls through to them (while holding
+ * multiseed_idx_mutex), so an index no read needs is never loaded.
+ * idx.loaded is set last, with release semantics, so that a worker that
+ * sees it set without taking the mutex also sees the loaded components.
+ */
+static void loadSearchIndex(SearchIndex& idx) {
+	assert(!idx.loaded);
+	idx.refs = NULL;
+	idx.rep = NULL;
+	if(needOffsets()) {
+		Timer _t(cerr, "Time loading reference: ", timing);
+		idx.refs = new BitPairReference(
+			idx.base,
+			false,
+			sanityCheck,
+			NULL,
+			NULL,
+			false,
+			useMm,
+			useShmem,
+			mmSweep,
+			gVerbose,
+			startVerbose);
+		if(!idx.refs->loaded()) throw 1;
+	}
+	if(repMaskMin > 0) {
+		string repFile = idx.base + ".rep." + gEbwt_ext;
+		idx.rep = new RepeatKmers();
+		if(!idx.rep->load(repFile, repMaskMin, gVerbose || startVerbose)) {
+			cerr << "Error: could not load repeat k-mer table \"" << repFile.c_str()
+			     << "\" needed by --rep-mask; build the index with --rep-k" << endl;
+			throw 1;
+		}
+	}
+	{
+		// Load the other half of the index into memory
+		assert(!idx.ebwtFw->isInMemory());
+		Timer _t(cerr, "Time loading forward index: ", timing);
+		idx.ebwtFw->loadIntoMemory(
+			0,  // colorspace?
+			-1, // not the reverse index
+			needOffsets(), // load SA samp? (yes, need forward index's SA samp)
+			true,          // load ftab (in forward index)
+			needOffsets(), // load rstarts (in forward index)
+			!noRefNames,   // load names?
+			startVerbose);
+	}
+	if(idx.ebwtBw != NULL) {
+		// Load the other half of the index into memory
+		assert(!idx.ebwtBw->isInMemory());
+		Timer _t(cerr, "Time loading mirror index: ", timing);
+		idx.ebwtBw->loadIntoMemory(
+			0, // colorspace?
+			// It's bidirectional search, so we need the reverse to be
+			// constructed as the reverse of the concatenated strings.
+			1,
+			false,        // don't load SA samp in reverse index
+			true,         // yes, need ftab in reverse index
+			false,        // don't load rstarts in reverse index
+			!noRefNames,  // load names?
+			startVerbose);
+	}
+	__atomic_store_n(&idx.loaded, true, __ATOMIC_RELEASE);
+}
 
 /**
  * Metrics for measuring the work done by the outer read alignment
@@ -1962,16 +2316,17 @@ struct PerfMetrics {
 				/* 118 */ "DPBtFiltStart"  "\t"
 				/* 119 */ "DPBtFiltScore"  "\t"
 				/* 120 */ "DpBtFiltDom"    "\t"
+				/* 121 */ "CappedSeed"     "\t"
 #ifdef USE_MEM_TALLY
-				/* 121 */ "MemPeak"        "\t"
-				/* 122 */ "UncatMemPeak"   "\t" // 0
-				/* 123 */ "EbwtMemPeak"    "\t" // EBWT_CAT
-				/* 124 */ "CacheMemPeak"   "\t" // CA_CAT
-				/* 125 */ "ResolveMemPeak" "\t" // GW_CAT
-				/* 126 */ "AlignMemPeak"   "\t" // AL_CAT
-				/* 127 */ "DPMemPeak"      "\t" // DP_CAT
-				/* 128 */ "MiscMemPeak"    "\t" // MISC_CAT
-				/* 129 */ "DebugMemPeak"   "\t" // DEBUG_CAT
+				/* 122 */ "MemPeak"        "\t"
+				/* 123 */ "UncatMemPeak"   "\t" // 0
+				/* 124 */ "EbwtMemPeak"    "\t" // EBWT_CAT
+				/* 125 */ "CacheMemPeak"   "\t" // CA_CAT
+				/* 126 */ "ResolveMemPeak" "\t" // GW_CAT
+				/* 127 */ "AlignMemPeak"   "\t" // AL_CAT
+				/* 128 */ "DPMemPeak"      "\t" // DP_CAT
+				/* 129 */ "MiscMemPeak"    "\t" // MISC_CAT
+				/* 130 */ "DebugMemPeak"   "\t" // DEBUG_CAT
 #endif
 				"\n";
 			
@@ -2510,41 +2865,45 @@ struct PerfMetrics {
 		itoa10<uint64_t>(total ? nbtfiltdo : nbtfiltdo_u, buf);
 		if(metricsStderr) stderrSs << buf << '\t';
 		if(o != NULL) { o->writeChars(buf); o->write('\t'); }
+		// 121. Seeds dropped for exceeding --seed-cap
+		itoa10<uint64_t>(sd.cappedseed, buf);
+		if(metricsStderr) stderrSs << buf << '\t';
+		if(o != NULL) { o->writeChars(buf); o->write('\t'); }
 		
 #ifdef USE_MEM_TALLY
-		// 121. Overall memory peak
+		// 122. Overall memory peak
 		itoa10<size_t>(gMemTally.peak() >> 20, buf);
 		if(metricsStderr) stderrSs << buf << '\t';
 		if(o != NULL) { o->writeChars(buf); o->write('\t'); }
-		// 122. Uncategorized memory peak
+		// 123. Uncategorized memory peak
 		itoa10<size_t>(gMemTally.peak(0) >> 20, buf);
 		if(metricsStderr) stderrSs << buf << '\t';
 		if(o != NULL) { o->writeChars(buf); o->write('\t'); }
-		// 123. Ebwt memory peak
+		// 124. Ebwt memory peak
 		itoa10<size_t>(gMemTally.peak(EBWT_CAT) >> 20, buf);
 		if(metricsStderr) stderrSs << buf << '\t';
 		if(o != NULL) { o->writeChars(buf); o->write('\t'); }
-		// 124. Cache memory peak
+		// 125. Cache memory peak
 		itoa10<size_t>(gMemTally.peak(CA_CAT) >> 20, buf);
 		if(metricsStderr) stderrSs << buf << '\t';
 		if(o != NULL) { o->writeChars(buf); o->write('\t'); }
-		// 125. Resolver memory peak
+		// 126. Resolver memory peak
 		itoa10<size_t>(gMemTally.peak(GW_CAT) >> 20, buf);
 		if(metricsStderr) stderrSs << buf << '\t';
 		if(o != NULL) { o->writeChars(buf); o->write('\t'); }
-		// 126. Seed aligner memory peak
+		// 127. Seed aligner memory peak
 		itoa10<size_t>(gMemTally.peak(AL_CAT) >> 20, buf);
 		if(metricsStderr) stderrSs << buf << '\t';
 		if(o != NULL) { o->writeChars(buf); o->write('\t'); }
-		// 127. Dynamic programming aligner memory peak
+		// 128. Dynamic programming aligner memory peak
 		itoa10<size_t>(gMemTally.peak(DP_CAT) >> 20, buf);
 		if(metricsStderr) stderrSs << buf << '\t';
 		if(o != NULL) { o->writeChars(buf); o->write('\t'); }
-		// 128. Miscellaneous memory peak
+		// 129. Miscellaneous memory peak
 		itoa10<size_t>(gMemTally.peak(MISC_CAT) >> 20, buf);
 		if(metricsStderr) stderrSs << buf << '\t';
 		if(o != NULL) { o->writeChars(buf); o->write('\t'); }
-		// 129. Debug memory peak
+		// 130. Debug memory peak
 		itoa10<size_t>(gMemTally.peak(DEBUG_CAT) >> 20, buf);
 		if(metricsStderr) stderrSs << buf;
 		if(o != NULL) { o->writeChars(buf); }
@@ -2770,6 +3129,32 @@ static void setupMinScores(
 	}
 }
 
+// Add this thread's metrics since they were last reset to LiveCounts
+// 'cnt', for --met-live
+#define TALLY_METRICS(cnt) { \
+	cnt.reads    += olm.reads; \
+	cnt.bases    += olm.bases; \
+	cnt.mates    += rpm.mates(); \
+	cnt.aligned  += rpm.matesAligned(); \
+	cnt.seedHits += sdm.nelt; \
+	cnt.dps      += sseU8ExtendMet.dp + sseU8MateMet.dp + \
+	                sseI16ExtendMet.dp + sseI16MateMet.dp; \
+	cnt.dpCells  += sseU8ExtendMet.cell + sseU8MateMet.cell + \
+	                sseI16ExtendMet.cell + sseI16MateMet.cell; \
+}
+
+// Publish this thread's totals to the --met-live file
+#define PUBLISH_LIVE(done) { \
+	LiveCounts cur = liveBase; \
+	TALLY_METRICS(cur); \
+	liveStats->publish( \
+		(size_t)tid, \
+		cur, \
+		(done) ? 0 : ps->buffered(), \
+		msink.outq().pending((size_t)tid), \
+		done); \
+}
+
 #define MERGE_METRICS(met) { \
 	msink.mergeMetrics(rpm); \
 	met.merge( \
@@ -2786,6 +3171,7 @@ static void setupMinScores(
 		nbtfiltst, \
 		nbtfiltsc, \
 		nbtfiltdo); \
+	TALLY_METRICS(liveBase); \
 	olm.reset(); \
 	sdm.reset(); \
 	wlm.reset(); \
@@ -2866,17 +3252,15 @@ static void multiseedSearchWorker(void *vp) {
 static void multiseedSearchWorker(void *vp) {
 	int tid = *((int*)vp);
 #endif
-	assert(multiseed_ebwtFw != NULL);
-	assert(multiseedMms == 0 || multiseed_ebwtBw != NULL);
+	assert(!multiseed_idxs.empty());
 	PatternComposer&        patsrc   = *multiseed_patsrc;
 	PatternParams           pp       = multiseed_pp;
-	const Ebwt&             ebwtFw   = *multiseed_ebwtFw;
-	const Ebwt&             ebwtBw   = *multiseed_ebwtBw;
 	const Scoring&          sc       = *multiseed_sc;
-	const BitPairReference& ref      = *multiseed_refs;
 	AlignmentCache&         scShared = *multiseed_ca;
 	AlnSink&                msink    = *multiseed_msink;
 	OutFileBuf*             metricsOfb = multiseed_metricsOfb;
+	LiveStats*              liveStats = multiseed_liveStats;
+	LiveCounts              liveBase; // totals folded in by MERGE_METRICS
 
 	{
 #ifdef PER_THREAD_TIMING
@@ -2923,7 +3307,8 @@ static void multiseedSearchWorker(void *vp) {
 			0,                 // penalty gap (not used now)
 			msample,           // true -> -M was specified, otherwise assume -m
 			gReportDiscordant, // report discordang paired-end alignments?
-			gReportMixed);     // report unpaired alignments for paired reads?
+			gReportMixed,      // report unpaired alignments for paired reads?
+			mapqStop);         // stop once best score & MAPQ are settled
 
 		// Instantiate a mapping quality calculator
 		auto_ptr<Mapq> bmapq(new_mapq(mapqv, scoreMin, sc));
@@ -2989,6 +3374,18 @@ static void multiseedSearchWorker(void *vp) {
 			gOlapMatesOK,
 			gExpandToFrag);
 		
+		// Index-assisted best-first search, tried before seed-and-extend on
+		// short unpaired reads when --desc-len is set
+		DescentMetrics descm;
+		auto_ptr<AlignerDriver> ald(descMaxLen == 0 ? NULL : new AlignerDriver(
+			descConsExp,         // exponent for interpolating maximum penalty
+			descPrioritizeRoots, // whether to select roots with scores and weights
+			msIval,              // interval length, as function of read length
+			descLanding,         // landing length
+			gVerbose,            // verbose?
+			descentTotSz,        // limit on total bytes of best-first search data
+			descentTotFmops));   // limit on total number of FM index ops in BFS
+		
 		PerfMetrics metricsPt; // per-thread metrics object; for read-level metrics
 		BTString nametmp;
 		EList<Seed> seeds1, seeds2;
@@ -3013,10 +3410,12 @@ static void multiseedSearchWorker(void *vp) {
 		bool lenfilt[2] = { true, true };
 		// Keep track of whether mates 1/2 were filtered out by upstream qc
 		bool qcfilt[2]  = { true, true };
+		bool lcfilt[2]  = { true, true };
 
 		rndArb.init((uint32_t)time(0));
 		int mergei = 0;
 		int mergeival = 16;
+		int livei = 0;
 		bool done = false;
 		while(!done) {
 			pair<bool, bool> ret = ps->nextReadPair();
@@ -3037,6 +3436,9 @@ static void multiseedSearchWorker(void *vp) {
 				rnd.init(ROTL(ps->read_a().seed, 2));
 				sample = rnd.nextFloat() < sampleFrac;
 			}
+			if(shardCount > 1 && rdid % shardCount != shardIdx) {
+				sample = false;
+			}
 			if(rdid >= skipReads && rdid < qUpto && sample) {
 				// Align this read/pair
 				bool retry = true;
@@ -3089,11 +3491,16 @@ static void multiseedSearchWorker(void *vp) {
 					const size_t rdlen1 = ps->read_a().length();
 					const size_t rdlen2 = paired ? ps->read_b().length() : 0;
 					olm.bases += (rdlen1 + rdlen2);
+					// Best achievable scores, used to tell when --mapq-stop can
+					// end the search; unknown if match bonuses vary by quality
+					const bool perfKnown = (sc.matchType == COST_MODEL_CONSTANT);
 					msinkwrap.nextRead(
 						&ps->read_a(),
 						paired ? &ps->read_b() : NULL,
 						rdid,
-						sc.qualitiesMatter());
+						sc.qualitiesMatter(),
+						perfKnown ? sc.perfectScore(rdlen1) : MAX_I64,
+						perfKnown ? sc.perfectScore(rdlen2) : MAX_I64);
 					assert(msinkwrap.inited());
 					size_t rdlens[2] = { rdlen1, rdlen2 };
 					size_t rdrows[2] = { rdlen1, rdlen2 };
@@ -3168,8 +3575,17 @@ static void multiseedSearchWorker(void *vp) {
 						qcfilt[0] = (ps->read_a().filter != '0');
 						qcfilt[1] = (ps->read_b().filter != '0');
 					}
-					filt[0] = (nfilt[0] && scfilt[0] && lenfilt[0] && qcfilt[0]);
-					filt[1] = (nfilt[1] && scfilt[1] && lenfilt[1] && qcfilt[1]);
+					// Low-complexity filter; is the read too repetitive to
+					// be worth seeding?
+					lcfilt[0] = lcfilt[1] = true;
+					if(dustThresh > 0) {
+						lcfilt[0] = dustScore(ps->read_a().patFw) < dustThresh;
+						if(paired) {
+							lcfilt[1] = dustScore(ps->read_b().patFw) < dustThresh;
+						}
+					}
+					filt[0] = (nfilt[0] && scfilt[0] && lenfilt[0] && qcfilt[0] && lcfilt[0]);
+					filt[1] = (nfilt[1] && scfilt[1] && lenfilt[1] && qcfilt[1] && lcfilt[1]);
 					prm.nFilt += (filt[0] ? 0 : 1) + (filt[1] ? 0 : 1);
 					Read* rds[2] = { &ps->read_a(), &ps->read_b() };
 					// For each mate...
@@ -3260,519 +3676,301 @@ static void multiseedSearchWorker(void *vp) {
 						}
 					}
 					size_t eePeEeltLimit = std::numeric_limits<size_t>::max();
-					// Whether we're done with mate1 / mate2
-					bool done[2] = { !filt[0], !filt[1] };
-					size_t nelt[2] = {0, 0};
-										
-						// Find end-to-end exact alignments for each read
-						if(doExactUpFront) {
-							for(size_t matei = 0; matei < (paired ? 2:1); matei++) {
-								size_t mate = matemap[matei];
-								if(!filt[mate] || done[mate] || msinkwrap.state().doneWithMate(mate == 0)) {
-									continue;
+					size_t seedsTried = 0;
+					size_t seedsTriedMS[] = {0, 0, 0, 0};
+					size_t nUniqueSeeds = 0, nRepeatSeeds = 0, seedHitTot = 0;
+					size_t nUniqueSeedsMS[] = {0, 0, 0, 0};
+					size_t nRepeatSeedsMS[] = {0, 0, 0, 0};
+					size_t seedHitTotMS[] = {0, 0, 0, 0};
+					// Align to each index in turn.  Unless --all-indexes was
+					// given, stop once one of them yields an alignment.
+					for(size_t xi = 0; xi < multiseed_idxs.size(); xi++) {
+						SearchIndex& idx = multiseed_idxs[xi];
+						if(xi > 0) {
+							if(!allIndexes && !msinkwrap.empty()) {
+								break;
+							}
+							// Only the first read to reach this index takes
+							// the mutex to load it
+							if(!__atomic_load_n(&idx.loaded, __ATOMIC_ACQUIRE)) {
+								ThreadSafe ts(multiseed_idx_mutex);
+								if(!idx.loaded) {
+									loadSearchIndex(idx);
 								}
-								swmSeed.exatts++;
-								nelt[mate] = al.exactSweep(
-									ebwtFw,        // index
-									*rds[mate],    // read
-									sc,            // scoring scheme
-									nofw[mate],    // nofw?
-									norc[mate],    // norc?
-									2,             // max # edits we care about
-									minedfw[mate], // minimum # edits for fw mate
-									minedrc[mate], // minimum # edits for rc mate
-									true,          // report 0mm hits
-									shs[mate],     // put end-to-end results here
-									sdm);          // metrics
-								size_t bestmin = min(minedfw[mate], minedrc[mate]);
-								if(bestmin == 0) {
-									sdm.bestmin0++;
-								} else if(bestmin == 1) {
-									sdm.bestmin1++;
-								} else {
-									assert_eq(2, bestmin);
-									sdm.bestmin2++;
+							}
+							// Forget seed hits, redundancy information and
+							// effort spent on the previous index
+							ca.nextRead();
+							sd.nextRead(paired, rdrows[0], rdrows[1]);
+							for(size_t mate = 0; mate < (paired ? 2:1); mate++) {
+								if(filt[mate]) {
+									shs[mate].clear();
+									shs[mate].nextRead(mate == 0 ? ps->read_a() : ps->read_b());
 								}
 							}
-							matemap[0] = 0; matemap[1] = 1;
-							if(nelt[0] > 0 && nelt[1] > 0 && nelt[0] > nelt[1]) {
-								// Do the mate with fewer exact hits first
-								// TODO: Consider mates & orientations separately?
-								matemap[0] = 1; matemap[1] = 0;
+							prm.resetLimits();
+						}
+						const Ebwt&             ebwtFw = *idx.ebwtFw;
+						// The mirror index and the reference are NULL when the
+						// alignment mode doesn't need them; see needMirrorIndex()
+						// and needOffsets()
+						const Ebwt*             ebwtBw = idx.ebwtBw;
+						const BitPairReference* ref    = idx.refs;
+						const RepeatKmers*      rep    = idx.rep;
+						msinkwrap.setRefIdOffset(idx.refOff);
+						// Whether we're done with mate1 / mate2
+						bool done[2] = { !filt[0], !filt[1] };
+						size_t nelt[2] = {0, 0};
+					
+						// Short unpaired end-to-end reads are cheap to align by
+						// best-first descent through the index.  If the descent
+						// finds anything within its budget we keep it; otherwise
+						// nothing was reported and we fall back to
+						// seed-and-extend.
+						if(ald.get() != NULL && !paired && filt[0] && !localAlign &&
+						   !seedSumm && rdlens[0] <= descMaxLen)
+						{
+							ald->initRead(*rds[0], nofw[0], norc[0], minsc[0], -minsc[0], NULL);
+							ald->go(sc, ebwtFw, *ebwtBw, *ref, descm, wlm, prm, rnd, msinkwrap);
+							if(msinkwrap.state().numUnpaired1() > 0) {
+								done[0] = true;
 							}
-							for(size_t matei = 0; matei < (seedSumm ? 0:2); matei++) {
-								size_t mate = matemap[matei];
-								if(nelt[mate] == 0 || nelt[mate] > eePeEeltLimit) {
-									shs[mate].clearExactE2eHits();
-									continue;
-								}
-								if(msinkwrap.state().doneWithMate(mate == 0)) {
-									shs[mate].clearExactE2eHits();
-									done[mate] = true;
-									continue;
+						}
+										
+							// Find end-to-end exact alignments for each read
+							if(doExactUpFront) {
+								for(size_t matei = 0; matei < (paired ? 2:1); matei++) {
+									size_t mate = matemap[matei];
+									if(!filt[mate] || done[mate] || msinkwrap.state().doneWithMate(mate == 0)) {
+										continue;
+									}
+									swmSeed.exatts++;
+									nelt[mate] = al.exactSweep(
+										ebwtFw,        // index
+										*rds[mate],    // read
+										sc,            // scoring scheme
+										nofw[mate],    // nofw?
+										norc[mate],    // norc?
+										2,             // max # edits we care about
+										minedfw[mate], // minimum # edits for fw mate
+										minedrc[mate], // minimum # edits for rc mate
+										true,          // report 0mm hits
+										shs[mate],     // put end-to-end results here
+										sdm);          // metrics
+									size_t bestmin = min(minedfw[mate], minedrc[mate]);
+									if(bestmin == 0) {
+										sdm.bestmin0++;
+									} else if(bestmin == 1) {
+										sdm.bestmin1++;
+									} else {
+										assert_eq(2, bestmin);
+										sdm.bestmin2++;
+									}
 								}
-								assert(filt[mate]);
-								assert(matei == 0 || paired);
-								assert(!msinkwrap.maxed());
-								assert(msinkwrap.repOk());
-								int ret = 0;
-								if(paired) {
-									// Paired-end dynamic programming driver
-									ret = sd.extendSeedsPaired(
-										*rds[mate],     // mate to align as anchor
-										*rds[mate ^ 1], // mate to align as opp.
-										mate == 0,      // anchor is mate 1?
-										!filt[mate ^ 1],// opposite mate filtered out?
-										shs[mate],      // seed hits for anchor
-										ebwtFw,         // bowtie index
-										&ebwtBw,        // rev bowtie index
-										ref,            // packed reference strings
-										sw,             // dyn prog aligner, anchor
-										osw,            // dyn prog aligner, opposite
-										sc,             // scoring scheme
-										pepol,          // paired-end policy
-										-1,             // # mms allowed in a seed
-										0,              // length of a seed
-										0,              // interval between seeds
-										minsc[mate],    // min score for anchor
-										minsc[mate^1],  // min score for opp.
-										nceil[mate],    // N ceil for anchor
-										nceil[mate^1],  // N ceil for opp.
-										nofw[mate],     // don't align forward read
-										norc[mate],     // don't align revcomp read
-										maxhalf,        // max width on one DP side
-										doUngapped,     // do ungapped alignment
-										mxIter[mate],   // max extend loop iters
-										mxUg[mate],     // max # ungapped extends
-										mxDp[mate],     // max # DPs
-										streak[mate],   // stop after streak of this many end-to-end fails
-										streak[mate],   // stop after streak of this many ungap fails
-										streak[mate],   // stop after streak of this many dp fails
-										mtStreak[mate], // max mate fails per seed range
-										doExtend,       // extend seed hits
-										enable8,        // use 8-bit SSE where possible
-										cminlen,        // checkpoint if read is longer
-										cpow2,          // checkpointer interval, log2
-										doTri,          // triangular mini-fills?
-										tighten,        // -M score tightening mode
-										ca,             // seed alignment cache
-										rnd,            // pseudo-random source
-										wlm,            // group walk left metrics
-										swmSeed,        // DP metrics, seed extend
-										swmMate,        // DP metrics, mate finding
-										prm,            // per-read metrics
-										&msinkwrap,     // for organizing hits
-										true,           // seek mate immediately
-										true,           // report hits once found
-										gReportDiscordant,// look for discordant alns?
-										gReportMixed,   // look for unpaired alns?
-										exhaustive[mate]);
-									// Might be done, but just with this mate
-								} else {
-									// Unpaired dynamic programming driver
-									ret = sd.extendSeeds(
-										*rds[mate],     // read
-										mate == 0,      // mate #1?
-										shs[mate],      // seed hits
-										ebwtFw,         // bowtie index
-										&ebwtBw,        // rev bowtie index
-										ref,            // packed reference strings
-										sw,             // dynamic prog aligner
-										sc,             // scoring scheme
-										-1,             // # mms allowed in a seed
-										0,              // length of a seed
-										0,              // interval between seeds
-										minsc[mate],    // minimum score for valid
-										nceil[mate],    // N ceil for anchor
-										maxhalf,        // max width on one DP side
-										doUngapped,     // do ungapped alignment
-										mxIter[mate],   // max extend loop iters
-										mxUg[mate],     // max # ungapped extends
-										mxDp[mate],     // max # DPs
-										streak[mate],   // stop after streak of this many end-to-end fails
-										streak[mate],   // stop after streak of this many ungap fails
-										doExtend,       // extend seed hits
-										enable8,        // use 8-bit SSE where possible
-										cminlen,        // checkpoint if read is longer
-										cpow2,          // checkpointer interval, log2
-										doTri,          // triangular mini-fills
-										tighten,        // -M score tightening mode
-										ca,             // seed alignment cache
-										rnd,            // pseudo-random source
-										wlm,            // group walk left metrics
-										swmSeed,        // DP metrics, seed extend
-										prm,            // per-read metrics
-										&msinkwrap,     // for organizing hits
-										true,           // report hits once found
-										exhaustive[mate]);
+								matemap[0] = 0; matemap[1] = 1;
+								if(nelt[0] > 0 && nelt[1] > 0 && nelt[0] > nelt[1]) {
+									// Do the mate with fewer exact hits first
+									// TODO: Consider mates & orientations separately?
+									matemap[0] = 1; matemap[1] = 0;
 								}
-								assert_gt(ret, 0);
-								MERGE_SW(sw);
-								MERGE_SW(osw);
-								// Clear out the exact hits so that we don't try to
-								// extend them again later!
-								shs[mate].clearExactE2eHits();
-								if(ret == EXTEND_EXHAUSTED_CANDIDATES) {
-									// Not done yet
-								} else if(ret == EXTEND_POLICY_FULFILLED) {
-									// Policy is satisfied for this mate at least
+								for(size_t matei = 0; matei < (seedSumm ? 0:2); matei++) {
+									size_t mate = matemap[matei];
+									if(nelt[mate] == 0 || nelt[mate] > eePeEeltLimit) {
+										shs[mate].clearExactE2eHits();
+										continue;
+									}
 									if(msinkwrap.state().doneWithMate(mate == 0)) {
+										shs[mate].clearExactE2eHits();
 										done[mate] = true;
+										continue;
 									}
-									if(msinkwrap.state().doneWithMate(mate == 1)) {
-										done[mate^1] = true;
+									assert(filt[mate]);
+									assert(matei == 0 || paired);
+									assert(!msinkwrap.maxed());
+									assert(msinkwrap.repOk());
+									int ret = 0;
+									if(paired) {
+										// Paired-end dynamic programming driver
+										ret = sd.extendSeedsPaired(
+											*rds[mate],     // mate to align as anchor
+											*rds[mate ^ 1], // mate to align as opp.
+											mate == 0,      // anchor is mate 1?
+											!filt[mate ^ 1],// opposite mate filtered out?
+											shs[mate],      // seed hits for anchor
+											mateIsect ? &shs[mate ^ 1] : NULL, // opp. seed hits to intersect
+											ebwtFw,         // bowtie index
+											ebwtBw,         // rev bowtie index
+											*ref,           // packed reference strings
+											sw,             // dyn prog aligner, anchor
+											osw,            // dyn prog aligner, opposite
+											sc,             // scoring scheme
+											pepol,          // paired-end policy
+											-1,             // # mms allowed in a seed
+											0,              // length of a seed
+											0,              // interval between seeds
+											minsc[mate],    // min score for anchor
+											minsc[mate^1],  // min score for opp.
+											nceil[mate],    // N ceil for anchor
+											nceil[mate^1],  // N ceil for opp.
+											nofw[mate],     // don't align forward read
+											norc[mate],     // don't align revcomp read
+											maxhalf,        // max width on one DP side
+											doUngapped,     // do ungapped alignment
+											mxIter[mate],   // max extend loop iters
+											mxUg[mate],     // max # ungapped extends
+											mxDp[mate],     // max # DPs
+											streak[mate],   // stop after streak of this many end-to-end fails
+											streak[mate],   // stop after streak of this many ungap fails
+											streak[mate],   // stop after streak of this many dp fails
+											mtStreak[mate], // max mate fails per seed range
+											doExtend,       // extend seed hits
+											enable8,        // use 8-bit SSE where possible
+											cminlen,        // checkpoint if read is longer
+											cpow2,          // checkpointer interval, log2
+											doTri,          // triangular mini-fills?
+											tighten,        // -M score tightening mode
+											ca,             // seed alignment cache
+											rnd,            // pseudo-random source
+											wlm,            // group walk left metrics
+											swmSeed,        // DP metrics, seed extend
+											swmMate,        // DP metrics, mate finding
+											prm,            // per-read metrics
+											&msinkwrap,     // for organizing hits
+											true,           // seek mate immediately
+											true,           // report hits once found
+											gReportDiscordant,// look for discordant alns?
+											gReportMixed,   // look for unpaired alns?
+											exhaustive[mate]);
+										// Might be done, but just with this mate
+									} else {
+										// Unpaired dynamic programming driver
+										ret = sd.extendSeeds(
+											*rds[mate],     // read
+											mate == 0,      // mate #1?
+											shs[mate],      // seed hits
+											ebwtFw,         // bowtie index
+											ebwtBw,         // rev bowtie index
+											*ref,           // packed reference strings
+											sw,             // dynamic prog aligner
+											sc,             // scoring scheme
+											-1,             // # mms allowed in a seed
+											0,              // length of a seed
+											0,              // interval between seeds
+											minsc[mate],    // minimum score for valid
+											nceil[mate],    // N ceil for anchor
+											maxhalf,        // max width on one DP side
+											doUngapped,     // do ungapped alignment
+											mxIter[mate],   // max extend loop iters
+											mxUg[mate],     // max # ungapped extends
+											mxDp[mate],     // max # DPs
+											streak[mate],   // stop after streak of this many end-to-end fails
+											streak[mate],   // stop after streak of this many ungap fails
+											doExtend,       // extend seed hits
+											enable8,        // use 8-bit SSE where possible
+											cminlen,        // checkpoint if read is longer
+											cpow2,          // checkpointer interval, log2
+											doTri,          // triangular mini-fills
+											tighten,        // -M score tightening mode
+											ca,             // seed alignment cache
+											rnd,            // pseudo-random source
+											wlm,            // group walk left metrics
+											swmSeed,        // DP metrics, seed extend
+											prm,            // per-read metrics
+											&msinkwrap,     // for organizing hits
+											true,           // report hits once found
+											exhaustive[mate]);
 									}
-								} else if(ret == EXTEND_PERFECT_SCORE) {
-									// We exhausted this mode at least
-									done[mate] = true;
-								} else if(ret == EXTEND_EXCEEDED_HARD_LIMIT) {
-									// We exceeded a per-read limit
-									done[mate] = true;
-								} else if(ret == EXTEND_EXCEEDED_SOFT_LIMIT) {
-									// Not done yet
-								} else {
-									//
-									cerr << "Bad return value: " << ret << endl;
-									throw 1;
-								}
-								if(!done[mate]) {
-									TAlScore perfectScore = sc.perfectScore(rdlens[mate]);
-									if(!done[mate] && minsc[mate] == perfectScore) {
+									assert_gt(ret, 0);
+									MERGE_SW(sw);
+									MERGE_SW(osw);
+									// Clear out the exact hits so that we don't try to
+									// extend them again later!
+									shs[mate].clearExactE2eHits();
+									if(ret == EXTEND_EXHAUSTED_CANDIDATES) {
+										// Not done yet
+									} else if(ret == EXTEND_POLICY_FULFILLED) {
+										// Policy is satisfied for this mate at least
+										if(msinkwrap.state().doneWithMate(mate == 0)) {
+											done[mate] = true;
+										}
+										if(msinkwrap.state().doneWithMate(mate == 1)) {
+											done[mate^1] = true;
+										}
+									} else if(ret == EXTEND_PERFECT_SCORE) {
+										// We exhausted this mode at least
+										done[mate] = true;
+									} else if(ret == EXTEND_EXCEEDED_HARD_LIMIT) {
+										// We exceeded a per-read limit
 										done[mate] = true;
+									} else if(ret == EXTEND_EXCEEDED_SOFT_LIMIT) {
+										// Not done yet
+									} else {
+										//
+										cerr << "Bad return value: " << ret << endl;
+										throw 1;
+									}
+									if(!done[mate]) {
+										TAlScore perfectScore = sc.perfectScore(rdlens[mate]);
+										if(!done[mate] && minsc[mate] == perfectScore) {
+											done[mate] = true;
+										}
 									}
 								}
 							}
-						}
 
-						// 1-mismatch
-						if(do1mmUpFront && !seedSumm) {
-							for(size_t matei = 0; matei < (paired ? 2:1); matei++) {
-								size_t mate = matemap[matei];
-								if(!filt[mate] || done[mate] || nelt[mate] > eePeEeltLimit) {
-									// Done with this mate
-									shs[mate].clear1mmE2eHits();
+							// 1-mismatch
+							if(do1mmUpFront && !seedSumm) {
+								for(size_t matei = 0; matei < (paired ? 2:1); matei++) {
+									size_t mate = matemap[matei];
+									if(!filt[mate] || done[mate] || nelt[mate] > eePeEeltLimit) {
+										// Done with this mate
+										shs[mate].clear1mmE2eHits();
+										nelt[mate] = 0;
+										continue;
+									}
 									nelt[mate] = 0;
-									continue;
-								}
-								nelt[mate] = 0;
-								assert(!msinkwrap.maxed());
-								assert(msinkwrap.repOk());
-								//rnd.init(ROTL(rds[mate]->seed, 10));
-								assert(shs[mate].empty());
-								assert(shs[mate].repOk(&ca.current()));
-								bool yfw = minedfw[mate] <= 1 && !nofw[mate];
-								bool yrc = minedrc[mate] <= 1 && !norc[mate];
-								if(yfw || yrc) {
-									// Clear out the exact hits
-									swmSeed.mm1atts++;
-									al.oneMmSearch(
-										&ebwtFw,        // BWT index
-										&ebwtBw,        // BWT' index
-										*rds[mate],     // read
-										sc,             // scoring scheme
-										minsc[mate],    // minimum score
-										!yfw,           // don't align forward read
-										!yrc,           // don't align revcomp read
-										localAlign,     // must be legal local alns?
-										false,          // do exact match
-										true,           // do 1mm
-										shs[mate],      // seed hits (hits installed here)
-										sdm);           // metrics
-									nelt[mate] = shs[mate].num1mmE2eHits();
-								}
-							}
-							// Possibly reorder the mates
-							matemap[0] = 0; matemap[1] = 1;
-							if(nelt[0] > 0 && nelt[1] > 0 && nelt[0] > nelt[1]) {
-								// Do the mate with fewer exact hits first
-								// TODO: Consider mates & orientations separately?
-								matemap[0] = 1; matemap[1] = 0;
-							}
-							for(size_t matei = 0; matei < (seedSumm ? 0:2); matei++) {
-								size_t mate = matemap[matei];
-								if(nelt[mate] == 0 || nelt[mate] > eePeEeltLimit) {
-									continue;
+									assert(!msinkwrap.maxed());
+									assert(msinkwrap.repOk());
+									//rnd.init(ROTL(rds[mate]->seed, 10));
+									assert(shs[mate].empty());
+									assert(shs[mate].repOk(&ca.current()));
+									bool yfw = minedfw[mate] <= 1 && !nofw[mate];
+									bool yrc = minedrc[mate] <= 1 && !norc[mate];
+									if(yfw || yrc) {
+										// Clear out the exact hits
+										swmSeed.mm1atts++;
+										al.oneMmSearch(
+											&ebwtFw,        // BWT index
+											ebwtBw,         // BWT' index
+											*rds[mate],     // read
+											sc,             // scoring scheme
+											minsc[mate],    // minimum score
+											!yfw,           // don't align forward read
+											!yrc,           // don't align revcomp read
+											localAlign,     // must be legal local alns?
+											false,          // do exact match
+											true,           // do 1mm
+											shs[mate],      // seed hits (hits installed here)
+											sdm);           // metrics
+										nelt[mate] = shs[mate].num1mmE2eHits();
+									}
 								}
-								if(msinkwrap.state().doneWithMate(mate == 0)) {
-									done[mate] = true;
-									continue;
+								// Possibly reorder the mates
+								matemap[0] = 0; matemap[1] = 1;
+								if(nelt[0] > 0 && nelt[1] > 0 && nelt[0] > nelt[1]) {
+									// Do the mate with fewer exact hits first
+									// TODO: Consider mates & orientations separately?
+									matemap[0] = 1; matemap[1] = 0;
 								}
-								int ret = 0;
-								if(paired) {
-									// Paired-end dynamic programming driver
-									ret = sd.extendSeedsPaired(
-										*rds[mate],     // mate to align as anchor
-										*rds[mate ^ 1], // mate to align as opp.
-										mate == 0,      // anchor is mate 1?
-										!filt[mate ^ 1],// opposite mate filtered out?
-										shs[mate],      // seed hits for anchor
-										ebwtFw,         // bowtie index
-										&ebwtBw,        // rev bowtie index
-										ref,            // packed reference strings
-										sw,             // dyn prog aligner, anchor
-										osw,            // dyn prog aligner, opposite
-										sc,             // scoring scheme
-										pepol,          // paired-end policy
-										-1,             // # mms allowed in a seed
-										0,              // length of a seed
-										0,              // interval between seeds
-										minsc[mate],    // min score for anchor
-										minsc[mate^1],  // min score for opp.
-										nceil[mate],    // N ceil for anchor
-										nceil[mate^1],  // N ceil for opp.
-										nofw[mate],     // don't align forward read
-										norc[mate],     // don't align revcomp read
-										maxhalf,        // max width on one DP side
-										doUngapped,     // do ungapped alignment
-										mxIter[mate],   // max extend loop iters
-										mxUg[mate],     // max # ungapped extends
-										mxDp[mate],     // max # DPs
-										streak[mate],   // stop after streak of this many end-to-end fails
-										streak[mate],   // stop after streak of this many ungap fails
-										streak[mate],   // stop after streak of this many dp fails
-										mtStreak[mate], // max mate fails per seed range
-										doExtend,       // extend seed hits
-										enable8,        // use 8-bit SSE where possible
-										cminlen,        // checkpoint if read is longer
-										cpow2,          // checkpointer interval, log2
-										doTri,          // triangular mini-fills?
-										tighten,        // -M score tightening mode
-										ca,             // seed alignment cache
-										rnd,            // pseudo-random source
-										wlm,            // group walk left metrics
-										swmSeed,        // DP metrics, seed extend
-										swmMate,        // DP metrics, mate finding
-										prm,            // per-read metrics
-										&msinkwrap,     // for organizing hits
-										true,           // seek mate immediately
-										true,           // report hits once found
-										gReportDiscordant,// look for discordant alns?
-										gReportMixed,   // look for unpaired alns?
-										exhaustive[mate]);
-									// Might be done, but just with this mate
-								} else {
-									// Unpaired dynamic programming driver
-									ret = sd.extendSeeds(
-										*rds[mate],     // read
-										mate == 0,      // mate #1?
-										shs[mate],      // seed hits
-										ebwtFw,         // bowtie index
-										&ebwtBw,        // rev bowtie index
-										ref,            // packed reference strings
-										sw,             // dynamic prog aligner
-										sc,             // scoring scheme
-										-1,             // # mms allowed in a seed
-										0,              // length of a seed
-										0,              // interval between seeds
-										minsc[mate],    // minimum score for valid
-										nceil[mate],    // N ceil for anchor
-										maxhalf,        // max width on one DP side
-										doUngapped,     // do ungapped alignment
-										mxIter[mate],   // max extend loop iters
-										mxUg[mate],     // max # ungapped extends
-										mxDp[mate],     // max # DPs
-										streak[mate],   // stop after streak of this many end-to-end fails
-										streak[mate],   // stop after streak of this many ungap fails
-										doExtend,       // extend seed hits
-										enable8,        // use 8-bit SSE where possible
-										cminlen,        // checkpoint if read is longer
-										cpow2,          // checkpointer interval, log2
-										doTri,          // triangular mini-fills?
-										tighten,        // -M score tightening mode
-										ca,             // seed alignment cache
-										rnd,            // pseudo-random source
-										wlm,            // group walk left metrics
-										swmSeed,        // DP metrics, seed extend
-										prm,            // per-read metrics
-										&msinkwrap,     // for organizing hits
-										true,           // report hits once found
-										exhaustive[mate]);
-								}
-								assert_gt(ret, 0);
-								MERGE_SW(sw);
-								MERGE_SW(osw);
-								// Clear out the 1mm hits so that we don't try to
-								// extend them again later!
-								shs[mate].clear1mmE2eHits();
-								if(ret == EXTEND_EXHAUSTED_CANDIDATES) {
-									// Not done yet
-								} else if(ret == EXTEND_POLICY_FULFILLED) {
-									// Policy is satisfied for this mate at least
-									if(msinkwrap.state().doneWithMate(mate == 0)) {
-										done[mate] = true;
+								for(size_t matei = 0; matei < (seedSumm ? 0:2); matei++) {
+									size_t mate = matemap[matei];
+									if(nelt[mate] == 0 || nelt[mate] > eePeEeltLimit) {
+										continue;
 									}
-									if(msinkwrap.state().doneWithMate(mate == 1)) {
-										done[mate^1] = true;
-									}
-								} else if(ret == EXTEND_PERFECT_SCORE) {
-									// We exhausted this mode at least
-									done[mate] = true;
-								} else if(ret == EXTEND_EXCEEDED_HARD_LIMIT) {
-									// We exceeded a per-read limit
-									done[mate] = true;
-								} else if(ret == EXTEND_EXCEEDED_SOFT_LIMIT) {
-									// Not done yet
-								} else {
-									//
-									cerr << "Bad return value: " << ret << endl;
-									throw 1;
-								}
-								if(!done[mate]) {
-									TAlScore perfectScore = sc.perfectScore(rdlens[mate]);
-									if(!done[mate] && minsc[mate] == perfectScore) {
+									if(msinkwrap.state().doneWithMate(mate == 0)) {
 										done[mate] = true;
+										continue;
 									}
-								}
-							}
-						}
-						int seedlens[2] = { multiseedLen, multiseedLen };
-						nrounds[0] = min<size_t>(nrounds[0], interval[0]);
-						nrounds[1] = min<size_t>(nrounds[1], interval[1]);
-						Constraint gc = Constraint::penaltyFuncBased(scoreMin);
-						size_t seedsTried = 0;
-					size_t seedsTriedMS[] = {0, 0, 0, 0};
-						size_t nUniqueSeeds = 0, nRepeatSeeds = 0, seedHitTot = 0;
-					size_t nUniqueSeedsMS[] = {0, 0, 0, 0};
-					size_t nRepeatSeedsMS[] = {0, 0, 0, 0};
-					size_t seedHitTotMS[] = {0, 0, 0, 0};
-						for(size_t roundi = 0; roundi < nSeedRounds; roundi++) {
-							ca.nextRead(); // Clear cache in preparation for new search
-							shs[0].clearSeeds();
-							shs[1].clearSeeds();
-							assert(shs[0].empty());
-							assert(shs[1].empty());
-							assert(shs[0].repOk(&ca.current()));
-							assert(shs[1].repOk(&ca.current()));
-							//if(roundi > 0) {
-							//	if(seedlens[0] > 8) seedlens[0]--;
-							//	if(seedlens[1] > 8) seedlens[1]--;
-							//}
-							for(size_t matei = 0; matei < (paired ? 2:1); matei++) {
-								size_t mate = matemap[matei];
-								if(done[mate] || msinkwrap.state().doneWithMate(mate == 0)) {
-									// Done with this mate
-									done[mate] = true;
-									continue;
-								}
-								if(roundi >= nrounds[mate]) {
-									// Not doing this round for this mate
-									continue;
-								}
-								// Figure out the seed offset
-								if(interval[mate] <= (int)roundi) {
-									// Can't do this round, seeds already packed as
-									// tight as possible
-									continue; 
-								}
-								size_t offset = (interval[mate] * roundi) / nrounds[mate];
-								assert(roundi == 0 || offset > 0);
-								assert(!msinkwrap.maxed());
-								assert(msinkwrap.repOk());
-								//rnd.init(ROTL(rds[mate]->seed, 10));
-								assert(shs[mate].repOk(&ca.current()));
-								swmSeed.sdatts++;
-								// Set up seeds
-								seeds[mate]->clear();
-								Seed::mmSeeds(
-									multiseedMms,    // max # mms per seed
-									seedlens[mate],  // length of a multiseed seed
-									*seeds[mate],    // seeds
-									gc);             // global constraint
-								// Check whether the offset would drive the first seed
-								// off the end
-								if(offset > 0 && (*seeds[mate])[0].len + offset > rds[mate]->length()) {
-									continue;
-								}
-								// Instantiate the seeds
-							std::pair<int, int> instFw, instRc;
-								std::pair<int, int> inst = al.instantiateSeeds(
-									*seeds[mate],   // search seeds
-									offset,         // offset to begin extracting
-									interval[mate], // interval between seeds
-									*rds[mate],     // read to align
-									sc,             // scoring scheme
-									nofw[mate],     // don't align forward read
-									norc[mate],     // don't align revcomp read
-									ca,             // holds some seed hits from previous reads
-									shs[mate],      // holds all the seed hits
-								sdm,            // metrics
-								instFw,
-								instRc);
-								assert(shs[mate].repOk(&ca.current()));
-								if(inst.first + inst.second == 0) {
-									// No seed hits!  Done with this mate.
-									assert(shs[mate].empty());
-									done[mate] = true;
-									break;
-								}
-								seedsTried += (inst.first + inst.second);
-							seedsTriedMS[mate * 2 + 0] = instFw.first + instFw.second;
-							seedsTriedMS[mate * 2 + 1] = instRc.first + instRc.second;
-								// Align seeds
-								al.searchAllSeeds(
-									*seeds[mate],     // search seeds
-									&ebwtFw,          // BWT index
-									&ebwtBw,          // BWT' index
-									*rds[mate],       // read
-									sc,               // scoring scheme
-									ca,               // alignment cache
-									shs[mate],        // store seed hits here
-									sdm,              // metrics
-									prm);             // per-read metrics
-								assert(shs[mate].repOk(&ca.current()));
-								if(shs[mate].empty()) {
-									// No seed alignments!  Done with this mate.
-									done[mate] = true;
-									break;
-								}
-							}
-							// shs contain what we need to know to update our seed
-							// summaries for this seeding
-							for(size_t mate = 0; mate < 2; mate++) {
-								if(!shs[mate].empty()) {
-									nUniqueSeeds += shs[mate].numUniqueSeeds();
-								nUniqueSeedsMS[mate * 2 + 0] += shs[mate].numUniqueSeedsStrand(true);
-								nUniqueSeedsMS[mate * 2 + 1] += shs[mate].numUniqueSeedsStrand(false);
-									nRepeatSeeds += shs[mate].numRepeatSeeds();
-								nRepeatSeedsMS[mate * 2 + 0] += shs[mate].numRepeatSeedsStrand(true);
-								nRepeatSeedsMS[mate * 2 + 1] += shs[mate].numRepeatSeedsStrand(false);
-									seedHitTot += shs[mate].numElts();
-								seedHitTotMS[mate * 2 + 0] += shs[mate].numEltsFw();
-								seedHitTotMS[mate * 2 + 1] += shs[mate].numEltsRc();
-								}
-							}
-							double uniqFactor[2] = { 0.0f, 0.0f };
-							for(size_t i = 0; i < 2; i++) {
-								if(!shs[i].empty()) {
-									swmSeed.sdsucc++;
-									uniqFactor[i] = shs[i].uniquenessFactor();
-								}
-							}
-							// Possibly reorder the mates
-							matemap[0] = 0; matemap[1] = 1;
-							if(!shs[0].empty() && !shs[1].empty() && uniqFactor[1] > uniqFactor[0]) {
-								// Do the mate with fewer exact hits first
-								// TODO: Consider mates & orientations separately?
-								matemap[0] = 1; matemap[1] = 0;
-							}
-							for(size_t matei = 0; matei < (paired ? 2:1); matei++) {
-								size_t mate = matemap[matei];
-								if(done[mate] || msinkwrap.state().doneWithMate(mate == 0)) {
-									// Done with this mate
-									done[mate] = true;
-									continue;
-								}
-								assert(!msinkwrap.maxed());
-								assert(msinkwrap.repOk());
-								//rnd.init(ROTL(rds[mate]->seed, 10));
-								assert(shs[mate].repOk(&ca.current()));
-								if(!seedSumm) {
-									// If there aren't any seed hits...
-									if(shs[mate].empty()) {
-										continue; // on to the next mate
-									}
-									// Sort seed hits into ranks
-									shs[mate].rankSeedHits(rnd, msinkwrap.allHits());
 									int ret = 0;
 									if(paired) {
 										// Paired-end dynamic programming driver
@@ -3782,16 +3980,17 @@ static void multiseedSearchWorker(void *vp) {
 											mate == 0,      // anchor is mate 1?
 											!filt[mate ^ 1],// opposite mate filtered out?
 											shs[mate],      // seed hits for anchor
+											mateIsect ? &shs[mate ^ 1] : NULL, // opp. seed hits to intersect
 											ebwtFw,         // bowtie index
-											&ebwtBw,        // rev bowtie index
-											ref,            // packed reference strings
+											ebwtBw,         // rev bowtie index
+											*ref,           // packed reference strings
 											sw,             // dyn prog aligner, anchor
 											osw,            // dyn prog aligner, opposite
 											sc,             // scoring scheme
 											pepol,          // paired-end policy
-											multiseedMms,   // # mms allowed in a seed
-											seedlens[mate], // length of a seed
-											interval[mate], // interval between seeds
+											-1,             // # mms allowed in a seed
+											0,              // length of a seed
+											0,              // interval between seeds
 											minsc[mate],    // min score for anchor
 											minsc[mate^1],  // min score for opp.
 											nceil[mate],    // N ceil for anchor
@@ -3833,13 +4032,13 @@ static void multiseedSearchWorker(void *vp) {
 											mate == 0,      // mate #1?
 											shs[mate],      // seed hits
 											ebwtFw,         // bowtie index
-											&ebwtBw,        // rev bowtie index
-											ref,            // packed reference strings
+											ebwtBw,         // rev bowtie index
+											*ref,           // packed reference strings
 											sw,             // dynamic prog aligner
 											sc,             // scoring scheme
-											multiseedMms,   // # mms allowed in a seed
-											seedlens[mate], // length of a seed
-											interval[mate], // interval between seeds
+											-1,             // # mms allowed in a seed
+											0,              // length of a seed
+											0,              // interval between seeds
 											minsc[mate],    // minimum score for valid
 											nceil[mate],    // N ceil for anchor
 											maxhalf,        // max width on one DP side
@@ -3867,6 +4066,9 @@ static void multiseedSearchWorker(void *vp) {
 									assert_gt(ret, 0);
 									MERGE_SW(sw);
 									MERGE_SW(osw);
+									// Clear out the 1mm hits so that we don't try to
+									// extend them again later!
+									shs[mate].clear1mmE2eHits();
 									if(ret == EXTEND_EXHAUSTED_CANDIDATES) {
 										// Not done yet
 									} else if(ret == EXTEND_POLICY_FULFILLED) {
@@ -3878,7 +4080,7 @@ static void multiseedSearchWorker(void *vp) {
 											done[mate^1] = true;
 										}
 									} else if(ret == EXTEND_PERFECT_SCORE) {
-										// We exhausted this made at least
+										// We exhausted this mode at least
 										done[mate] = true;
 									} else if(ret == EXTEND_EXCEEDED_HARD_LIMIT) {
 										// We exceeded a per-read limit
@@ -3890,18 +4092,297 @@ static void multiseedSearchWorker(void *vp) {
 										cerr << "Bad return value: " << ret << endl;
 										throw 1;
 									}
-								} // if(!seedSumm)
-							} // for(size_t matei = 0; matei < 2; matei++)
-							
-							// We don't necessarily have to continue investigating both
-							// mates.  We continue on a mate only if its average
-							// interval length is high (> 1000)
-							for(size_t mate = 0; mate < 2; mate++) {
-								if(!done[mate] && shs[mate].averageHitsPerSeed() < seedBoostThresh) {
-									done[mate] = true;
+									if(!done[mate]) {
+										TAlScore perfectScore = sc.perfectScore(rdlens[mate]);
+										if(!done[mate] && minsc[mate] == perfectScore) {
+											done[mate] = true;
+										}
+									}
 								}
 							}
-						} // end loop over reseeding rounds
+							int seedlens[2] = { multiseedLen, multiseedLen };
+							nrounds[0] = min<size_t>(nrounds[0], interval[0]);
+							nrounds[1] = min<size_t>(nrounds[1], interval[1]);
+							Constraint gc = Constraint::penaltyFuncBased(scoreMin);
+							for(size_t roundi = 0; roundi < nSeedRounds; roundi++) {
+								ca.nextRead(); // Clear cache in preparation for new search
+								shs[0].clearSeeds();
+								shs[1].clearSeeds();
+								assert(shs[0].empty());
+								assert(shs[1].empty());
+								assert(shs[0].repOk(&ca.current()));
+								assert(shs[1].repOk(&ca.current()));
+								//if(roundi > 0) {
+								//	if(seedlens[0] > 8) seedlens[0]--;
+								//	if(seedlens[1] > 8) seedlens[1]--;
+								//}
+								for(size_t matei = 0; matei < (paired ? 2:1); matei++) {
+									size_t mate = matemap[matei];
+									if(done[mate] || msinkwrap.state().doneWithMate(mate == 0)) {
+										// Done with this mate
+										done[mate] = true;
+										continue;
+									}
+									if(roundi >= nrounds[mate]) {
+										// Not doing this round for this mate
+										continue;
+									}
+									// Figure out the seed offset
+									if(interval[mate] <= (int)roundi) {
+										// Can't do this round, seeds already packed as
+										// tight as possible
+										continue; 
+									}
+									size_t offset = (interval[mate] * roundi) / nrounds[mate];
+									assert(roundi == 0 || offset > 0);
+									assert(!msinkwrap.maxed());
+									assert(msinkwrap.repOk());
+									//rnd.init(ROTL(rds[mate]->seed, 10));
+									assert(shs[mate].repOk(&ca.current()));
+									swmSeed.sdatts++;
+									// Set up seeds
+									seeds[mate]->clear();
+									Seed::mmSeeds(
+										multiseedMms,    // max # mms per seed
+										seedlens[mate],  // length of a multiseed seed
+										*seeds[mate],    // seeds
+										gc);             // global constraint
+									// Check whether the offset would drive the first seed
+									// off the end
+									if(offset > 0 && (*seeds[mate])[0].len + offset > rds[mate]->length()) {
+										continue;
+									}
+									// With minimizers, by default pick windows so that
+									// seed density matches the fixed-interval scheme
+									int miniWin = 0;
+									if(seedMinimizers) {
+										miniWin = seedMiniWin > 0 ?
+											seedMiniWin : max<int>(1, 2 * interval[mate] - 1);
+									}
+									// Instantiate the seeds
+								std::pair<int, int> instFw, instRc;
+									std::pair<int, int> inst = al.instantiateSeeds(
+										*seeds[mate],   // search seeds
+										offset,         // offset to begin extracting
+										interval[mate], // interval between seeds
+										miniWin,        // minimizer window
+										*rds[mate],     // read to align
+										sc,             // scoring scheme
+										nofw[mate],     // don't align forward read
+										norc[mate],     // don't align revcomp read
+										ca,             // holds some seed hits from previous reads
+										shs[mate],      // holds all the seed hits
+									sdm,            // metrics
+									instFw,
+									instRc,
+									rep);           // repeat k-mers to mask
+									assert(shs[mate].repOk(&ca.current()));
+									if(inst.first + inst.second == 0) {
+										// No seed hits!  Done with this mate.
+										assert(shs[mate].empty());
+										done[mate] = true;
+										break;
+									}
+									seedsTried += (inst.first + inst.second);
+								seedsTriedMS[mate * 2 + 0] = instFw.first + instFw.second;
+								seedsTriedMS[mate * 2 + 1] = instRc.first + instRc.second;
+									// Align seeds
+									al.searchAllSeeds(
+										*seeds[mate],     // search seeds
+										&ebwtFw,          // BWT index
+										ebwtBw,           // BWT' index
+										*rds[mate],       // read
+										sc,               // scoring scheme
+										ca,               // alignment cache
+										shs[mate],        // store seed hits here
+										seedFreqCap,      // seed frequency cap
+										sdm,              // metrics
+										prm);             // per-read metrics
+									assert(shs[mate].repOk(&ca.current()));
+									if(shs[mate].empty()) {
+										// No seed alignments!  Done with this mate.
+										done[mate] = true;
+										break;
+									}
+								}
+								// shs contain what we need to know to update our seed
+								// summaries for this seeding
+								for(size_t mate = 0; mate < 2; mate++) {
+									if(!shs[mate].empty()) {
+										nUniqueSeeds += shs[mate].numUniqueSeeds();
+									nUniqueSeedsMS[mate * 2 + 0] += shs[mate].numUniqueSeedsStrand(true);
+									nUniqueSeedsMS[mate * 2 + 1] += shs[mate].numUniqueSeedsStrand(false);
+										nRepeatSeeds += shs[mate].numRepeatSeeds();
+									nRepeatSeedsMS[mate * 2 + 0] += shs[mate].numRepeatSeedsStrand(true);
+									nRepeatSeedsMS[mate * 2 + 1] += shs[mate].numRepeatSeedsStrand(false);
+										seedHitTot += shs[mate].numElts();
+									seedHitTotMS[mate * 2 + 0] += shs[mate].numEltsFw();
+									seedHitTotMS[mate * 2 + 1] += shs[mate].numEltsRc();
+									}
+								}
+								double uniqFactor[2] = { 0.0f, 0.0f };
+								for(size_t i = 0; i < 2; i++) {
+									if(!shs[i].empty()) {
+										swmSeed.sdsucc++;
+										uniqFactor[i] = shs[i].uniquenessFactor();
+									}
+								}
+								// Possibly reorder the mates
+								matemap[0] = 0; matemap[1] = 1;
+								if(!shs[0].empty() && !shs[1].empty() && uniqFactor[1] > uniqFactor[0]) {
+									// Do the mate with fewer exact hits first
+									// TODO: Consider mates & orientations separately?
+									matemap[0] = 1; matemap[1] = 0;
+								}
+								for(size_t matei = 0; matei < (paired ? 2:1); matei++) {
+									size_t mate = matemap[matei];
+									if(done[mate] || msinkwrap.state().doneWithMate(mate == 0)) {
+										// Done with this mate
+										done[mate] = true;
+										continue;
+									}
+									assert(!msinkwrap.maxed());
+									assert(msinkwrap.repOk());
+									//rnd.init(ROTL(rds[mate]->seed, 10));
+									assert(shs[mate].repOk(&ca.current()));
+									if(!seedSumm) {
+										// If there aren't any seed hits...
+										if(shs[mate].empty()) {
+											continue; // on to the next mate
+										}
+										// Sort seed hits into ranks
+										shs[mate].rankSeedHits(rnd, msinkwrap.allHits());
+										int ret = 0;
+										if(paired) {
+											// Paired-end dynamic programming driver
+											ret = sd.extendSeedsPaired(
+												*rds[mate],     // mate to align as anchor
+												*rds[mate ^ 1], // mate to align as opp.
+												mate == 0,      // anchor is mate 1?
+												!filt[mate ^ 1],// opposite mate filtered out?
+												shs[mate],      // seed hits for anchor
+												mateIsect ? &shs[mate ^ 1] : NULL, // opp. seed hits to intersect
+												ebwtFw,         // bowtie index
+												ebwtBw,         // rev bowtie index
+												*ref,           // packed reference strings
+												sw,             // dyn prog aligner, anchor
+												osw,            // dyn prog aligner, opposite
+												sc,             // scoring scheme
+												pepol,          // paired-end policy
+												multiseedMms,   // # mms allowed in a seed
+												seedlens[mate], // length of a seed
+												interval[mate], // interval between seeds
+												minsc[mate],    // min score for anchor
+												minsc[mate^1],  // min score for opp.
+												nceil[mate],    // N ceil for anchor
+												nceil[mate^1],  // N ceil for opp.
+												nofw[mate],     // don't align forward read
+												norc[mate],     // don't align revcomp read
+												maxhalf,        // max width on one DP side
+												doUngapped,     // do ungapped alignment
+												mxIter[mate],   // max extend loop iters
+												mxUg[mate],     // max # ungapped extends
+												mxDp[mate],     // max # DPs
+												streak[mate],   // stop after streak of this many end-to-end fails
+												streak[mate],   // stop after streak of this many ungap fails
+												streak[mate],   // stop after streak of this many dp fails
+												mtStreak[mate], // max mate fails per seed range
+												doExtend,       // extend seed hits
+												enable8,        // use 8-bit SSE where possible
+												cminlen,        // checkpoint if read is longer
+												cpow2,          // checkpointer interval, log2
+												doTri,          // triangular mini-fills?
+												tighten,        // -M score tightening mode
+												ca,             // seed alignment cache
+												rnd,            // pseudo-random source
+												wlm,            // group walk left metrics
+												swmSeed,        // DP metrics, seed extend
+												swmMate,        // DP metrics, mate finding
+												prm,            // per-read metrics
+												&msinkwrap,     // for organizing hits
+												true,           // seek mate immediately
+												true,           // report hits once found
+												gReportDiscordant,// look for discordant alns?
+												gReportMixed,   // look for unpaired alns?
+												exhaustive[mate]);
+											// Might be done, but just with this mate
+										} else {
+											// Unpaired dynamic programming driver
+											ret = sd.extendSeeds(
+												*rds[mate],     // read
+												mate == 0,      // mate #1?
+												shs[mate],      // seed hits
+												ebwtFw,         // bowtie index
+												ebwtBw,         // rev bowtie index
+												*ref,           // packed reference strings
+												sw,             // dynamic prog aligner
+												sc,             // scoring scheme
+												multiseedMms,   // # mms allowed in a seed
+												seedlens[mate], // length of a seed
+												interval[mate], // interval between seeds
+												minsc[mate],    // minimum score for valid
+												nceil[mate],    // N ceil for anchor
+												maxhalf,        // max width on one DP side
+												doUngapped,     // do ungapped alignment
+												mxIter[mate],   // max extend loop iters
+												mxUg[mate],     // max # ungapped extends
+												mxDp[mate],     // max # DPs
+												streak[mate],   // stop after streak of this many end-to-end fails
+												streak[mate],   // stop after streak of this many ungap fails
+												doExtend,       // extend seed hits
+												enable8,        // use 8-bit SSE where possible
+												cminlen,        // checkpoint if read is longer
+												cpow2,          // checkpointer interval, log2
+												doTri,          // triangular mini-fills?
+												tighten,        // -M score tightening mode
+												ca,             // seed alignment cache
+												rnd,            // pseudo-random source
+												wlm,            // group walk left metrics
+												swmSeed,        // DP metrics, seed extend
+												prm,            // per-read metrics
+												&msinkwrap,     // for organizing hits
+												true,           // report hits once found
+												exhaustive[mate]);
+										}
+										assert_gt(ret, 0);
+										MERGE_SW(sw);
+										MERGE_SW(osw);
+										if(ret == EXTEND_EXHAUSTED_CANDIDATES) {
+											// Not done yet
+										} else if(ret == EXTEND_POLICY_FULFILLED) {
+											// Policy is satisfied for this mate at least
+											if(msinkwrap.state().doneWithMate(mate == 0)) {
+												done[mate] = true;
+											}
+											if(msinkwrap.state().doneWithMate(mate == 1)) {
+												done[mate^1] = true;
+											}
+										} else if(ret == EXTEND_PERFECT_SCORE) {
+											// We exhausted this made at least
+											done[mate] = true;
+										} else if(ret == EXTEND_EXCEEDED_HARD_LIMIT) {
+											// We exceeded a per-read limit
+											done[mate] = true;
+										} else if(ret == EXTEND_EXCEEDED_SOFT_LIMIT) {
+											// Not done yet
+										} else {
+											//
+											cerr << "Bad return value: " << ret << endl;
+											throw 1;
+										}
+									} // if(!seedSumm)
+								} // for(size_t matei = 0; matei < 2; matei++)
+							
+								// We don't necessarily have to continue investigating both
+								// mates.  We continue on a mate only if its average
+								// interval length is high (> 1000)
+								for(size_t mate = 0; mate < 2; mate++) {
+									if(!done[mate] && shs[mate].averageHitsPerSeed() < seedBoostThresh) {
+										done[mate] = true;
+									}
+								}
+							} // end loop over reseeding rounds
+					} // for(size_t xi = 0; xi < multiseed_idxs.size(); xi++)
 					if(seedsTried > 0) {
 							prm.seedPctUnique = (float)nUniqueSeeds / seedsTried;
 							prm.seedPctRep = (float)nRepeatSeeds / seedsTried;
@@ -3963,6 +4444,8 @@ static void multiseedSearchWorker(void *vp) {
 					lenfilt[1],
 					qcfilt[0],
 					qcfilt[1],
+					lcfilt[0],
+					lcfilt[1],
 					rnd,                  // pseudo-random generator
 					rpm,                  // reporting metrics
 					prm,                  // per-read metrics
@@ -3976,6 +4459,12 @@ static void multiseedSearchWorker(void *vp) {
 		} // if(rdid >= skipReads && rdid < qUpto)
 		else if(rdid >= qUpto) {
 			break;
+		} else if(rdid >= skipReads) {
+			// Sampled or sharded out; keep --reorder from waiting on it
+			msink.outq().skipRead(rdid, (size_t)tid);
+			if(msink.readOut() != NULL) {
+				msink.readOut()->skip(rdid, (size_t)tid);
+			}
 		}
 		if(metricsPerRead) {
 			MERGE_METRICS(metricsPt);
@@ -3984,10 +4473,17 @@ static void multiseedSearchWorker(void *vp) {
 				metricsOfb, metricsStderr, true, &nametmp);
 			metricsPt.reset();
 		}
+		if(liveStats != NULL && ++livei == mergeival) {
+			PUBLISH_LIVE(false);
+			livei = 0;
+		}
 	} // while(true)
 	
 	// One last metrics merge
 	MERGE_METRICS(metrics);
+	if(liveStats != NULL) {
+		PUBLISH_LIVE(true);
+	}
 	
 	if(dpLog    != NULL) dpLog->close();
 	if(dpLogOpp != NULL) dpLogOpp->close();
@@ -4017,16 +4513,19 @@ static void multiseedSearchWorker_2p5(void *vp) {
 static void multiseedSearchWorker_2p5(void *vp) {
 	int tid = *((int*)vp);
 #endif
-	assert(multiseed_ebwtFw != NULL);
-	assert(multiseedMms == 0 || multiseed_ebwtBw != NULL);
+	assert_eq(1, multiseed_idxs.size());
+	assert(multiseed_idxs[0].ebwtFw != NULL);
+	assert(multiseedMms == 0 || multiseed_idxs[0].ebwtBw != NULL);
 	PatternComposer&        patsrc   = *multiseed_patsrc;
 	PatternParams           pp       = multiseed_pp;
-	const Ebwt&             ebwtFw   = *multiseed_ebwtFw;
-	const Ebwt&             ebwtBw   = *multiseed_ebwtBw;
+	const Ebwt&             ebwtFw   = *multiseed_idxs[0].ebwtFw;
+	const Ebwt&             ebwtBw   = *multiseed_idxs[0].ebwtBw;
 	const Scoring&          sc       = *multiseed_sc;
-	const BitPairReference& ref      = *multiseed_refs;
+	const BitPairReference& ref      = *multiseed_idxs[0].refs;
 	AlnSink&                msink    = *multiseed_msink;
 	OutFileBuf*             metricsOfb = multiseed_metricsOfb;
+	LiveStats*              liveStats = multiseed_liveStats;
+	LiveCounts              liveBase; // totals folded in by MERGE_METRICS
 
 	// Sinks: these are so that we can print tables encoding counts for
 	// events of interest on a per-read, per-seed, per-join, or per-SW
@@ -4044,7 +4543,8 @@ static void multiseedSearchWorker_2p5(void *vp) {
 		0,                 // penalty gap (not used now)
 		msample,           // true -> -M was specified, otherwise assume -m
 		gReportDiscordant, // report discordang paired-end alignments?
-		gReportMixed);     // report unpaired alignments for paired reads?
+		gReportMixed,      // report unpaired alignments for paired reads?
+		mapqStop);         // stop once best score & MAPQ are settled
 
 	// Instantiate a mapping quality calculator
 	auto_ptr<Mapq> bmapq(new_mapq(mapqv, scoreMin, sc));
@@ -4127,14 +4627,17 @@ static void multiseedSearchWorker_2p5(void *vp) {
 	bool lenfilt[2] = { true, true };
 	// Keep track of whether mates 1/2 were filtered out by upstream qc
 	bool qcfilt[2]  = { true, true };
+	bool lcfilt[2]  = { true, true };
 
 	rndArb.init((uint32_t)time(0));
 	int mergei = 0;
 	int mergeival = 16;
-	while(true) {
+	int livei = 0;
+	bool done = false;
+	while(!done) {
 		pair<bool, bool> ret = ps->nextReadPair();
 		bool success = ret.first;
-		bool done = ret.second;
+		done = ret.second;
 		if(!success && done) {
 			break;
 		} else if(!success) {
@@ -4150,6 +4653,9 @@ static void multiseedSearchWorker_2p5(void *vp) {
 			rnd.init(ROTL(ps->read_a().seed, 2));
 			sample = rnd.nextFloat() < sampleFrac;
 		}
+		if(shardCount > 1 && rdid % shardCount != shardIdx) {
+			sample = false;
+		}
 		if(rdid >= skipReads && rdid < qUpto && sample) {
 			//
 			// Check if there is metrics reporting for us to do.
@@ -4188,11 +4694,16 @@ static void multiseedSearchWorker_2p5(void *vp) {
 			olm.bases += (rdlen1 + rdlen2);
 			// Check if read is identical to previous read
 			rnd.init(ROTL(ps->read_a().seed, 5));
+			// Best achievable scores, used to tell when --mapq-stop can
+			// end the search; unknown if match bonuses vary by quality
+			const bool perfKnown = (sc.matchType == COST_MODEL_CONSTANT);
 			msinkwrap.nextRead(
 				&ps->read_a(),
 				paired ? &ps->read_b() : NULL,
 				rdid,
-				sc.qualitiesMatter());
+				sc.qualitiesMatter(),
+				perfKnown ? sc.perfectScore(rdlen1) : MAX_I64,
+				perfKnown ? sc.perfectScore(rdlen2) : MAX_I64);
 			assert(msinkwrap.inited());
 			size_t rdlens[2] = { rdlen1, rdlen2 };
 			// Calculate the minimum valid score threshold for the read
@@ -4234,8 +4745,17 @@ static void multiseedSearchWorker_2p5(void *vp) {
 				qcfilt[0] = (ps->read_a().filter != '0');
 				qcfilt[1] = (ps->read_b().filter != '0');
 			}
-			filt[0] = (nfilt[0] && scfilt[0] && lenfilt[0] && qcfilt[0]);
-			filt[1] = (nfilt[1] && scfilt[1] && lenfilt[1] && qcfilt[1]);
+			// Low-complexity filter; is the read too repetitive to
+			// be worth seeding?
+			lcfilt[0] = lcfilt[1] = true;
+			if(dustThresh > 0) {
+				lcfilt[0] = dustScore(ps->read_a().patFw) < dustThresh;
+				if(paired) {
+					lcfilt[1] = dustScore(ps->read_b().patFw) < dustThresh;
+				}
+			}
+			filt[0] = (nfilt[0] && scfilt[0] && lenfilt[0] && qcfilt[0] && lcfilt[0]);
+			filt[1] = (nfilt[1] && scfilt[1] && lenfilt[1] && qcfilt[1] && lcfilt[1]);
 			prm.nFilt += (filt[0] ? 0 : 1) + (filt[1] ? 0 : 1);
 			Read* rds[2] = { &ps->read_a(), &ps->read_b() };
 			assert(msinkwrap.empty());
@@ -4302,10 +4822,10 @@ static void multiseedSearchWorker_2p5(void *vp) {
 			if(filt[0]) {
 				ald.initRead(ps->read_a(), nofw[0], norc[0], minsc[0], maxpen[0], filt[1] ? &ps->read_b() : NULL);
 			} else if(filt[1]) {
-				ald.initRead(ps->read_b(), nofw[1], norc[1], minsc[1], maxpen[1], NULL);
+				ald.initRead(ps->read_b(), nofw[1], norc[1], minsc[1], maxpen[1], NULL, false);
 			}
 			if(filt[0] || filt[1]) {
-				ald.go(sc, ebwtFw, ebwtBw, ref, descm, wlm, prm, rnd, msinkwrap);
+				ald.go(sc, ebwtFw, ebwtBw, ref, descm, wlm, prm, rnd, msinkwrap, &pepol);
 			}
 			// Commit and report paired-end/unpaired alignments
 			uint32_t sd = rds[0]->seed ^ rds[1]->seed;
@@ -4323,6 +4843,8 @@ static void multiseedSearchWorker_2p5(void *vp) {
 				lenfilt[1],
 				qcfilt[0],
 				qcfilt[1],
+				lcfilt[0],
+				lcfilt[1],
 				rnd,                  // pseudo-random generator
 				rpm,                  // reporting metrics
 				prm,                  // per-read metrics
@@ -4334,6 +4856,12 @@ static void multiseedSearchWorker_2p5(void *vp) {
 		} // if(rdid >= skipReads && rdid < qUpto)
 		else if(rdid >= qUpto) {
 			break;
+		} else if(rdid >= skipReads) {
+			// Sampled or sharded out; keep --reorder from waiting on it
+			msink.outq().skipRead(rdid, (size_t)tid);
+			if(msink.readOut() != NULL) {
+				msink.readOut()->skip(rdid, (size_t)tid);
+			}
 		}
 		if(metricsPerRead) {
 			MERGE_METRICS(metricsPt);
@@ -4342,10 +4870,17 @@ static void multiseedSearchWorker_2p5(void *vp) {
 				metricsOfb, metricsStderr, true, &nametmp);
 			metricsPt.reset();
 		}
-	} // while(true)
+		if(liveStats != NULL && ++livei == mergeival) {
+			PUBLISH_LIVE(false);
+			livei = 0;
+		}
+	} // while(!done)
 	
 	// One last metrics merge
 	MERGE_METRICS(metrics);
+	if(liveStats != NULL) {
+		PUBLISH_LIVE(true);
+	}
 #ifdef WITH_TBB
 	p->done->fetch_and_add(1);
 #endif
@@ -4535,35 +5070,17 @@ static void multiseedSearch(
 	const PatternParams& pp,
 	PatternComposer& patsrc,      // pattern source
 	AlnSink& msink,               // hit sink
-	Ebwt& ebwtFw,                 // index of original text
-	Ebwt& ebwtBw,                 // index of mirror text
-	OutFileBuf *metricsOfb)
+	EList<SearchIndex>& idxs,     // indexes, with base, ebwtFw, ebwtBw, refOff set
+	OutFileBuf *metricsOfb,
+	LiveStats *liveStats)         // --met-live file, or NULL
 {
 	multiseed_patsrc = &patsrc;
 	multiseed_pp = pp;
 	multiseed_msink  = &msink;
-	multiseed_ebwtFw = &ebwtFw;
-	multiseed_ebwtBw = &ebwtBw;
 	multiseed_sc     = &sc;
 	multiseed_metricsOfb      = metricsOfb;
-	Timer *_t = new Timer(cerr, "Time loading reference: ", timing);
-	auto_ptr<BitPairReference> refs(
-		new BitPairReference(
-			adjIdxBase,
-			false,
-			sanityCheck,
-			NULL,
-			NULL,
-			false,
-			useMm,
-			useShmem,
-			mmSweep,
-			gVerbose,
-			startVerbose)
-	);
-	delete _t;
-	if(!refs->loaded()) throw 1;
-	multiseed_refs = refs.get();
+	multiseed_liveStats       = liveStats;
+	multiseed_idxs = idxs;
     sigset_t set;
     sigemptyset(&set);
     sigaddset(&set, SIGPIPE);
@@ -4577,33 +5094,12 @@ static void multiseedSearch(
 #endif
 	threads.reserveExact(std::max(nthreads, thread_ceiling));
 	tids.reserveExact(std::max(nthreads, thread_ceiling));
-	{
-		// Load the other half of the index into memory
-		assert(!ebwtFw.isInMemory());
-		Timer _t(cerr, "Time loading forward index: ", timing);
-		ebwtFw.loadIntoMemory(
-			0,  // colorspace?
-			-1, // not the reverse index
-			true,         // load SA samp? (yes, need forward index's SA samp)
-			true,         // load ftab (in forward index)
-			true,         // load rstarts (in forward index)
-			!noRefNames,  // load names?
-			startVerbose);
-	}
-	if(multiseedMms > 0 || do1mmUpFront) {
-		// Load the other half of the index into memory
-		assert(!ebwtBw.isInMemory());
-		Timer _t(cerr, "Time loading mirror index: ", timing);
-		ebwtBw.loadIntoMemory(
-			0, // colorspace?
-			// It's bidirectional search, so we need the reverse to be
-			// constructed as the reverse of the concatenated strings.
-			1,
-			false,        // don't load SA samp in reverse index
-			true,         // yes, need ftab in reverse index
-			false,        // don't load rstarts in reverse index
-			!noRefNames,  // load names?
-			startVerbose);
+	// Later indexes are loaded on demand unless every read is aligned to
+	// every index
+	for(size_t i = 0; i < multiseed_idxs.size(); i++) {
+		if(i == 0 || allIndexes) {
+			loadSearchIndex(multiseed_idxs[i]);
+		}
 	}
 	// Start the metrics thread
 	
@@ -4666,6 +5162,11 @@ static void multiseedSearch(
 	if(!metricsPerRead && (metricsOfb != NULL || metricsStderr)) {
 		metrics.reportInterval(metricsOfb, metricsStderr, true, NULL);
 	}
+	for(size_t i = 0; i < multiseed_idxs.size(); i++) {
+		delete multiseed_idxs[i].refs;
+		delete multiseed_idxs[i].rep;
+	}
+	multiseed_idxs.clear();
 }
 
 static string argstr;
@@ -4679,6 +5180,24 @@ static void driver(
 	if(gVerbose || startVerbose)  {
 		cerr << "Entered driver(): "; logTime(cerr, true);
 	}
+	// Pick up where the run that wrote the checkpoint left off
+	CheckpointState ckptState;
+	bool resuming = false;
+	if(!checkpointFile.empty()) {
+		if(outfile.empty()) {
+			cerr << "Error: --checkpoint requires an output file given with -S" << endl;
+			throw 1;
+		}
+		if(resume && OutputCheckpointer::read(checkpointFile, ckptState)) {
+			resuming = true;
+			if(ckptState.reads > skipReads) {
+				skipReads = (uint32_t)min<TReadId>(ckptState.reads, qUpto);
+			}
+			if(gVerbose || startVerbose) {
+				cerr << "Resuming at read " << ckptState.reads << ": "; logTime(cerr, true);
+			}
+		}
+	}
 	// Vector of the reference sequences; used for sanity-checking
 	EList<SString<char> > names, os;
 	EList<size_t> nameLens, seqLens;
@@ -4703,7 +5222,8 @@ static void driver(
 		fastaContFreq, // frequency of sampled reads for FastaContinuous...
 		skipReads,     // skip the first 'skip' patterns
 		nthreads,      //number of threads for locking
-		outType != OUTPUT_SAM // whether to fix mate names
+		outType != OUTPUT_SAM, // whether to fix mate names
+		asyncIo        // read plain files ahead in the background
 	);
 	if(gVerbose || startVerbose) {
 		cerr << "Creating PatternSource: "; logTime(cerr, true);
@@ -4718,21 +5238,52 @@ static void driver(
 		qualities2,  // qualities associated with m2
 		pp,          // read read-in parameters
 		gVerbose || startVerbose); // be talkative
+	if(!checkpointFile.empty()) {
+		patsrc->trackBatchStarts();
+		// Reads before the checkpoint are skipped either way; seeking just
+		// saves parsing them again
+		if(resuming && !ckptState.inputs.empty() &&
+		   !patsrc->seek(ckptState.inputs) && !gQuiet)
+		{
+			cerr << "Warning: Could not seek to the checkpoint in the read "
+			     << "input; reading it from the start" << endl;
+		}
+	}
 	// Open hit output file
 	if(gVerbose || startVerbose) {
 		cerr << "Opening hit output file: "; logTime(cerr, true);
 	}
 	OutFileBuf *fout;
 	if(!outfile.empty()) {
-		fout = new OutFileBuf(outfile.c_str(), false);
+		if(resuming) {
+			OutputCheckpointer::truncateOutput(outfile, ckptState);
+		}
+		fout = new OutFileBuf(outfile.c_str(), false, resuming);
 	} else {
 		fout = new OutFileBuf();
 	}
+#ifndef _WIN32
+	if(asyncIo) {
+		// Only regular files; output to a pipe or terminal stays as it is
+		if(fout->setAsync()) {
+			if(gVerbose || startVerbose) {
+				cerr << "Writing output in the background with "
+				     << fout->asyncBackend() << endl;
+			}
+		} else if(gVerbose || startVerbose) {
+			cerr << "Output isn't a regular file; writing it synchronously" << endl;
+		}
+	}
+#endif
 	// Initialize Ebwt object and read in header
 	if(gVerbose || startVerbose) {
 		cerr << "About to initialize fw Ebwt: "; logTime(cerr, true);
 	}
 	adjIdxBase = adjustEbwtBase(argv0, bt2indexBase, gVerbose);
+	checkSearchIndexFiles(adjIdxBase);
+	for(size_t i = 0; i < extraIndexes.size(); i++) {
+		checkSearchIndexFiles(adjustEbwtBase(argv0, extraIndexes[i], gVerbose));
+	}
 	Ebwt ebwt(
 		adjIdxBase,
 	    0,        // index is colorspace
@@ -4753,7 +5304,7 @@ static void driver(
 	    sanityCheck);
 	Ebwt* ebwtBw = NULL;
 	// We need the mirror index if mismatches are allowed
-	if(multiseedMms > 0 || do1mmUpFront) {
+	if(needMirrorIndex()) {
 		if(gVerbose || startVerbose) {
 			cerr << "About to initialize rev Ebwt: "; logTime(cerr, true);
 		}
@@ -4776,6 +5327,65 @@ static void driver(
 		    false /*passMemExc*/,
 		    sanityCheck);
 	}
+	// Reads are aligned to the indexes in this order
+	EList<SearchIndex> idxs;
+	EList<string> idxBases;
+	idxs.expand();
+	idxs.back().base = adjIdxBase;
+	idxs.back().ebwtFw = &ebwt;
+	idxs.back().ebwtBw = ebwtBw;
+	idxs.back().refs = NULL;
+	idxs.back().rep = NULL;
+	idxs.back().loaded = false;
+	idxBases.push_back(adjIdxBase);
+	for(size_t i = 0; i < extraIndexes.size(); i++) {
+		string base = adjustEbwtBase(argv0, extraIndexes[i], gVerbose);
+		idxs.expand();
+		idxs.back().base = base;
+		idxs.back().refs = NULL;
+		idxs.back().rep = NULL;
+		idxs.back().loaded = false;
+		idxs.back().ebwtFw = new Ebwt(
+			base,
+			0,        // index is colorspace
+			-1,       // fw index
+			true,     // index is for the forward direction
+			/* overriding: */ offRate,
+			0, // amount to add to index offrate or <= 0 to do nothing
+			useMm,    // whether to use memory-mapped files
+			useShmem, // whether to use shared memory
+			mmSweep,  // sweep memory-mapped files
+			!noRefNames, // load names?
+			true,        // load SA sample?
+			true,        // load ftab?
+			true,        // load rstarts?
+			gVerbose, // whether to be talkative
+			startVerbose, // talkative during initialization
+			false /*passMemExc*/,
+			sanityCheck);
+		idxs.back().ebwtBw = NULL;
+		if(ebwtBw != NULL) {
+			idxs.back().ebwtBw = new Ebwt(
+				base + ".rev",
+				0,       // index is colorspace
+				1,       // TODO: maybe not
+				false, // index is for the reverse direction
+				/* overriding: */ offRate,
+				0, // amount to add to index offrate or <= 0 to do nothing
+				useMm,    // whether to use memory-mapped files
+				useShmem, // whether to use shared memory
+				mmSweep,  // sweep memory-mapped files
+				!noRefNames, // load names?
+				true,        // load SA sample?
+				true,        // load ftab?
+				true,        // load rstarts?
+				gVerbose,    // whether to be talkative
+				startVerbose, // talkative during initialization
+				false /*passMemExc*/,
+				sanityCheck);
+		}
+		idxBases.push_back(base);
+	}
 	if(sanityCheck && !os.empty()) {
 		// Sanity check number of patterns and pattern lengths in Ebwt
 		// against original strings
@@ -4799,11 +5409,17 @@ static void driver(
 	}
 	OutputQueue oq(
 		*fout,                           // out file buffer
-		reorder && (nthreads > 1 || thread_stealing), // whether to reorder
+		(reorder && (nthreads > 1 || thread_stealing)) ||
+			!checkpointFile.empty(),     // whether to reorder
 		nthreads,                        // # threads
 		nthreads > 1 || thread_stealing, // whether to be thread-safe
 		readsPerBatch,                   // size of output buffer of reads 
 		skipReads);                      // first read will have this rdid
+	OutputCheckpointer *ckpt = NULL;
+	if(!checkpointFile.empty()) {
+		ckpt = new OutputCheckpointer(checkpointFile, checkpointEvery, skipReads, *fout, *patsrc);
+		oq.setCheckpointer(ckpt);
+	}
 	{
 		Timer _t(cerr, "Time searching: ", timing);
 		// Set up penalities
@@ -4826,12 +5442,22 @@ static void driver(
 			penRdGapLinear, // linear coeff for read gap cost
 			penRfGapLinear, // linear coeff for ref gap cost
 			gGapBarrier);   // # rows at top/bot only entered diagonally
+		// References of all the indexes are numbered consecutively, in
+		// the order the indexes were given
 		EList<size_t> reflens;
-		for(size_t i = 0; i < ebwt.nPat(); i++) {
-			reflens.push_back(ebwt.plen()[i]);
-		}
 		EList<string> refnames;
-		readEbwtRefnames(adjIdxBase, refnames);
+		for(size_t i = 0; i < idxs.size(); i++) {
+			const Ebwt& e = *idxs[i].ebwtFw;
+			idxs[i].refOff = (TRefId)reflens.size();
+			for(size_t j = 0; j < e.nPat(); j++) {
+				reflens.push_back(e.plen()[j]);
+			}
+			EList<string> names;
+			readEbwtRefnames(idxBases[i], names);
+			for(size_t j = 0; j < names.size(); j++) {
+				refnames.push_back(names[j]);
+			}
+		}
 		SamConfig samc(
 			refnames,               // reference sequence names
 			reflens,                // reference sequence lengths
@@ -4879,6 +5505,13 @@ static void driver(
 			sam_print_zp,
 			sam_print_zu,
 			sam_print_zt);
+		EList<size_t> idxStarts;
+		if(idxs.size() > 1) {
+			for(size_t i = 0; i < idxs.size(); i++) {
+				idxStarts.push_back((size_t)idxs[i].refOff);
+			}
+			samc.setIndexStarts(&idxStarts);
+		}
 		// Set up hit sink; if sanityCheck && !os.empty() is true,
 		// then instruct the sink to "retain" hits in a vector in
 		// memory so that we can easily sanity check them later on
@@ -4890,7 +5523,7 @@ static void driver(
 					samc,         // settings & routines for SAM output
 					refnames,     // reference names
 					gQuiet);      // don't print alignment summary at end
-				if(!samNoHead) {
+				if(!samNoHead && !resuming) {
 					bool printHd = true, printSq = true;
 					BTString buf;
 					samc.printHeader(buf, rgid, rgs, printHd, !samNoSQ, printSq);
@@ -4902,6 +5535,25 @@ static void driver(
 				cerr << "Invalid output type: " << outType << endl;
 				throw 1;
 		}
+		// Open files for --un, --al, --un-conc, --al-conc
+		ReadOutFiles *readOut = NULL;
+		for(int i = 0; i < 4; i++) {
+			if(readOutFns[i].empty()) {
+				continue;
+			}
+			if(readOut == NULL) {
+				readOut = new ReadOutFiles(
+					(size_t)std::max(nthreads, thread_ceiling), // # writers
+					reorder && (nthreads > 1 || thread_stealing), // keep input order?
+					skipReads);                  // id of first read
+			}
+			if(i < 2) {
+				readOut->initUnpaired(i == 1, readOutFns[i], readOutComp[i]);
+			} else {
+				readOut->initPaired(i == 3, readOutFns[i], readOutComp[i]);
+			}
+		}
+		mssink->setReadOut(readOut);
 		if(gVerbose || startVerbose) {
 			cerr << "Dispatching to search driver: "; logTime(cerr, true);
 		}
@@ -4910,6 +5562,13 @@ static void driver(
 		if(!metricsFile.empty() && metricsIval > 0) {
 			metricsOfb = new OutFileBuf(metricsFile);
 		}
+		LiveStats *liveStats = NULL;
+		if(!metricsLive.empty()) {
+			liveStats = new LiveStats();
+			if(!liveStats->open(metricsLive, (size_t)std::max(nthreads, thread_ceiling))) {
+				throw 1;
+			}
+		}
 		// Do the search for all input reads
 		assert(patsrc != NULL);
 		assert(mssink != NULL);
@@ -4918,15 +5577,18 @@ static void driver(
 			pp,      // pattern params
 			*patsrc, // pattern source
 			*mssink, // hit sink
-			ebwt,    // BWT
-			*ebwtBw, // BWT'
-			metricsOfb);
+			idxs,    // BWT and BWT' for each index
+			metricsOfb,
+			liveStats);
 		// Evict any loaded indexes from memory
 		if(ebwt.isInMemory()) {
 			ebwt.evictFromMemory();
 		}
-		if(ebwtBw != NULL) {
-			delete ebwtBw;
+		for(size_t i = 0; i < idxs.size(); i++) {
+			if(i > 0) {
+				delete idxs[i].ebwtFw;
+			}
+			delete idxs[i].ebwtBw;
 		}
 		if(!gQuiet && !seedSumm) {
 			size_t repThresh = mhits;
@@ -4942,12 +5604,30 @@ static void driver(
 		oq.flush(true);
 		assert_eq(oq.numStarted(), oq.numFinished());
 		assert_eq(oq.numStarted(), oq.numFlushed());
+		if(ckpt != NULL) {
+			// A rerun with --resume will find nothing left to do
+			ckpt->write(oq.nextToFlush());
+			oq.setCheckpointer(NULL);
+			delete ckpt;
+		}
+		if(readOut != NULL) {
+			bool ok = readOut->close();
+			delete readOut;
+			if(!ok) {
+				throw 1;
+			}
+		}
 		delete patsrc;
 		delete mssink;
 		delete metricsOfb;
 		if(fout != NULL) {
 			delete fout;
 		}
+		if(liveStats != NULL) {
+			// Only once the output is all written
+			liveStats->finish();
+			delete liveStats;
+		}
 	}
 }
 
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of Bowtie 2.
+ *
+ * Bowtie 2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bowtie 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bowtie 2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#include <iostream>
+#include <fstream>
+#include "checkpoint.h"
+
+using namespace std;
+
+static const char *CHECKPOINT_MAGIC = "bowtie2-checkpoint";
+static const int CHECKPOINT_VERSION = 1;
+
+#ifndef _WIN32
+/**
+ * Sync the directory holding file 'fn', so that a rename of 'fn' is on
+ * disk.  Returns false if that fails; file systems that can't sync a
+ * directory are taken to need no sync.
+ */
+static bool syncDir(const string& fn) {
+	size_t slash = fn.rfind('/');
+	string dir = (slash == string::npos) ? "." : fn.substr(0, slash + 1);
+	int fd = open(dir.c_str(), O_RDONLY);
+	if(fd < 0) {
+		return false;
+	}
+	bool ok = fsync(fd) == 0 || errno == EINVAL;
+	close(fd);
+	return ok;
+}
+#endif
+
+/**
+ * Write a checkpoint saying the output for reads with ids below 'nreads'
+ * is complete.  The output is synced before the checkpoint is written, and
+ * the checkpoint replaces the old one only once it's safely on disk; the
+ * directory is then synced so the replacement is on disk too.
+ */
+bool OutputCheckpointer::write(TReadId nreads) {
+	next_ = nreads + every_;
+	if(!patsrc_.restartPoints(nreads, pos_)) {
+		// Input can't be seeked; resuming will re-read from the start
+		pos_.clear();
+	}
+	if(!obuf_.sync()) {
+		cerr << "Warning: Could not sync output for checkpoint; skipping" << endl;
+		return false;
+	}
+	int64_t bytes = obuf_.tell();
+	string tmp = fn_ + ".tmp";
+	FILE *f = fopen(tmp.c_str(), "w");
+	if(f == NULL) {
+		cerr << "Warning: Could not open checkpoint file " << tmp.c_str()
+		     << " for writing" << endl;
+		return false;
+	}
+	fprintf(f, "%s %d\n", CHECKPOINT_MAGIC, CHECKPOINT_VERSION);
+	fprintf(f, "reads %llu\n", (unsigned long long)nreads);
+	fprintf(f, "bytes %lld\n", (long long)bytes);
+	for(size_t i = 0; i < pos_.size(); i++) {
+		fprintf(f, "input %llu %llu %lld\n",
+		        (unsigned long long)pos_[i].rdid,
+		        (unsigned long long)pos_[i].file,
+		        (long long)pos_[i].off);
+	}
+	bool ok = fflush(f) == 0;
+#ifdef _WIN32
+	ok = ok && _commit(_fileno(f)) == 0;
+	ok = (fclose(f) == 0) && ok;
+	// rename() won't replace an existing file on Windows
+	ok = ok && MoveFileExA(tmp.c_str(), fn_.c_str(),
+		MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	ok = ok && fsync(fileno(f)) == 0;
+	ok = (fclose(f) == 0) && ok;
+	ok = ok && rename(tmp.c_str(), fn_.c_str()) == 0 && syncDir(fn_);
+#endif
+	if(!ok) {
+		cerr << "Warning: Could not write checkpoint file " << fn_.c_str() << endl;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Read the checkpoint in file 'fn' into 'st'.  Returns false if the file
+ * doesn't exist; prints an error and throws 1 if it's malformed.
+ */
+bool OutputCheckpointer::read(const string& fn, CheckpointState& st) {
+	ifstream in(fn.c_str());
+	if(!in.good()) {
+		return false;
+	}
+	string magic, key;
+	int version = 0;
+	unsigned long long reads = 0;
+	long long bytes = -1;
+	in >> magic >> version;
+	in >> key >> reads;
+	bool ok = in.good() && magic == CHECKPOINT_MAGIC &&
+	          version == CHECKPOINT_VERSION && key == "reads";
+	in >> key >> bytes;
+	ok = ok && !in.fail() && key == "bytes" && bytes >= 0;
+	st.reads = (TReadId)reads;
+	st.bytes = (int64_t)bytes;
+	st.inputs.clear();
+	while(ok && in >> key) {
+		unsigned long long rdid = 0, file = 0;
+		long long off = -1;
+		in >> rdid >> file >> off;
+		if(in.fail() || key != "input" || rdid > reads || off < 0) {
+			ok = false;
+			break;
+		}
+		st.inputs.expand();
+		st.inputs.back().rdid = (TReadId)rdid;
+		st.inputs.back().file = (size_t)file;
+		st.inputs.back().off = (int64_t)off;
+	}
+	if(!ok) {
+		cerr << "Error: Checkpoint file " << fn.c_str() << " is malformed" << endl;
+		throw 1;
+	}
+	return true;
+}
+
+/**
+ * Cut off anything written to the output file after the checkpoint was
+ * taken.
+ */
+void OutputCheckpointer::truncateOutput(const string& fn, const CheckpointState& st) {
+	struct stat s;
+	if(stat(fn.c_str(), &s) != 0 || (int64_t)s.st_size < st.bytes) {
+		cerr << "Error: Output file " << fn.c_str() << " is missing or shorter "
+		     << "than the checkpoint says; can't resume" << endl;
+		throw 1;
+	}
+#ifdef _WIN32
+	int fd = _open(fn.c_str(), _O_RDWR | _O_BINARY);
+	bool ok = fd >= 0 && _chsize_s(fd, st.bytes) == 0;
+	if(fd >= 0) {
+		_close(fd);
+	}
+	if(!ok) {
+#else
+	if(truncate(fn.c_str(), (off_t)st.bytes) != 0) {
+#endif
+		cerr << "Error: Could not truncate output file " << fn.c_str()
+		     << " to resume from the checkpoint" << endl;
+		throw 1;
+	}
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of Bowtie 2.
+ *
+ * Bowtie 2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bowtie 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bowtie 2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * checkpoint.h
+ *
+ * Checkpoints for --checkpoint and --resume.  A checkpoint records how
+ * many reads have had all their output written to the SAM file, how long
+ * the SAM file was at that point and, where possible, a point in each
+ * input file at or before the next read from which reading can restart.
+ * Output must be written in input order (as with --reorder) for the read
+ * count to mean anything.
+ *
+ * Checkpoints are written by whichever thread happens to be flushing the
+ * output queue once enough reads have been flushed since the last one.
+ * The SAM file is synced to disk first and the checkpoint is written to a
+ * temporary file that is then synced and renamed over the old one, and
+ * the directory is synced after the rename, so the checkpoint on disk
+ * never claims more output than actually reached the disk.
+ *
+ * File layout (text, one item per line):
+ *
+ *   bowtie2-checkpoint 1
+ *   reads <# reads whose output is in the SAM file>
+ *   bytes <length of the SAM file>
+ *   input <first read id> <file index> <byte offset>   (0, 1 or 2 lines)
+ */
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <string>
+#include "ds.h"
+#include "filebuf.h"
+#include "pat.h"
+
+/**
+ * Contents of a checkpoint file.
+ */
+struct CheckpointState {
+
+	CheckpointState() : reads(0), bytes(0), inputs(MISC_CAT) { }
+
+	TReadId         reads;  // reads whose output is complete
+	int64_t         bytes;  // length of the output at that point
+	EList<InputPos> inputs; // restart points, one per input; may be empty
+};
+
+class OutputCheckpointer {
+
+public:
+
+	/**
+	 * Write a checkpoint to 'fn' every 'every' reads, counting from read
+	 * 'first'.
+	 */
+	OutputCheckpointer(
+		const std::string& fn,
+		TReadId every,
+		TReadId first,
+		OutFileBuf& obuf,
+		PatternComposer& patsrc) :
+		fn_(fn),
+		every_(every),
+		next_(first + every),
+		obuf_(obuf),
+		patsrc_(patsrc),
+		pos_(MISC_CAT)
+	{
+		assert_gt(every_, 0);
+	}
+
+	/**
+	 * Called with the output queue's lock held each time it flushes; reads
+	 * with ids below 'nreads' have all of their output in 'obuf'.  Writes
+	 * a checkpoint if one is due.
+	 */
+	void flushed(TReadId nreads) {
+		if(nreads >= next_) {
+			write(nreads);
+		}
+	}
+
+	/**
+	 * Write a checkpoint saying the output for reads with ids below
+	 * 'nreads' is complete.  Prints a warning and returns false if it
+	 * couldn't be written.
+	 */
+	bool write(TReadId nreads);
+
+	/**
+	 * Read the checkpoint in file 'fn' into 'st'.  Returns false if the
+	 * file doesn't exist; prints an error and throws 1 if it's malformed.
+	 */
+	static bool read(const std::string& fn, CheckpointState& st);
+
+	/**
+	 * Get the output file 'fn' ready to be appended to after resuming from
+	 * 'st', by cutting off anything written after the checkpoint.  Prints
+	 * an error and throws 1 if the file is shorter than the checkpoint
+	 * says it should be.
+	 */
+	static void truncateOutput(const std::string& fn, const CheckpointState& st);
+
+protected:
+
+	std::string      fn_;     // checkpoint file
+	TReadId          every_;  // reads between checkpoints
+	TReadId          next_;   // write next checkpoint once this many flushed
+	OutFileBuf&      obuf_;   // SAM output
+	PatternComposer& patsrc_; // read input
+	EList<InputPos>  pos_;    // scratch list of restart points
+};
+
+#endif /*ndef CHECKPOINT_H_*/
@@ -51,6 +51,7 @@ void MemoryTally::del(int cat, uint64_t amt) {
 
 #include <limits>
 #include "random_source.h"
+#include "sstring.h"
 
 using namespace std;
 
@@ -150,6 +151,30 @@ int main(void) {
 		}
 	}
 	cerr << "PASSED" << endl;
+
+	cerr << "Test EList relocation 1...";
+	{
+		EList<BTString, 1> l;
+		EList<EList<int, 1>, 1> ll;
+		BTString s;
+		for(size_t i = 0; i < 100; i++) {
+			s.append('A' + (char)(i % 26));
+			l.push_back(s);
+			ll.expand();
+			for(size_t j = 0; j <= i; j++) {
+				ll.back().push_back((int)j);
+			}
+		}
+		for(size_t i = 0; i < 100; i++) {
+			if(l[i].length() != i+1 || l[i][i] != 'A' + (char)(i % 26)) {
+				throw 1;
+			}
+			if(ll[i].size() != i+1 || ll[i][i] != (int)i) {
+				throw 1;
+			}
+		}
+	}
+	cerr << "PASSED" << endl;
 }
 
 #endif /*def MAIN_SSTRING*/
@@ -285,6 +285,19 @@ private:
 	size_t sz_;
 };
 
+/**
+ * Move the element in 'src' into 'dst' while a container is being
+ * reallocated.  'src' is destroyed right afterward, so it can be left in
+ * any valid state.  By default this copies with operator=; types that own
+ * heap buffers overload relocate() next to their definition so that the
+ * buffers are handed over instead of duplicated.  Overloads are picked up
+ * by argument-dependent lookup when the container is instantiated.
+ */
+template <typename T>
+inline void relocate(T& dst, T& src) {
+	dst = src;
+}
+
 /**
  * An EList<T> is an expandable list with these features:
  *
@@ -293,8 +306,9 @@ private:
  *    default of 128 is used.
  *  - When allocated initially or when expanding, the new[] operator is
  *    used, which in turn calls the default constructor for T.
- *  - All copies (e.g. assignment of a const T& to an EList<T> element,
- *    or during expansion) use operator=.
+ *  - All copies (e.g. assignment of a const T& to an EList<T> element)
+ *    use operator=.  During expansion, elements are moved with
+ *    relocate(), which is operator= unless T overloads it.
  *  - When the EList<T> is resized to a smaller size (or cleared, which
  *    is like resizing to size 0), the underlying containing is not
  *    reshaped.  Thus, ELists<T>s never release memory before
@@ -430,6 +444,17 @@ public:
 		o.allocCat_ = -1;
 	}
 
+	/**
+	 * Exchange contents, capacity and category with another EList.
+	 */
+	void swap(EList<T, S>& o) {
+		std::swap(cat_, o.cat_);
+		std::swap(allocCat_, o.allocCat_);
+		std::swap(list_, o.list_);
+		std::swap(sz_, o.sz_);
+		std::swap(cur_, o.cur_);
+	}
+
 	/**
 	 * Return number of elements.
 	 */
@@ -948,8 +973,8 @@ private:
 
 	/**
 	 * Expand the list_ buffer until it has at least 'thresh' elements.  Size
-	 * increases quadratically with number of expansions.  Copy old contents
-	 * into new buffer using operator=.
+	 * increases quadratically with number of expansions.  Move old contents
+	 * into new buffer using relocate().
 	 */
 	void expandCopy(size_t thresh) {
 		if(thresh <= sz_) return;
@@ -959,8 +984,8 @@ private:
 	}
 
 	/**
-	 * Expand the list_ buffer until it has exactly 'newsz' elements.  Copy
-	 * old contents into new buffer using operator=.
+	 * Expand the list_ buffer until it has exactly 'newsz' elements.  Move
+	 * old contents into new buffer using relocate().
 	 */
 	void expandCopyExact(size_t newsz) {
 		if(newsz <= sz_) return;
@@ -969,8 +994,7 @@ private:
 		size_t cur = cur_;
 		if(list_ != NULL) {
  			for(size_t i = 0; i < cur_; i++) {
-				// Note: operator= is used
-				tmp[i] = list_[i];
+				relocate(tmp[i], list_[i]);
 			}
 			free();
 		}
@@ -1014,6 +1038,14 @@ private:
 	size_t cur_;   // occupancy (AKA size)
 };
 
+/**
+ * Relocate a nested EList by handing over its buffer.
+ */
+template <typename T, int S>
+inline void relocate(EList<T, S>& dst, EList<T, S>& src) {
+	dst.swap(src);
+}
+
 /**
  * An ELList<T> is an expandable list of lists with these features:
  *
@@ -2049,7 +2081,7 @@ private:
 		}
 		T* tmp = alloc(newsz);
 		for(size_t i = 0; i < cur_; i++) {
-			tmp[i] = list_[i];
+			relocate(tmp[i], list_[i]);
 		}
 		free();
 		list_ = tmp;
@@ -2719,7 +2751,8 @@ private:
 		while(newsz < thresh) newsz *= 2;
 		std::pair<K, V>* tmp = alloc(newsz);
 		for(size_t i = 0; i < cur_; i++) {
-			tmp[i] = list_[i];
+			relocate(tmp[i].first, list_[i].first);
+			relocate(tmp[i].second, list_[i].second);
 		}
 		free();
 		list_ = tmp;
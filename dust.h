@@ -0,0 +1,93 @@
+/*
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of Bowtie 2.
+ *
+ * Bowtie 2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bowtie 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bowtie 2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * dust.h
+ *
+ * Low-complexity scoring for the --dust read filter.  The score is the
+ * DUST triplet score (Morgulis et al., J Comput Biol 2006) computed over
+ * the whole read and normalized by the number of pairs of triplets, so
+ * that it doesn't depend on read length:
+ *
+ *   score = 100 * sum_t c_t * (c_t - 1) / 2  /  (l * (l - 1) / 2)
+ *
+ * where c_t is the number of occurrences of triplet t and l is the number
+ * of triplets without an N.  Homopolymers score 100, dinucleotide repeats
+ * about 50, trinucleotide repeats about 33 and random sequence about 2.
+ */
+
+#ifndef DUST_H_
+#define DUST_H_
+
+#include <string.h>
+#include <stdint.h>
+#include <emmintrin.h>
+#include "sstring.h"
+
+/**
+ * Return the low-complexity score of the given read, between 0 and 100.
+ * Reads with fewer than two triplets score 0.
+ */
+static inline int dustScore(const BTDnaString& seq) {
+	const size_t len = seq.length();
+	if(len < 4) {
+		return 0;
+	}
+	const char *s = (const char *)seq.buf();
+	const size_t ntrip = len - 2;
+	uint32_t counts[65];
+	memset(counts, 0, sizeof(counts));
+	// Compute 16 triplet codes at a time; triplets with an N get code 64
+	uint8_t codes[16];
+	const __m128i three = _mm_set1_epi8(3);
+	const __m128i nbin = _mm_set1_epi8(64);
+	size_t i = 0;
+	for(; i + 16 <= ntrip; i += 16) {
+		__m128i a = _mm_loadu_si128((const __m128i*)(s + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(s + i + 1));
+		__m128i c = _mm_loadu_si128((const __m128i*)(s + i + 2));
+		// Characters are 0-4, so 16-bit shifts don't spill between bytes
+		__m128i code = _mm_or_si128(
+			_mm_or_si128(_mm_slli_epi16(a, 4), _mm_slli_epi16(b, 2)), c);
+		__m128i isn = _mm_cmpgt_epi8(_mm_or_si128(_mm_or_si128(a, b), c), three);
+		code = _mm_or_si128(
+			_mm_andnot_si128(isn, code), _mm_and_si128(isn, nbin));
+		_mm_storeu_si128((__m128i*)codes, code);
+		for(int j = 0; j < 16; j++) {
+			counts[codes[j]]++;
+		}
+	}
+	for(; i < ntrip; i++) {
+		int a = s[i], b = s[i+1], c = s[i+2];
+		counts[(a > 3 || b > 3 || c > 3) ? 64 : ((a << 4) | (b << 2) | c)]++;
+	}
+	uint64_t pairs = 0;
+	for(int t = 0; t < 64; t++) {
+		if(counts[t] > 1) {
+			pairs += (uint64_t)counts[t] * (counts[t] - 1) / 2;
+		}
+	}
+	const uint64_t l = ntrip - counts[64];
+	if(l < 2) {
+		return 0;
+	}
+	return (int)((100 * pairs) / (l * (l - 1) / 2));
+}
+
+#endif /*ndef DUST_H_*/
@@ -31,6 +31,16 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <zlib.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "async_io.h"
+#endif
+
+class AsyncWriter;
 
 /**
  * Simple, fast helper for determining if a character is a newline.
@@ -563,7 +573,7 @@ public:
 	 * Open a new output stream to a file with given name.
 	 */
 	OutFileBuf(const std::string& out, bool binary = false) :
-		name_(out.c_str()), cur_(0), closed_(false)
+		name_(out.c_str()), cur_(0), closed_(false), async_(NULL)
 	{
 		out_ = fopen(out.c_str(), binary ? "wb" : "w");
 		if(out_ == NULL) {
@@ -575,13 +585,14 @@ public:
 	}
 
 	/**
-	 * Open a new output stream to a file with given name.
+	 * Open a new output stream to a file with given name.  If 'append' is
+	 * true, output is added to the end of the existing file.
 	 */
-	OutFileBuf(const char *out, bool binary = false) :
-		name_(out), cur_(0), closed_(false)
+	OutFileBuf(const char *out, bool binary = false, bool append = false) :
+		name_(out), cur_(0), closed_(false), async_(NULL)
 	{
 		assert(out != NULL);
-		out_ = fopen(out, binary ? "wb" : "w");
+		out_ = fopen(out, append ? (binary ? "ab" : "a") : (binary ? "wb" : "w"));
 		if(out_ == NULL) {
 			std::cerr << "Error: Could not open alignment output file " << out << std::endl;
 			throw 1;
@@ -591,7 +602,7 @@ public:
 	/**
 	 * Open a new output stream to standard out.
 	 */
-	OutFileBuf() : name_("cout"), cur_(0), closed_(false) {
+	OutFileBuf() : name_("cout"), cur_(0), closed_(false), async_(NULL) {
 		out_ = stdout;
 	}
 	
@@ -632,7 +643,7 @@ public:
 		if(cur_ + slen > BUF_SZ) {
 			if(cur_ > 0) flush();
 			if(slen >= BUF_SZ) {
-				fwrite(s.c_str(), slen, 1, out_);
+				writeOut(s.c_str(), slen);
 			} else {
 				memcpy(&buf_[cur_], s.data(), slen);
 				assert_eq(0, cur_);
@@ -655,7 +666,7 @@ public:
 		if(cur_ + slen > BUF_SZ) {
 			if(cur_ > 0) flush();
 			if(slen >= BUF_SZ) {
-				fwrite(s.toZBuf(), slen, 1, out_);
+				writeOut(s.toZBuf(), slen);
 			} else {
 				memcpy(&buf_[cur_], s.toZBuf(), slen);
 				assert_eq(0, cur_);
@@ -676,7 +687,7 @@ public:
 		if(cur_ + len > BUF_SZ) {
 			if(cur_ > 0) flush();
 			if(len >= BUF_SZ) {
-				fwrite(s, len, 1, out_);
+				writeOut(s, len);
 			} else {
 				memcpy(&buf_[cur_], s, len);
 				assert_eq(0, cur_);
@@ -703,6 +714,17 @@ public:
 		if(closed_) return;
 		if(cur_ > 0) flush();
 		closed_ = true;
+#ifndef _WIN32
+		if(async_ != NULL) {
+			bool ok = async_->drain();
+			delete async_;
+			async_ = NULL;
+			if(!ok) {
+				std::cerr << "Error while flushing and closing output" << std::endl;
+				throw 1;
+			}
+		}
+#endif
 		if(out_ != stdout) {
 			fclose(out_);
 		}
@@ -717,16 +739,79 @@ public:
 	}
 
 	void flush() {
-		if(!fwrite((const void *)buf_, cur_, 1, out_)) {
-            if (errno == EPIPE) {
-                exit(EXIT_SUCCESS);
-            }
-			std::cerr << "Error while flushing and closing output" << std::endl;
-			throw 1;
-		}
+		writeOut(buf_, cur_);
 		cur_ = 0;
 	}
 
+#ifndef _WIN32
+	/**
+	 * From now on, write output in the background (see async_io.h).  Only
+	 * regular files can be written this way; returns false, changing
+	 * nothing, for anything else.
+	 */
+	bool setAsync() {
+		assert(!closed_);
+		if(async_ != NULL) {
+			return true;
+		}
+		if(cur_ > 0) flush();
+		fflush(out_);
+		int fd = fileno(out_);
+		struct stat st;
+		if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+			return false;
+		}
+		off_t off = lseek(fd, 0, SEEK_CUR);
+		int fl = fcntl(fd, F_GETFL);
+		if(fl != -1 && (fl & O_APPEND) != 0) {
+			// Writes go to explicit offsets, which O_APPEND would override
+			off = lseek(fd, 0, SEEK_END);
+			fcntl(fd, F_SETFL, fl & ~O_APPEND);
+		}
+		if(off < 0) {
+			return false;
+		}
+		async_ = new AsyncWriter(fd, (int64_t)off);
+		return true;
+	}
+
+	/**
+	 * Return the name of the background writer's backend, or NULL if
+	 * output is written directly.
+	 */
+	const char *asyncBackend() const {
+		return async_ != NULL ? async_->backend() : NULL;
+	}
+#endif
+
+	/**
+	 * Write out the buffer and make sure everything written so far has
+	 * reached the disk.  Returns false if that failed.
+	 */
+	bool sync() {
+		if(cur_ > 0) flush();
+#ifdef _WIN32
+		return fflush(out_) == 0 && _commit(_fileno(out_)) == 0;
+#else
+		if(async_ != NULL) {
+			return async_->drain() && fsync(fileno(out_)) == 0;
+		}
+		return fflush(out_) == 0 && fsync(fileno(out_)) == 0;
+#endif
+	}
+
+	/**
+	 * Return the number of bytes in the file, counting buffered output.
+	 */
+	int64_t tell() {
+#ifndef _WIN32
+		if(async_ != NULL) {
+			return async_->tell() + (int64_t)cur_;
+		}
+#endif
+		return (int64_t)ftello(out_) + (int64_t)cur_;
+	}
+
 	/**
 	 * Return true iff this stream is closed.
 	 */
@@ -743,6 +828,26 @@ public:
 
 private:
 
+	/**
+	 * Write 'len' bytes straight to the file, or hand them to the
+	 * background writer.
+	 */
+	void writeOut(const char *s, size_t len) {
+#ifndef _WIN32
+		if(async_ != NULL) {
+			async_->write(s, len);
+			return;
+		}
+#endif
+		if(len > 0 && !fwrite((const void *)s, len, 1, out_)) {
+            if (errno == EPIPE) {
+                exit(EXIT_SUCCESS);
+            }
+			std::cerr << "Error while flushing and closing output" << std::endl;
+			throw 1;
+		}
+	}
+
 	static const size_t BUF_SZ = 16 * 1024;
 
 	const char *name_;
@@ -750,6 +855,7 @@ private:
 	size_t      cur_;
 	char        buf_[BUF_SZ]; // (large) input buffer
 	bool        closed_;
+	AsyncWriter *async_;      // writes output in the background, if set
 };
 
 #endif /*ndef FILEBUF_H_*/
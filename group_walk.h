@@ -107,6 +107,10 @@ public:
 		topf = tf, offs = o;
 	}
 
+	void init(TIndexOffU tf, size_t len_, const T& o) {
+		topf = tf, len = len_, offs = o;
+	}
+
 	/**
 	 * Reset to uninitialized state.
 	 */
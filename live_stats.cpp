@@ -0,0 +1,140 @@
+/*
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of Bowtie 2.
+ *
+ * Bowtie 2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bowtie 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bowtie 2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <sys/time.h>
+#include <iostream>
+#include "assert_helpers.h"
+#include "live_stats.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+/**
+ * Return the time in ms since the epoch.
+ */
+static uint64_t nowMs() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (uint64_t)tv.tv_sec * 1000 + (uint64_t)tv.tv_usec / 1000;
+}
+
+LiveStats::~LiveStats() {
+#ifndef _WIN32
+	if(words_ != NULL) {
+		munmap(words_, bytes_);
+	}
+#endif
+}
+
+/**
+ * Create the file with a slot for each of 'nslots' threads and map it.
+ * Returns false, having printed an error, if that can't be done.
+ */
+bool LiveStats::open(const string& fname, size_t nslots) {
+#ifdef _WIN32
+	(void)nslots;
+	cerr << "Error: --met-live is not supported on Windows" << endl;
+	return false;
+#else
+	assert(words_ == NULL);
+	assert_gt(nslots, 0);
+	size_t bytes = (HEADER_WORDS + nslots * SLOT_WORDS) * sizeof(uint64_t);
+	int fd = ::open(fname.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0) {
+		cerr << "Error: Could not open --met-live file " << fname.c_str()
+		     << ": " << strerror(errno) << endl;
+		return false;
+	}
+	if(ftruncate(fd, (off_t)bytes) != 0) {
+		cerr << "Error: Could not size --met-live file " << fname.c_str()
+		     << ": " << strerror(errno) << endl;
+		close(fd);
+		return false;
+	}
+	void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(p == MAP_FAILED) {
+		cerr << "Error: Could not map --met-live file " << fname.c_str()
+		     << ": " << strerror(errno) << endl;
+		return false;
+	}
+	words_ = (uint64_t *)p;
+	bytes_ = bytes;
+	nslots_ = nslots;
+	// The file is all zeros, so the slots already read as "nothing done
+	// yet"; fill in the header, magic last
+	uint32_t *w32 = (uint32_t *)(words_ + 1);
+	w32[0] = VERSION;
+	w32[1] = (uint32_t)nslots;
+	w32[2] = (uint32_t)(SLOT_WORDS * sizeof(uint64_t));
+	words_[3] = (uint64_t)getpid();
+	words_[4] = nowMs();
+	uint64_t magic = 0;
+	memcpy(&magic, "BT2LIVE", 8);
+	__atomic_store_n(&words_[0], magic, __ATOMIC_RELEASE);
+	return true;
+#endif
+}
+
+/**
+ * Publish thread 'tid''s totals and queue depths.  Only thread 'tid'
+ * writes its slot, so no lock is needed; the sequence number lets readers
+ * tell a torn copy from a good one.
+ */
+void LiveStats::publish(
+	size_t tid,
+	const LiveCounts& c,
+	uint64_t inBatch,
+	uint64_t outPending,
+	bool done)
+{
+	assert_lt(tid, nslots_);
+	uint64_t *s = words_ + HEADER_WORDS + tid * SLOT_WORDS;
+	uint64_t seq = s[0];
+	__atomic_store_n(&s[0], seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&s[1],  nowMs(),    __ATOMIC_RELAXED);
+	__atomic_store_n(&s[2],  c.reads,    __ATOMIC_RELAXED);
+	__atomic_store_n(&s[3],  c.bases,    __ATOMIC_RELAXED);
+	__atomic_store_n(&s[4],  c.mates,    __ATOMIC_RELAXED);
+	__atomic_store_n(&s[5],  c.aligned,  __ATOMIC_RELAXED);
+	__atomic_store_n(&s[6],  c.seedHits, __ATOMIC_RELAXED);
+	__atomic_store_n(&s[7],  c.dps,      __ATOMIC_RELAXED);
+	__atomic_store_n(&s[8],  c.dpCells,  __ATOMIC_RELAXED);
+	__atomic_store_n(&s[9],  inBatch,    __ATOMIC_RELAXED);
+	__atomic_store_n(&s[10], outPending, __ATOMIC_RELAXED);
+	__atomic_store_n(&s[11], (uint64_t)(done ? 1 : 0), __ATOMIC_RELAXED);
+	__atomic_store_n(&s[0], seq + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * Mark the run as finished.
+ */
+void LiveStats::finish() {
+	assert(words_ != NULL);
+	__atomic_store_n(&words_[6], nowMs(), __ATOMIC_RELAXED);
+	__atomic_store_n(&words_[5], (uint64_t)1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of Bowtie 2.
+ *
+ * Bowtie 2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bowtie 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bowtie 2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * live_stats.h
+ *
+ * Live counters for --met-live.  The file is mapped into memory and each
+ * alignment thread owns one 128-byte slot in it, which it rewrites every
+ * few reads without taking any lock.  Another process can map or read the
+ * file at any time to see how far the run has got and whether each thread
+ * is still making progress.
+ *
+ * Each slot is guarded by a sequence number: the thread makes it odd
+ * before it updates the slot and even again afterwards, so a reader that
+ * sees the same even number before and after copying a slot has a
+ * consistent copy.
+ *
+ * File layout (all words little- or big-endian as the machine is):
+ *
+ *   header, 64 bytes:
+ *     char[8]    "BT2LIVE\0"
+ *     uint32_t   version (1)
+ *     uint32_t   # slots (one per alignment thread)
+ *     uint32_t   bytes per slot (128)
+ *     uint32_t   unused
+ *     uint64_t   process id
+ *     uint64_t   start time, ms since the epoch
+ *     uint64_t   state: 0 = aligning, 1 = finished
+ *     uint64_t   end time, ms since the epoch, once finished
+ *     uint64_t   unused
+ *   slots, one per thread, each 16 uint64_t words:
+ *     0   sequence number
+ *     1   time of this update, ms since the epoch
+ *     2   reads or pairs processed
+ *     3   bases processed
+ *     4   mates eligible to align (unpaired reads plus 2 per pair)
+ *     5   mates aligned, as counted by the overall alignment rate
+ *     6   seed hits (BW range elements found for seeds)
+ *     7   dynamic programming problems
+ *     8   dynamic programming cells
+ *     9   reads left in the thread's input batch
+ *     10  SAM records waiting in the output queue
+ *     11  1 once the thread has finished, else 0
+ *     12-15 unused
+ */
+
+#ifndef LIVE_STATS_H_
+#define LIVE_STATS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+/**
+ * Running totals for one thread, as published in its slot.
+ */
+struct LiveCounts {
+
+	LiveCounts() { reset(); }
+
+	void reset() {
+		reads = bases = mates = aligned = seedHits = dps = dpCells = 0;
+	}
+
+	uint64_t reads;    // reads or pairs processed
+	uint64_t bases;    // bases processed
+	uint64_t mates;    // mates eligible to align
+	uint64_t aligned;  // mates aligned
+	uint64_t seedHits; // seed range elements found
+	uint64_t dps;      // dynamic programming problems
+	uint64_t dpCells;  // dynamic programming cells
+};
+
+/**
+ * The memory-mapped --met-live file.
+ */
+class LiveStats {
+
+public:
+
+	static const uint32_t VERSION = 1;
+	static const size_t HEADER_WORDS = 8;
+	static const size_t SLOT_WORDS = 16;
+
+	LiveStats() : words_(NULL), bytes_(0), nslots_(0) { }
+
+	~LiveStats();
+
+	/**
+	 * Create the file with a slot for each of 'nslots' threads and map it.
+	 * Returns false, having printed an error, if that can't be done.
+	 */
+	bool open(const std::string& fname, size_t nslots);
+
+	/**
+	 * Publish thread 'tid''s totals and queue depths.
+	 */
+	void publish(
+		size_t tid,
+		const LiveCounts& c,
+		uint64_t inBatch,
+		uint64_t outPending,
+		bool done);
+
+	/**
+	 * Mark the run as finished.
+	 */
+	void finish();
+
+	/**
+	 * Return the number of slots.
+	 */
+	size_t slots() const { return nslots_; }
+
+protected:
+
+	uint64_t *words_;  // mapped file
+	size_t    bytes_;  // its length
+	size_t    nslots_; // # slots
+};
+
+#endif /*ndef LIVE_STATS_H_*/
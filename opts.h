@@ -124,6 +124,11 @@ enum {
 	ARG_VERSION,                // --version
 	ARG_SEED_OFF,               // --seed-off
 	ARG_SEED_BOOST_THRESH,      // --seed-boost
+	ARG_MINIMIZERS,             // --minimizers
+	ARG_MINI_WIN,               // --mini-win
+	ARG_SEED_CAP,               // --seed-cap
+	ARG_REP_MASK,               // --rep-mask
+	ARG_MAPQ_STOP,              // --mapq-stop
 	ARG_READ_TIMES,             // --read-times
 	ARG_EXTEND_ITERS,           // --extends
 	ARG_DP_MATE_STREAK_THRESH,  // --db-mate-streak
@@ -146,17 +151,44 @@ enum {
 	ARG_SAM_NO_UNAL,            // --no-unal
 	ARG_NON_DETERMINISTIC,      // --non-deterministic
 	ARG_TEST_25,                // --test-25
+	ARG_DESCENT,                // --descent
 	ARG_DESC_KB,                // --desc-kb
 	ARG_DESC_LANDING,           // --desc-landing
 	ARG_DESC_EXP,               // --desc-exp
 	ARG_DESC_PRIORITIZE,        // --desc-prioritize
 	ARG_DESC_FMOPS,             // --desc-fmops
+	ARG_DESC_LEN,               // --desc-len
 	ARG_LOG_DP,                 // --log-dp
 	ARG_LOG_DP_OPP,             // --log-dp-opp
 	ARG_XEQ,                    // --xeq
 	ARG_THREAD_CEILING,         // --thread-ceiling
 	ARG_THREAD_PIDDIR,          // --thread-piddir
-	ARG_INTERLEAVED_FASTQ       // --interleaved
+	ARG_INTERLEAVED_FASTQ,      // --interleaved
+	ARG_UN,                     // --un
+	ARG_UN_GZ,                  // --un-gz
+	ARG_UN_BZ2,                 // --un-bz2
+	ARG_UN_LZ4,                 // --un-lz4
+	ARG_AL,                     // --al
+	ARG_AL_GZ,                  // --al-gz
+	ARG_AL_BZ2,                 // --al-bz2
+	ARG_AL_LZ4,                 // --al-lz4
+	ARG_UN_CONC,                // --un-conc
+	ARG_UN_CONC_GZ,             // --un-conc-gz
+	ARG_UN_CONC_BZ2,            // --un-conc-bz2
+	ARG_UN_CONC_LZ4,            // --un-conc-lz4
+	ARG_AL_CONC,                // --al-conc
+	ARG_AL_CONC_GZ,             // --al-conc-gz
+	ARG_AL_CONC_BZ2,            // --al-conc-bz2
+	ARG_AL_CONC_LZ4,            // --al-conc-lz4
+	ARG_DUST,                   // --dust
+	ARG_SHARD,                  // --shard
+	ARG_ALL_INDEXES,            // --all-indexes
+	ARG_CHECKPOINT,             // --checkpoint
+	ARG_CHECKPOINT_EVERY,       // --checkpoint-every
+	ARG_RESUME,                 // --resume
+	ARG_ASYNC_IO,               // --async-io
+	ARG_METRIC_LIVE,            // --met-live
+	ARG_MATE_ISECT              // --mate-isect
 };
 
 #endif
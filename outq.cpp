@@ -18,6 +18,7 @@
  */
 
 #include "outq.h"
+#include "checkpoint.h"
 
 /**
  * Caller is telling us that they're about to write output record(s) for
@@ -100,6 +101,25 @@ void OutputQueue::finishRead(const BTString& rec, TReadId rdid, size_t threadId)
 	}
 }
 
+/**
+ * Caller is telling us that the read with the given id will produce no
+ * output records.  Only matters when reordering.
+ */
+void OutputQueue::skipRead(TReadId rdid, size_t threadId) {
+	if(!reorder_) {
+		return;
+	}
+	BTString empty;
+	if(threadSafe_) {
+		ThreadSafe ts(mutex_m);
+		beginReadImpl(rdid, threadId);
+		finishReadImpl(empty, rdid, threadId);
+	} else {
+		beginReadImpl(rdid, threadId);
+		finishReadImpl(empty, rdid, threadId);
+	}
+}
+
 /**
  * Write already-finished lines starting from cur_.
  */
@@ -137,6 +157,9 @@ void OutputQueue::flushImpl(bool force) {
 		finished_.erase(0, nflush);
 		cur_ += nflush;
 		nflushed_ += nflush;
+		if(ckpt_ != NULL && nflush > 0) {
+			ckpt_->flushed(cur_);
+		}
 	}
 }
 
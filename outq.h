@@ -27,6 +27,8 @@
 #include "threading.h"
 #include "mem_ids.h"
 
+class OutputCheckpointer;
+
 /**
  * Encapsulates a list of lines of output.  If the earliest as-yet-unreported
  * read has id N and Bowtie 2 wants to write a record for read with id N+1, we
@@ -58,7 +60,8 @@ public:
 		threadSafe_(threadSafe),
 		mutex_m(),
 		nthreads_(nthreads),
-		perThreadBufSize_(perThreadBufSize)
+		perThreadBufSize_(perThreadBufSize),
+		ckpt_(NULL)
 	{
 		nstarted_=0;
 		assert(nthreads_ <= 2 || threadSafe);
@@ -87,6 +90,14 @@ public:
 	 * Writer is finished writing to 
 	 */
 	void finishRead(const BTString& rec, TReadId rdid, size_t threadId);
+
+	/**
+	 * Caller is telling us that the read with the given id will produce no
+	 * output records at all (e.g. because of --sample or --shard).  When
+	 * reordering, its slot is marked finished so later reads aren't held
+	 * back waiting for it.
+	 */
+	void skipRead(TReadId rdid, size_t threadId);
 	
 	/**
 	 * Return the number of records currently being buffered.
@@ -95,6 +106,19 @@ public:
 		return lines_.size();
 	}
 	
+	/**
+	 * Return the number of finished records waiting to be written, as far
+	 * as thread 'threadId' can tell without the lock: with reordering,
+	 * those held back behind earlier reads, otherwise those in the
+	 * thread's own buffer.  Only approximate while other threads run.
+	 */
+	size_t pending(size_t threadId) const {
+		if(reorder_) {
+			return (size_t)(nfinished_ - nflushed_);
+		}
+		return (size_t)perThreadCounter[threadId];
+	}
+
 	/**
 	 * Return the number of records that have been flushed so far.
 	 */
@@ -121,6 +145,23 @@ public:
 	 */
 	void flush(bool force = false, bool getLock = true);
 
+	/**
+	 * Tell the given OutputCheckpointer each time reads are flushed.  Only
+	 * meaningful when reordering, since otherwise the flushed reads aren't
+	 * a prefix of the input.
+	 */
+	void setCheckpointer(OutputCheckpointer *ckpt) {
+		assert(reorder_ || ckpt == NULL);
+		ckpt_ = ckpt;
+	}
+
+	/**
+	 * Return the id of the earliest read not yet flushed.
+	 */
+	TReadId nextToFlush() const {
+		return cur_;
+	}
+
 protected:
 
 	OutFileBuf&     obuf_;
@@ -145,6 +186,8 @@ protected:
 	int* 		perThreadCounter;
 	int perThreadBufSize_;
 
+	OutputCheckpointer *ckpt_; // told about flushes, if not NULL
+
 private:
 
 	void flushImpl(bool force);
@@ -18,6 +18,8 @@
  */
 
 #include <cmath>
+#include <string.h>
+#include <sys/stat.h>
 #include <iostream>
 #include <string>
 #include <stdexcept>
@@ -275,6 +277,94 @@ pair<bool, int> DualPatternComposer::nextBatch(PerThreadReadBuf& pt) {
 	return make_pair(true, 0);
 }
 
+/**
+ * Have the underlying sources remember where each batch begins.
+ */
+void SoloPatternComposer::trackBatchStarts() {
+	for(size_t i = 0; i < src_->size(); i++) {
+		(*src_)[i]->trackBatchStarts();
+	}
+}
+
+/**
+ * Set 'pos' to a point at or before read 'rdid' from which reading can
+ * restart.  Only possible when all input comes through one source, i.e.
+ * when files aren't read in parallel.
+ */
+bool SoloPatternComposer::restartPoints(TReadId rdid, EList<InputPos>& pos) {
+	pos.clear();
+	if(src_->size() != 1) {
+		return false;
+	}
+	pos.expand();
+	return (*src_)[0]->restartPoint(rdid, pos.back());
+}
+
+/**
+ * Resume reading at a point returned by restartPoints().
+ */
+bool SoloPatternComposer::seek(const EList<InputPos>& pos) {
+	if(src_->size() != 1 || pos.size() != 1) {
+		return false;
+	}
+	return (*src_)[0]->seek(pos[0]);
+}
+
+/**
+ * Have the underlying sources remember where each batch begins.
+ */
+void DualPatternComposer::trackBatchStarts() {
+	for(size_t i = 0; i < srca_->size(); i++) {
+		(*srca_)[i]->trackBatchStarts();
+		if((*srcb_)[i] != NULL) {
+			(*srcb_)[i]->trackBatchStarts();
+		}
+	}
+}
+
+/**
+ * Set 'pos' to points in the mate-1 and, if paired, mate-2 input at or
+ * before read 'rdid' from which reading can restart.  Since the two are
+ * read in lockstep, both points must start at the same read.
+ */
+bool DualPatternComposer::restartPoints(TReadId rdid, EList<InputPos>& pos) {
+	pos.clear();
+	if(srca_->size() != 1) {
+		return false;
+	}
+	pos.expand();
+	if(!(*srca_)[0]->restartPoint(rdid, pos.back())) {
+		return false;
+	}
+	if((*srcb_)[0] != NULL) {
+		pos.expand();
+		if(!(*srcb_)[0]->restartPoint(rdid, pos.back()) ||
+		   pos[0].rdid != pos[1].rdid)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Resume reading at points returned by restartPoints().
+ */
+bool DualPatternComposer::seek(const EList<InputPos>& pos) {
+	const size_t nsrc = ((*srcb_)[0] != NULL) ? 2 : 1;
+	if(srca_->size() != 1 || pos.size() != nsrc) {
+		return false;
+	}
+	if(!(*srca_)[0]->seek(pos[0])) {
+		return false;
+	}
+	if(nsrc == 2 && !(*srcb_)[0]->seek(pos[1])) {
+		(*srca_)[0]->reset();
+		return false;
+	}
+	return true;
+}
+
 /**
  * Given the values for all of the various arguments used to specify
  * the read and quality input, create a list of pattern sources to
@@ -403,6 +493,14 @@ pair<bool, int> CFilePatternSource::nextBatchImpl(
 	bool done = false;
 	int nread = 0;
 	pt.setReadId(readCnt_);
+	if(trackStarts_) {
+		InputPos pos;
+		pos.rdid = readCnt_;
+		pos.file = filecur_ - 1;
+		pos.off = fileOffset();
+		ThreadSafe ts(starts_mutex_m);
+		starts_.push_back(pos);
+	}
 	while(true) { // loop that moves on to next file when needed
 		do {
 			pair<bool, int> ret = nextBatchFromFile(pt, batch_a);
@@ -439,6 +537,84 @@ pair<bool, int> CFilePatternSource::nextBatch(
 	}
 }
 
+/**
+ * Set 'pos' to the latest batch start at or before read 'rdid' and forget
+ * earlier ones.  Return false if there's none or if it's in a file that
+ * can't be seeked.
+ */
+bool CFilePatternSource::restartPoint(TReadId rdid, InputPos& pos) {
+	ThreadSafe ts(starts_mutex_m);
+	size_t i = 0;
+	while(i < starts_.size() && starts_[i].rdid <= rdid) {
+		i++;
+	}
+	if(i == 0) {
+		return false;
+	}
+	pos = starts_[i-1];
+	starts_.erase(0, i-1);
+	return pos.off >= 0;
+}
+
+/**
+ * Reopen the file named in 'pos' and seek to its offset, so that the next
+ * batch begins with read pos.rdid.  If that's not possible, go back to the
+ * first read and return false.
+ */
+bool CFilePatternSource::seek(const InputPos& pos) {
+	if(!restartable() || pos.off < 0 || pos.file >= infiles_.size()) {
+		return false;
+	}
+	filecur_ = pos.file;
+	open();
+	if(filecur_ != pos.file || compressed_ || !seekTo(pos.off)) {
+		reset();
+		return false;
+	}
+	filecur_++;
+	resetForNextFile();
+	readCnt_ = pos.rdid;
+	return true;
+}
+
+/**
+ * Move to offset 'off' in the file just opened.  Returns false if that
+ * can't be done.
+ */
+bool CFilePatternSource::seekTo(int64_t off) {
+	if(decoder_ == DECODE_NONE) {
+		return fseeko(fp_, (off_t)off, SEEK_SET) == 0;
+	}
+#ifndef _WIN32
+	if(decoder_ == DECODE_ASYNC) {
+		// Start reading ahead from the new offset instead
+		closeDecoder();
+		decoder_ = DECODE_ASYNC;
+		return openDecoder(off);
+	}
+#endif
+	return false;
+}
+
+/**
+ * Return the offset in the current file of the next byte to be parsed, or
+ * -1 if that can't be known (compressed input).
+ */
+int64_t CFilePatternSource::fileOffset() {
+	if(!is_open_ || compressed_) {
+		return -1;
+	}
+	if(decoder_ == DECODE_NONE) {
+		return (int64_t)ftello(fp_);
+	}
+#ifndef _WIN32
+	if(decoder_ == DECODE_ASYNC) {
+		return areader_->offset() + (int64_t)dcur_;
+	}
+#endif
+	return -1;
+}
+
 /**
  * Open the next file in the list of input files.
  */
@@ -450,11 +626,13 @@ void CFilePatternSource::open() {
 			zfp_ = NULL;
 		}
 		else {
+			closeDecoder();
 			fclose(fp_);
       			fp_ = NULL;
       		}
 	}
 	while(filecur_ < infiles_.size()) {
+		decoder_ = DECODE_NONE;
 		if(infiles_[filecur_] == "-") {
 			// always assume that data from stdin is compressed
 			compressed_ = true;
@@ -469,6 +647,12 @@ void CFilePatternSource::open() {
 			}
 			else {
 				fp_ = fopen(infiles_[filecur_].c_str(), "rb");
+				decoder_ = decoderFor(infiles_[filecur_]);
+				if(fp_ != NULL && !openDecoder()) {
+					closeDecoder();
+					fclose(fp_);
+					fp_ = NULL;
+				}
 			}
 			if((compressed_ && zfp_ == NULL) || (!compressed_ && fp_ == NULL)) {
 				if(!errs_[filecur_]) {
@@ -500,6 +684,175 @@ void CFilePatternSource::open() {
 	return;
 }
 
+/**
+ * Return the decoder to use for the given file: DECODE_BZ2 for .bz2 files
+ * and DECODE_LZ4 for .lz4 files if bowtie2-align was built with support
+ * for them, DECODE_ASYNC for other files with --async-io, or DECODE_NONE
+ * otherwise.
+ */
+int CFilePatternSource::decoderFor(const string& filename) const {
+	size_t pos = filename.find_last_of(".");
+	string ext = (pos == string::npos) ? "" : filename.substr(pos + 1);
+#ifdef WITH_BZ2
+	if(ext == "bz2") {
+		return DECODE_BZ2;
+	}
+#endif
+#ifdef WITH_LZ4
+	if(ext == "lz4") {
+		return DECODE_LZ4;
+	}
+#endif
+#ifndef _WIN32
+	if(pp_.asyncIo) {
+		return DECODE_ASYNC;
+	}
+#endif
+	return DECODE_NONE;
+}
+
+/**
+ * Set up the bzip2 or lz4 decoder, or the read-ahead starting at offset
+ * 'off', for the just-opened fp_.  Returns false if the decoder could not
+ * be initialized.
+ */
+bool CFilePatternSource::openDecoder(int64_t off) {
+	dptr_ = dbuf_;
+	dcur_ = dlen_ = 0;
+#ifndef _WIN32
+	if(decoder_ == DECODE_ASYNC) {
+		struct stat st;
+		if(fstat(fileno(fp_), &st) != 0 || !S_ISREG(st.st_mode)) {
+			// A pipe can't be read at given offsets; read it as usual
+			decoder_ = DECODE_NONE;
+			return true;
+		}
+		areader_ = new AsyncReader(fileno(fp_), off);
+		return true;
+	}
+#endif
+	(void)off;
+#ifdef WITH_BZ2
+	if(decoder_ == DECODE_BZ2) {
+		int err = BZ_OK;
+		bzfp_ = BZ2_bzReadOpen(&err, fp_, 0, 0, NULL, 0);
+		return err == BZ_OK;
+	}
+#endif
+#ifdef WITH_LZ4
+	if(decoder_ == DECODE_LZ4) {
+		lz4cur_ = lz4len_ = 0;
+		return !LZ4F_isError(LZ4F_createDecompressionContext(&lz4ctx_, LZ4F_VERSION));
+	}
+#endif
+	return true;
+}
+
+/**
+ * Free the decoder state, if any.
+ */
+void CFilePatternSource::closeDecoder() {
+#ifdef WITH_BZ2
+	if(bzfp_ != NULL) {
+		int err = BZ_OK;
+		BZ2_bzReadClose(&err, bzfp_);
+		bzfp_ = NULL;
+	}
+#endif
+#ifdef WITH_LZ4
+	if(lz4ctx_ != NULL) {
+		LZ4F_freeDecompressionContext(lz4ctx_);
+		lz4ctx_ = NULL;
+	}
+#endif
+#ifndef _WIN32
+	delete areader_;
+	areader_ = NULL;
+#endif
+	decoder_ = DECODE_NONE;
+	dptr_ = dbuf_;
+	dcur_ = dlen_ = 0;
+}
+
+/**
+ * Decode the next chunk of the current bzip2 or lz4 file into dbuf_, or
+ * get the next chunk that was read ahead.  Returns false at end of input.
+ * Called with the input lock held, like the rest of the light parsing.
+ */
+bool CFilePatternSource::fillDecoded() {
+	assert_gt(filecur_, 0);
+	const string& fn = infiles_[filecur_-1];
+	dcur_ = dlen_ = 0;
+#ifndef _WIN32
+	if(decoder_ == DECODE_ASYNC) {
+		return areader_->next(dptr_, dlen_);
+	}
+#endif
+#ifdef WITH_BZ2
+	if(decoder_ == DECODE_BZ2) {
+		while(dlen_ == 0 && bzfp_ != NULL) {
+			int err = BZ_OK;
+			int n = BZ2_bzRead(&err, bzfp_, dbuf_, (int)sizeof(dbuf_));
+			if(n > 0) {
+				dlen_ = (size_t)n;
+			}
+			if(err == BZ_STREAM_END) {
+				// Parallel compressors like pbzip2 write several
+				// concatenated streams; move on to the next one
+				void *unused = NULL;
+				int nunused = 0;
+				char leftover[BZ_MAX_UNUSED];
+				BZ2_bzReadGetUnused(&err, bzfp_, &unused, &nunused);
+				memcpy(leftover, unused, nunused);
+				BZ2_bzReadClose(&err, bzfp_);
+				bzfp_ = NULL;
+				int c = EOF;
+				if(nunused == 0 && (c = getc_unlocked(fp_)) != EOF) {
+					ungetc(c, fp_);
+				}
+				if(nunused > 0 || c != EOF) {
+					bzfp_ = BZ2_bzReadOpen(&err, fp_, 0, 0, leftover, nunused);
+				}
+			}
+			if(err != BZ_OK) {
+				cerr << "Error: could not decompress bzip2 read file \""
+				     << fn.c_str() << "\" (bzip2 error " << err << ")" << endl;
+				throw 1;
+			}
+		}
+		return dlen_ > 0;
+	}
+#endif
+#ifdef WITH_LZ4
+	if(decoder_ == DECODE_LZ4) {
+		while(dlen_ == 0) {
+			if(lz4cur_ == lz4len_) {
+				lz4cur_ = 0;
+				lz4len_ = fread(lz4buf_, 1, sizeof(lz4buf_), fp_);
+				if(lz4len_ == 0) {
+					break;
+				}
+			}
+			// Concatenated frames are decoded one after another
+			size_t dstsz = sizeof(dbuf_);
+			size_t srcsz = lz4len_ - lz4cur_;
+			size_t ret = LZ4F_decompress(
+				lz4ctx_, dbuf_, &dstsz, lz4buf_ + lz4cur_, &srcsz, NULL);
+			if(LZ4F_isError(ret)) {
+				cerr << "Error: could not decompress lz4 read file \""
+				     << fn.c_str() << "\" (" << LZ4F_getErrorName(ret) << ")" << endl;
+				throw 1;
+			}
+			lz4cur_ += srcsz;
+			dlen_ = dstsz;
+		}
+		return dlen_ > 0;
+	}
+#endif
+	(void)fn;
+	return false;
+}
+
 /**
  * Constructor for vector pattern source, used when the user has
  * specified the input strings on the command line using the -c
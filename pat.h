@@ -23,6 +23,12 @@
 #include <stdio.h>
 #include <sys/stat.h>
 #include <zlib.h>
+#ifdef WITH_BZ2
+#include <bzlib.h>
+#endif
+#ifdef WITH_LZ4
+#include <lz4frame.h>
+#endif
 #include <cassert>
 #include <string>
 #include <ctype.h>
@@ -36,6 +42,8 @@
 #include "ds.h"
 #include "read.h"
 #include "util.h"
+#include "mem_ids.h"
+#include "async_io.h"
 
 #ifdef _WIN32
 #define getc_unlocked _fgetc_nolock
@@ -66,7 +74,8 @@ struct PatternParams {
 		int sampleFreq_,
 		size_t skip_,
 		int nthreads_,
-		bool fixName_) :
+		bool fixName_,
+		bool asyncIo_) :
 		format(format_),
 		fileParallel(fileParallel_),
 		seed(seed_),
@@ -80,7 +89,8 @@ struct PatternParams {
 		sampleFreq(sampleFreq_),
 		skip(skip_),
 		nthreads(nthreads_),
-		fixName(fixName_) { }
+		fixName(fixName_),
+		asyncIo(asyncIo_) { }
 
 	int format;			  // file format
 	bool fileParallel;	  // true -> wrap files with separate PatternComposers
@@ -96,6 +106,7 @@ struct PatternParams {
 	size_t skip;		  // skip the first 'skip' patterns
 	int nthreads;		  // number of threads for locking
 	bool fixName;		  //
+	bool asyncIo;		  // read plain files ahead in the background
 };
 
 /**
@@ -182,6 +193,17 @@ extern void wrongQualityFormat(const BTString& read_name);
 extern void tooFewQualities(const BTString& read_name);
 extern void tooManyQualities(const BTString& read_name);
 
+/**
+ * A point in the input from which reading can restart: the read id of the
+ * first read there, the index of the file and the byte offset within it.
+ * Used to write and resume from --checkpoint files.
+ */
+struct InputPos {
+	TReadId rdid; // id of first read at this point
+	size_t  file; // index into the list of input files
+	int64_t off;  // byte offset into the file, or -1 if it can't seek
+};
+
 /**
  * Encapsulates a synchronized source of patterns; usually a file.
  * Optionally reverses reads and quality strings before returning them,
@@ -235,6 +257,26 @@ public:
 	 * Return number of reads light-parsed by this stream so far.
 	 */
 	TReadId readCount() const { return readCnt_; }
+
+	/**
+	 * Start remembering where in the input each batch begins, so that
+	 * restartPoint() has something to return.
+	 */
+	virtual void trackBatchStarts() { }
+
+	/**
+	 * Set 'pos' to the latest batch start at or before read 'rdid' and
+	 * forget earlier ones.  Return false if there is no such point or
+	 * reading can't restart there, e.g. because the file is compressed.
+	 */
+	virtual bool restartPoint(TReadId rdid, InputPos& pos) { return false; }
+
+	/**
+	 * Resume reading at a point returned by restartPoint() in an earlier
+	 * run.  Returns false, leaving the source at the first read, if that's
+	 * not possible.  Should only be called by the master thread.
+	 */
+	virtual bool seek(const InputPos& pos) { return false; }
 	
 protected:
 	
@@ -306,6 +348,20 @@ private:
 	char nametmp_[20];		   // temp buffer for constructing name
 };
 
+/**
+ * Compressed formats that CFilePatternSource decodes itself, apart from
+ * gzip, which zlib handles, and DECODE_ASYNC for uncompressed files read
+ * ahead by an AsyncReader with --async-io.
+ */
+enum {
+	DECODE_NONE = 0,
+	DECODE_BZ2,
+	DECODE_LZ4,
+	DECODE_ASYNC
+};
+
+class AsyncReader;
+
 /**
  * Parent class for PatternSources that read from a file.
  * Uses unlocked C I/O, on the assumption that all reading
@@ -322,10 +378,25 @@ public:
 		filecur_(0),
 		fp_(NULL),
 		zfp_(NULL),
+#ifdef WITH_BZ2
+		bzfp_(NULL),
+#endif
+#ifdef WITH_LZ4
+		lz4ctx_(NULL),
+		lz4cur_(0),
+		lz4len_(0),
+#endif
 		is_open_(false),
 		skip_(p.skip),
 		first_(true),
-		compressed_(false)
+		compressed_(false),
+		decoder_(DECODE_NONE),
+		dptr_(dbuf_),
+		dcur_(0),
+		dlen_(0),
+		areader_(NULL),
+		trackStarts_(false),
+		starts_(MISC_CAT)
 	{
 		assert_gt(infiles.size(), 0);
 		errs_.resize(infiles_.size());
@@ -345,6 +416,7 @@ public:
 			}
 			else {
 				assert(fp_ != NULL);
+				closeDecoder();
 				fclose(fp_);
 			}
 		}
@@ -374,8 +446,31 @@ public:
 		filecur_++;
 	}
 
+	/**
+	 * Start remembering where each batch begins.
+	 */
+	virtual void trackBatchStarts() {
+		trackStarts_ = restartable();
+	}
+
+	/**
+	 * Set 'pos' to the latest batch start at or before read 'rdid'.
+	 */
+	virtual bool restartPoint(TReadId rdid, InputPos& pos);
+
+	/**
+	 * Reopen the file named in 'pos' and seek to its offset.
+	 */
+	virtual bool seek(const InputPos& pos);
+
 protected:
 
+	/**
+	 * Return true iff every batch of this format starts at the beginning
+	 * of a record, so that reading can restart at any batch start.
+	 */
+	virtual bool restartable() const { return false; }
+
 	/**
 	 * Light-parse a batch of unpaired reads from current file into the given
 	 * buffer.	Called from CFilePatternSource.nextBatch().
@@ -395,13 +490,64 @@ protected:
 	void open();
 
 	int getc_wrapper() {
+		if(decoder_ != DECODE_NONE) {
+			if(dcur_ == dlen_ && !fillDecoded()) {
+				return -1;
+			}
+			return (unsigned char)dptr_[dcur_++];
+		}
 		return compressed_ ? gzgetc(zfp_) : getc_unlocked(fp_);
 	}
 
 	int ungetc_wrapper(int c) {
+		if(decoder_ != DECODE_NONE) {
+			if(c < 0) {
+				return c;
+			}
+			assert_gt(dcur_, 0);
+			dptr_[--dcur_] = (char)c;
+			return c;
+		}
 		return compressed_ ? gzungetc(c, zfp_) : ungetc(c, fp_);
 	}
 
+	/**
+	 * Return the decoder to use for the given file: DECODE_BZ2 for .bz2
+	 * files and DECODE_LZ4 for .lz4 files if bowtie2-align was built with
+	 * support for them, or DECODE_NONE otherwise.
+	 */
+	int decoderFor(const std::string& filename) const;
+
+	/**
+	 * Set up the bzip2 or lz4 decoder, or the read-ahead, for the
+	 * just-opened fp_.  Read-ahead starts at offset 'off'.
+	 */
+	bool openDecoder(int64_t off = 0);
+
+	/**
+	 * Free the decoder state, if any.
+	 */
+	void closeDecoder();
+
+	/**
+	 * Decode the next chunk of the current bzip2 or lz4 file into dbuf_,
+	 * or get the next chunk that was read ahead.  Returns false at end of
+	 * input.
+	 */
+	bool fillDecoded();
+
+	/**
+	 * Return the offset in the current file of the next byte to be
+	 * parsed, or -1 if that can't be known.
+	 */
+	int64_t fileOffset();
+
+	/**
+	 * Move to offset 'off' in the file just opened.  Returns false if that
+	 * can't be done.
+	 */
+	bool seekTo(int64_t off);
+
 	bool is_gzipped_file(const std::string& filename) {
 		struct stat s;
 		if (stat(filename.c_str(), &s) != 0) {
@@ -424,11 +570,29 @@ protected:
 	size_t filecur_;		 // index into infiles_ of next file to read
 	FILE *fp_;			 // read file currently being read from
 	gzFile zfp_;			 // compressed version of fp_
+#ifdef WITH_BZ2
+	BZFILE *bzfp_;			 // bzip2 stream over fp_
+#endif
+#ifdef WITH_LZ4
+	LZ4F_dctx *lz4ctx_;		 // lz4 frame decoder
+	char lz4buf_[64*1024];		 // compressed input for lz4ctx_
+	size_t lz4cur_;			 // next unconsumed byte of lz4buf_
+	size_t lz4len_;			 // # valid bytes in lz4buf_
+#endif
 	bool is_open_;			 // whether fp_ is currently open
 	TReadId skip_;			 // number of reads to skip
 	bool first_;			 // parsing first record in first file?
 	char buf_[64*1024];		 // file buffer
 	bool compressed_;
+	int decoder_;			 // DECODE_* for the current file
+	char dbuf_[64*1024];		 // decoded bzip2/lz4 data
+	char *dptr_;			 // dbuf_, or the chunk read ahead
+	size_t dcur_;			 // next unread byte of dptr_
+	size_t dlen_;			 // # valid bytes in dptr_
+	AsyncReader *areader_;		 // reads ahead with DECODE_ASYNC
+	bool trackStarts_;		 // record batch starts in starts_?
+	EList<InputPos> starts_;	 // where recent batches began
+	MUTEX_T starts_mutex_m;	 // protects starts_
 
 private:
 
@@ -684,6 +848,11 @@ protected:
 		first_ = true;
 	}
 
+	/**
+	 * Batches always end at the end of a record.
+	 */
+	virtual bool restartable() const { return true; }
+
 	bool first_;		// parsing first read in file
 	bool interleaved_;	// fastq reads are interleaved
 };
@@ -754,6 +923,25 @@ public:
 	 * Make appropriate call into the format layer to parse individual read.
 	 */
 	virtual bool parse(Read& ra, Read& rb, TReadId rdid) = 0;
+
+	/**
+	 * Have the underlying sources remember where each batch begins.
+	 */
+	virtual void trackBatchStarts() = 0;
+
+	/**
+	 * Set 'pos' to a point in each input (mate 1 then, if paired, mate 2)
+	 * at or before read 'rdid' from which reading can restart.  Returns
+	 * false if there's no such point.
+	 */
+	virtual bool restartPoints(TReadId rdid, EList<InputPos>& pos) = 0;
+
+	/**
+	 * Resume reading at points returned by restartPoints() in an earlier
+	 * run.  Returns false, leaving all sources at the first read, if that
+	 * isn't possible.
+	 */
+	virtual bool seek(const EList<InputPos>& pos) = 0;
 	
 	/**
 	 * Given the values for all of the various arguments used to specify
@@ -833,6 +1021,10 @@ public:
 		return (*src_)[0]->parse(ra, rb, rdid);
 	}
 
+	virtual void trackBatchStarts();
+	virtual bool restartPoints(TReadId rdid, EList<InputPos>& pos);
+	virtual bool seek(const EList<InputPos>& pos);
+
 protected:
 	volatile size_t cur_; // current element in parallel srca_, srcb_ vectors
 	const EList<PatternSource*>* src_; /// PatternSources for paired-end reads
@@ -904,6 +1096,10 @@ public:
 		return (*srca_)[0]->parse(ra, rb, rdid);
 	}
 
+	virtual void trackBatchStarts();
+	virtual bool restartPoints(TReadId rdid, EList<InputPos>& pos);
+	virtual bool seek(const EList<InputPos>& pos);
+
 protected:
 	
 	volatile size_t cur_; // current element in parallel srca_, srcb_ vectors
@@ -942,6 +1138,15 @@ public:
 	
 	const Read& read_a() const { return buf_.read_a(); }
 	const Read& read_b() const { return buf_.read_b(); }
+
+	/**
+	 * Return the number of reads/pairs in the current batch still to be
+	 * handed out.
+	 */
+	size_t buffered() const {
+		size_t n = last_batch_size_ > 0 ? (size_t)last_batch_size_ : 0;
+		return buf_.cur_buf_ + 1 < n ? n - buf_.cur_buf_ - 1 : 0;
+	}
 	
 private:
 	
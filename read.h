@@ -60,6 +60,30 @@ struct Read {
 		parsed = false;
 		ns_ = 0;
 	}
+
+	/**
+	 * Exchange contents with another Read, swapping string buffers rather
+	 * than copying them.
+	 */
+	void swap(Read& o) {
+		patFw.swap(o.patFw);
+		patRc.swap(o.patRc);
+		qual.swap(o.qual);
+		patFwRev.swap(o.patFwRev);
+		patRcRev.swap(o.patRcRev);
+		qualRev.swap(o.qualRev);
+		readOrigBuf.swap(o.readOrigBuf);
+		name.swap(o.name);
+		std::swap(rdid, o.rdid);
+		std::swap(mate, o.mate);
+		std::swap(seed, o.seed);
+		std::swap(parsed, o.parsed);
+		std::swap(ns_, o.ns_);
+		std::swap(filter, o.filter);
+		std::swap(trimmed5, o.trimmed5);
+		std::swap(trimmed3, o.trimmed3);
+		std::swap(hitset, o.hitset);
+	}
 	
 	/**
 	 * Finish initializing a new read.
@@ -265,6 +289,13 @@ struct Read {
 	HitSet  *hitset;    // holds previously-found hits; for chaining
 };
 
+/**
+ * Relocate a Read within a reallocating EList by swapping.
+ */
+inline void relocate(Read& dst, Read& src) {
+	dst.swap(src);
+}
+
 /**
  * A string of FmStringOps represent a string of tasks performed by the
  * best-first alignment search.  We model the search as a series of FM ops
@@ -367,6 +398,16 @@ struct PerReadMetrics {
 		fmString.reset();
 	}
 
+	/**
+	 * Reset the counters that per-read effort limits are checked against,
+	 * so that the read gets a fresh budget when it's aligned to another
+	 * index.  Afterwards these counts describe only the later index.
+	 */
+	void resetLimits() {
+		nExIters = nExDps = nMateDps = nExUgs = nMateUgs = 0;
+		nDpFail = nUgFail = nEeFail = 0;
+	}
+
 	struct timeval  tv_beg; // timer start to measure how long alignment takes
 	struct timezone tz_beg; // timer start to measure how long alignment takes
 
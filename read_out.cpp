@@ -0,0 +1,486 @@
+/*
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of Bowtie 2.
+ *
+ * Bowtie 2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bowtie 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bowtie 2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include <algorithm>
+#include <iostream>
+#include "read_out.h"
+
+using namespace std;
+
+/**
+ * Return 'fn' quoted for the shell, so that no character in it, including
+ * a single quote, is interpreted by the shell.
+ */
+static string shellQuote(const string& fn) {
+	string ret = "'";
+	for(size_t i = 0; i < fn.length(); i++) {
+		if(fn[i] == '\'') {
+			ret += "'\\''";
+		} else {
+			ret += fn[i];
+		}
+	}
+	return ret + "'";
+}
+
+/**
+ * Open the file (or files, if fn2 is non-empty); print an error and throw
+ * 1 if that can't be done.
+ */
+ReadOutFile::ReadOutFile(
+	const string& fn1,
+	const string& fn2,
+	int comp,
+	size_t nthreads) :
+	nmates_(fn2.empty() ? 1 : 2),
+	nslots_(nthreads),
+	comp_(comp),
+	pipe_(comp == READ_OUT_BZ2 || comp == READ_OUT_LZ4),
+	err_(false),
+	bufs_(MISC_CAT),
+	zbufs_(MISC_CAT),
+	zlens_(MISC_CAT),
+	taken_(MISC_CAT),
+	held_(MISC_CAT),
+	order_(MISC_CAT),
+	nextTake_(0),
+	nextWrite_(0)
+{
+	assert_gt(nthreads, 0);
+	fn_[0] = fn1;
+	fn_[1] = fn2;
+	fh_[0] = fh_[1] = NULL;
+	for(size_t m = 0; m < nmates_; m++) {
+		if(pipe_) {
+			string cmd = (comp_ == READ_OUT_BZ2) ? "bzip2 -c > " : "lz4 -c > ";
+			cmd += shellQuote(fn_[m]);
+			fh_[m] = popen(cmd.c_str(), "w");
+		} else {
+			fh_[m] = fopen(fn_[m].c_str(), "wb");
+		}
+		if(fh_[m] == NULL) {
+			cerr << "Error: Could not open read output file " << fn_[m].c_str() << " for writing" << endl;
+			if(m == 1) {
+				if(pipe_) pclose(fh_[0]); else fclose(fh_[0]);
+				fh_[0] = NULL;
+			}
+			throw 1;
+		}
+	}
+	bufs_.resize(nslots_ * nmates_);
+	zbufs_.resize(nslots_ * nmates_);
+	zlens_.resize(nslots_ * nmates_);
+	for(size_t i = 0; i < bufs_.size(); i++) {
+		bufs_[i].clear();
+		zbufs_[i].clear();
+		zlens_[i] = 0;
+	}
+	taken_.resize(nslots_);
+	held_.resize(nslots_);
+	order_.resize(nslots_);
+	taken_.fill(false);
+	held_.fill(false);
+	order_.fill(0);
+}
+
+/**
+ * Compress 'buf' into a self-contained gzip member in 'zbuf', setting
+ * 'zlen' to its length.  Returns false if zlib fails.
+ */
+bool ReadOutFile::gzipChunk(BTString& buf, BTString& zbuf, size_t& zlen) {
+	z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+	if(deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+	                15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		return false;
+	}
+	size_t bound = (size_t)deflateBound(&zs, (uLong)buf.length());
+	zbuf.resize(bound);
+	zs.next_in = (Bytef*)buf.wbuf();
+	zs.avail_in = (uInt)buf.length();
+	zs.next_out = (Bytef*)zbuf.wbuf();
+	zs.avail_out = (uInt)bound;
+	int ret = deflate(&zs, Z_FINISH);
+	deflateEnd(&zs);
+	zlen = bound - zs.avail_out;
+	return ret == Z_STREAM_END;
+}
+
+/**
+ * Compress buffer 'slot' for gzip output; a no-op otherwise.
+ */
+void ReadOutFile::compress(size_t slot) {
+	if(comp_ != READ_OUT_GZ) {
+		return;
+	}
+	for(size_t m = 0; m < nmates_; m++) {
+		size_t i = slot * nmates_ + m;
+		zlens_[i] = 0;
+		if(!bufs_[i].empty() && !gzipChunk(bufs_[i], zbufs_[i], zlens_[i])) {
+			err_ = true;
+			zlens_[i] = 0;
+		}
+	}
+}
+
+/**
+ * Write out buffer 'slot' as compressed by compress().  Both mates' chunks
+ * are written under the same hold of the lock so the two files stay in
+ * step.  Caller holds the lock.
+ */
+void ReadOutFile::writeOut(size_t slot) {
+	for(size_t m = 0; m < nmates_; m++) {
+		size_t i = slot * nmates_ + m;
+		const char *out = bufs_[i].buf();
+		size_t outlen = bufs_[i].length();
+		if(comp_ == READ_OUT_GZ) {
+			out = zbufs_[i].buf();
+			outlen = zlens_[i];
+		}
+		if(outlen > 0 && fwrite(out, 1, outlen, fh_[m]) != outlen) {
+			err_ = true;
+		}
+		bufs_[i].clear();
+	}
+}
+
+/**
+ * Compress (if necessary) and write out buffer 'slot'.  Only the writes
+ * happen under the lock.
+ */
+void ReadOutFile::writeChunk(size_t slot) {
+	compress(slot);
+	ThreadSafe ts(mutex_m);
+	writeOut(slot);
+}
+
+/**
+ * Append the raw text of the next read in read-id order to the shared
+ * in-order buffer, handing the buffer to 'slot' as the next chunk if that
+ * fills it.
+ */
+void ReadOutFile::appendOrdered(
+	const Read::TBuf& rec1,
+	const Read::TBuf* rec2,
+	size_t slot)
+{
+	assert_lt(slot, nslots_);
+	assert_eq(nmates_ == 2, rec2 != NULL);
+	bool full = false;
+	for(size_t m = 0; m < nmates_; m++) {
+		const Read::TBuf& rec = (m == 0) ? rec1 : *rec2;
+		obufs_[m].append(rec.buf(), rec.length());
+		if(obufs_[m].length() >= CHUNK_SZ) {
+			full = true;
+		}
+	}
+	if(!full || taken_[slot]) {
+		return;
+	}
+	ThreadSafe ts(mutex_m);
+	if(held_[slot]) {
+		// This slot's last chunk is still waiting to be written; leave the
+		// buffer for the next thread to fill it
+		return;
+	}
+	for(size_t m = 0; m < nmates_; m++) {
+		assert(bufs_[slot * nmates_ + m].empty());
+		bufs_[slot * nmates_ + m].swap(obufs_[m]);
+	}
+	order_[slot] = nextTake_++;
+	taken_[slot] = true;
+}
+
+/**
+ * If appendOrdered() handed a chunk to 'slot', compress it without holding
+ * the lock, then write out, in order, every chunk that can now go.
+ */
+void ReadOutFile::writeTaken(size_t slot) {
+	assert_lt(slot, nslots_);
+	if(!taken_[slot]) {
+		return;
+	}
+	taken_[slot] = false;
+	compress(slot);
+	ThreadSafe ts(mutex_m);
+	held_[slot] = true;
+	bool wrote = true;
+	while(wrote) {
+		wrote = false;
+		for(size_t i = 0; i < nslots_; i++) {
+			if(held_[i] && order_[i] == nextWrite_) {
+				writeOut(i);
+				held_[i] = false;
+				nextWrite_++;
+				wrote = true;
+			}
+		}
+	}
+}
+
+/**
+ * Write out all buffers and close the file(s).  Must be called after all
+ * worker threads are done.  Returns false if an error was encountered at
+ * any point while writing.
+ */
+bool ReadOutFile::close() {
+	assert(fh_[0] != NULL);
+	assert_eq(nextTake_, nextWrite_);
+	for(size_t i = 0; i < nslots_; i++) {
+		writeChunk(i);
+	}
+	// In-order reads that never filled a chunk go last
+	for(size_t m = 0; m < nmates_; m++) {
+		bufs_[m].swap(obufs_[m]);
+	}
+	writeChunk(0);
+	for(size_t m = 0; m < nmates_; m++) {
+		int ret = pipe_ ? pclose(fh_[m]) : fclose(fh_[m]);
+		fh_[m] = NULL;
+		if(ret != 0) {
+			err_ = true;
+		}
+	}
+	if(err_) {
+		cerr << "Error: Could not write reads to " << fn_[0].c_str();
+		if(nmates_ == 2) {
+			cerr << " and " << fn_[1].c_str();
+		}
+		cerr << endl;
+	}
+	return !err_;
+}
+
+/**
+ * Given the argument to an --un or --al option, return the name of the
+ * file to write.  'dflt' is the file name used when 'fn' names a
+ * directory.
+ */
+string ReadOutFiles::unpairedName(const string& fn, const char *dflt) {
+	struct stat st;
+	if(stat(fn.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+		string ret = fn;
+		if(ret.empty() || ret[ret.length()-1] != '/') {
+			ret += '/';
+		}
+		return ret + dflt;
+	}
+	return fn;
+}
+
+/**
+ * Given the argument to an --un-conc or --al-conc option, set fn1 and fn2
+ * to the names of the mate-1 and mate-2 files.
+ */
+void ReadOutFiles::pairedNames(
+	const string& fn,
+	const char *dflt,
+	string& fn1,
+	string& fn2)
+{
+	string dir, base;
+	struct stat st;
+	if(stat(fn.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+		dir = fn;
+		if(dir.empty() || dir[dir.length()-1] != '/') {
+			dir += '/';
+		}
+		base = dflt;
+	} else {
+		size_t slash = fn.rfind('/');
+		if(slash != string::npos) {
+			dir = fn.substr(0, slash + 1);
+			base = fn.substr(slash + 1);
+		} else {
+			base = fn;
+		}
+	}
+	fn1 = fn2 = base;
+	if(base.find('%') != string::npos) {
+		for(size_t i = 0; i < base.length(); i++) {
+			if(base[i] == '%') {
+				fn1[i] = '1';
+				fn2[i] = '2';
+			}
+		}
+	} else {
+		size_t dot = base.rfind('.');
+		if(dot != string::npos) {
+			fn1.insert(dot, ".1");
+			fn2.insert(dot, ".2");
+		} else {
+			fn1 += ".1";
+			fn2 += ".2";
+		}
+	}
+	fn1 = dir + fn1;
+	fn2 = dir + fn2;
+}
+
+/**
+ * Open the file for unpaired reads that did (aligned = true) or did not
+ * (aligned = false) align.
+ */
+void ReadOutFiles::initUnpaired(bool aligned, const string& fn, int comp) {
+	ReadOutFile*& f = aligned ? al_ : un_;
+	assert(f == NULL);
+	f = new ReadOutFile(
+		unpairedName(fn, aligned ? "al-seqs" : "un-seqs"),
+		string(),
+		comp,
+		nthreads_);
+}
+
+/**
+ * Open the pair of files for pairs that did (aligned = true) or did not
+ * (aligned = false) align concordantly.
+ */
+void ReadOutFiles::initPaired(bool aligned, const string& fn, int comp) {
+	ReadOutFile*& f = aligned ? alConc_ : unConc_;
+	assert(f == NULL);
+	string fn1, fn2;
+	pairedNames(fn, aligned ? "al-conc-mate" : "un-conc-mate", fn1, fn2);
+	f = new ReadOutFile(fn1, fn2, comp, nthreads_);
+}
+
+/**
+ * Write read or pair 'rdid' to whichever file its outcome calls for.
+ */
+void ReadOutFiles::write(
+	const Read* rd1,
+	const Read* rd2,
+	bool aligned,
+	TReadId rdid,
+	size_t threadId)
+{
+	ReadOutFile *f = NULL;
+	const Read::TBuf *rec1 = NULL, *rec2 = NULL;
+	if(rd1 != NULL && rd2 != NULL) {
+		f = aligned ? alConc_ : unConc_;
+		rec1 = &rd1->readOrigBuf;
+		rec2 = &rd2->readOrigBuf;
+	} else {
+		const Read* rd = (rd1 != NULL) ? rd1 : rd2;
+		f = aligned ? al_ : un_;
+		if(rd != NULL) {
+			rec1 = &rd->readOrigBuf;
+		}
+	}
+	if(rec1 == NULL) {
+		f = NULL;
+	}
+	if(reorder_) {
+		{
+			ThreadSafe ts(mutex_m);
+			finish(rdid, f, rec1, rec2, threadId);
+		}
+		writeTaken(threadId);
+	} else if(f != NULL) {
+		f->append(*rec1, rec2, threadId);
+	}
+}
+
+/**
+ * Write out any chunks that finish() handed to slot 'threadId'.
+ */
+void ReadOutFiles::writeTaken(size_t threadId) {
+	ReadOutFile *fs[4] = { un_, al_, unConc_, alConc_ };
+	for(int i = 0; i < 4; i++) {
+		if(fs[i] != NULL) {
+			fs[i]->writeTaken(threadId);
+		}
+	}
+}
+
+/**
+ * Record that read 'rdid' finished and goes to 'f' (or nowhere), then pass
+ * every finished read at the head of the queue to its file.  pending_ is
+ * used as a ring starting at head_, so reads are never shifted; it only
+ * grows when more reads are in flight than it has room for.  Caller holds
+ * the lock.
+ */
+void ReadOutFiles::finish(
+	TReadId rdid,
+	ReadOutFile *f,
+	const Read::TBuf *rec1,
+	const Read::TBuf *rec2,
+	size_t threadId)
+{
+	assert(reorder_);
+	assert_geq(rdid, cur_);
+	size_t i = (size_t)(rdid - cur_);
+	if(i >= pending_.size()) {
+		size_t cap = std::max<size_t>(pending_.size() * 2, 64);
+		while(cap <= i) {
+			cap *= 2;
+		}
+		EList<ReadOutPending> ring(MISC_CAT);
+		ring.resize(cap);
+		for(size_t j = 0; j < cap; j++) {
+			ring[j].reset();
+		}
+		for(size_t j = 0; j < npend_; j++) {
+			relocate(ring[j], pending_[(head_ + j) % pending_.size()]);
+		}
+		relocate(pending_, ring);
+		head_ = 0;
+	}
+	if(i >= npend_) {
+		npend_ = i + 1;
+	}
+	ReadOutPending& p = pending_[(head_ + i) % pending_.size()];
+	assert(!p.done);
+	p.done = true;
+	p.file = f;
+	if(f != NULL) {
+		p.rec1.install(rec1->buf(), rec1->length());
+		if(rec2 != NULL) {
+			p.rec2.install(rec2->buf(), rec2->length());
+		}
+	}
+	while(npend_ > 0 && pending_[head_].done) {
+		ReadOutPending& q = pending_[head_];
+		if(q.file != NULL) {
+			q.file->appendOrdered(q.rec1, q.file->paired() ? &q.rec2 : NULL, threadId);
+		}
+		q.reset();
+		head_ = (head_ + 1) % pending_.size();
+		npend_--;
+		cur_++;
+	}
+}
+
+/**
+ * Flush and close all files.  Returns false if any write failed.
+ */
+bool ReadOutFiles::close() {
+	assert_eq(0, npend_);
+	bool ok = true;
+	ReadOutFile *fs[4] = { un_, al_, unConc_, alConc_ };
+	for(int i = 0; i < 4; i++) {
+		if(fs[i] != NULL && !fs[i]->close()) {
+			ok = false;
+		}
+	}
+	return ok;
+}
@@ -0,0 +1,357 @@
+/*
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of Bowtie 2.
+ *
+ * Bowtie 2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bowtie 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bowtie 2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * read_out.h
+ *
+ * Writers for the --un, --al, --un-conc and --al-conc outputs.  Each read
+ * is written exactly as it appeared in the input, using the raw text kept
+ * in Read::readOrigBuf.
+ *
+ * Every worker thread appends records to its own buffer.  When a buffer
+ * fills, the thread that filled it compresses it (for gzip output) and
+ * then appends the result to the file while holding the file's lock.
+ * Because a gzip file may consist of several concatenated gzip members,
+ * the independently compressed chunks together form a valid .gz file, and
+ * compression proceeds in parallel across threads.  bzip2 and lz4 output
+ * is piped through the external "bzip2" or "lz4" program.
+ *
+ * The two files of an --un-conc or --al-conc pair are handled by one
+ * ReadOutFile: each thread buffers both mates of a pair together and the
+ * two buffers are written out together under one lock, so the Nth record
+ * of the mate-1 file is always the mate of the Nth record of the mate-2
+ * file.
+ *
+ * With --reorder, records are instead released in read-id order, the same
+ * order as the SAM output, into one shared buffer per file.  When it fills,
+ * the thread that filled it takes it as the file's next chunk and
+ * compresses it in its own slot without holding any lock.  Chunks are
+ * numbered as they are taken and written strictly in that order: a chunk
+ * that is ready before the ones ahead of it is held in its slot and
+ * written by the thread that writes the last of those.
+ */
+
+#ifndef READ_OUT_H_
+#define READ_OUT_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include "ds.h"
+#include "sstring.h"
+#include "read.h"
+#include "threading.h"
+#include "mem_ids.h"
+
+enum {
+	READ_OUT_PLAIN = 0, // uncompressed
+	READ_OUT_GZ,        // gzip, compressed in-process
+	READ_OUT_BZ2,       // bzip2, via external "bzip2 -c"
+	READ_OUT_LZ4        // lz4, via external "lz4 -c"
+};
+
+/**
+ * An output file, or the pair of mate-1 and mate-2 files, receiving raw
+ * reads from many threads.
+ */
+class ReadOutFile {
+
+public:
+
+	// Per-thread buffers are written out when they grow past this size
+	static const size_t CHUNK_SZ = 256 * 1024;
+
+	/**
+	 * Open the file (or files, if fn2 is non-empty); print an error and
+	 * throw 1 if that can't be done.  'nthreads' is the number of
+	 * per-thread buffers to keep.
+	 */
+	ReadOutFile(
+		const std::string& fn1,
+		const std::string& fn2,
+		int comp,
+		size_t nthreads);
+
+	/**
+	 * Close the file(s) if close() wasn't called already.
+	 */
+	~ReadOutFile() {
+		if(fh_[0] != NULL) {
+			close();
+		}
+	}
+
+	/**
+	 * Append the raw text for one read, or for both mates of a pair, to
+	 * buffer 'slot', writing the buffer out if it's full.  The caller must
+	 * be the only one using 'slot'.
+	 */
+	void append(
+		const Read::TBuf& rec1,
+		const Read::TBuf* rec2,
+		size_t slot)
+	{
+		assert_lt(slot, nslots_);
+		assert_eq(nmates_ == 2, rec2 != NULL);
+		if(rec1.empty() && (rec2 == NULL || rec2->empty())) {
+			return;
+		}
+		bool full = false;
+		for(size_t m = 0; m < nmates_; m++) {
+			const Read::TBuf& rec = (m == 0) ? rec1 : *rec2;
+			BTString& buf = bufs_[slot * nmates_ + m];
+			buf.append(rec.buf(), rec.length());
+			if(buf.length() >= CHUNK_SZ) {
+				full = true;
+			}
+		}
+		if(full) {
+			writeChunk(slot);
+		}
+	}
+
+	/**
+	 * Append the raw text of the next read in read-id order to the shared
+	 * in-order buffer.  If that fills it, hand it to 'slot' as the file's
+	 * next chunk; the caller then calls writeTaken() once it has released
+	 * the lock that serializes calls to appendOrdered().
+	 */
+	void appendOrdered(
+		const Read::TBuf& rec1,
+		const Read::TBuf* rec2,
+		size_t slot);
+
+	/**
+	 * If appendOrdered() handed a chunk to 'slot', compress it and write
+	 * it out after all chunks handed out before it.  Only the thread using
+	 * 'slot' may call this.
+	 */
+	void writeTaken(size_t slot);
+
+	/**
+	 * Write out all buffers and close the file(s).  Must be called after
+	 * all worker threads are done.  Returns false if an error was
+	 * encountered at any point while writing.
+	 */
+	bool close();
+
+	/**
+	 * Return true iff this is a pair of mate files.
+	 */
+	bool paired() const { return nmates_ == 2; }
+
+protected:
+
+	/**
+	 * Compress (if necessary) and write out buffer 'slot'.
+	 */
+	void writeChunk(size_t slot);
+
+	/**
+	 * Compress buffer 'slot' for gzip output; a no-op otherwise.
+	 */
+	void compress(size_t slot);
+
+	/**
+	 * Write out buffer 'slot' as compressed by compress().  Caller holds
+	 * the lock.
+	 */
+	void writeOut(size_t slot);
+
+	/**
+	 * Compress 'buf' into a self-contained gzip member in 'zbuf'.  Returns
+	 * false if zlib fails.
+	 */
+	static bool gzipChunk(BTString& buf, BTString& zbuf, size_t& zlen);
+
+	std::string     fn_[2];  // file names, mate 1 and (if paired) mate 2
+	FILE           *fh_[2];  // files or pipes
+	size_t          nmates_; // 1, or 2 for a pair of mate files
+	size_t          nslots_; // # buffers per mate
+	int             comp_;   // READ_OUT_* compression type
+	bool            pipe_;   // true -> fh_ were opened with popen()
+	bool            err_;    // true -> a write failed
+	EList<BTString> bufs_;   // raw reads, nmates_ buffers per slot
+	EList<BTString> zbufs_;  // compressed data, likewise
+	EList<size_t>   zlens_;  // lengths of compressed data, likewise
+	BTString        obufs_[2]; // in-order reads not yet handed to a slot
+	EList<bool>     taken_;  // slot holds a chunk; only its thread uses this
+	EList<bool>     held_;   // slot's chunk waits on earlier ones
+	EList<uint64_t> order_;  // number of the chunk in each slot
+	uint64_t        nextTake_;  // number of the next chunk handed out
+	uint64_t        nextWrite_; // number of the next chunk to write
+	MUTEX_T         mutex_m; // guards the file(s), held_ and nextWrite_
+};
+
+/**
+ * A read whose raw text is waiting for the reads before it to finish, when
+ * output is reordered.
+ */
+struct ReadOutPending {
+
+	void reset() {
+		done = false;
+		file = NULL;
+		rec1.clear();
+		rec2.clear();
+	}
+
+	bool         done; // read has finished
+	ReadOutFile *file; // file to write it to, or NULL for none
+	Read::TBuf   rec1; // raw text of read or mate 1
+	Read::TBuf   rec2; // raw text of mate 2
+};
+
+/**
+ * Move a pending read when the queue grows by handing its buffers over.
+ */
+inline void relocate(ReadOutPending& dst, ReadOutPending& src) {
+	dst.done = src.done;
+	dst.file = src.file;
+	dst.rec1.swap(src.rec1);
+	dst.rec2.swap(src.rec2);
+}
+
+/**
+ * The set of --un/--al/--un-conc/--al-conc files requested by the user.
+ */
+class ReadOutFiles {
+
+public:
+
+	/**
+	 * 'nthreads' is the most worker threads that will ever write.  If
+	 * 'reorder' is true, records are written in read-id order starting
+	 * at 'firstRdid'.
+	 */
+	ReadOutFiles(size_t nthreads, bool reorder, TReadId firstRdid) :
+		nthreads_(nthreads),
+		reorder_(reorder),
+		cur_(firstRdid),
+		pending_(MISC_CAT),
+		head_(0),
+		npend_(0),
+		un_(NULL),
+		al_(NULL),
+		unConc_(NULL),
+		alConc_(NULL)
+	{ }
+
+	~ReadOutFiles() {
+		delete un_;
+		delete al_;
+		delete unConc_;
+		delete alConc_;
+	}
+
+	/**
+	 * Open the file for unpaired reads that did (aligned = true) or did not
+	 * (aligned = false) align.
+	 */
+	void initUnpaired(bool aligned, const std::string& fn, int comp);
+
+	/**
+	 * Open the pair of files for pairs that did (aligned = true) or did not
+	 * (aligned = false) align concordantly.
+	 */
+	void initPaired(bool aligned, const std::string& fn, int comp);
+
+	/**
+	 * Write read or pair 'rdid' to whichever file its outcome calls for.
+	 * For an unpaired read, 'aligned' is true iff it aligned at least once;
+	 * for a pair, iff it aligned concordantly at least once.
+	 */
+	void write(
+		const Read* rd1,
+		const Read* rd2,
+		bool aligned,
+		TReadId rdid,
+		size_t threadId);
+
+	/**
+	 * Read 'rdid' won't be written anywhere.  Only matters when
+	 * reordering, where it may release reads queued behind it.
+	 */
+	void skip(TReadId rdid, size_t threadId) {
+		if(reorder_) {
+			{
+				ThreadSafe ts(mutex_m);
+				finish(rdid, NULL, NULL, NULL, threadId);
+			}
+			writeTaken(threadId);
+		}
+	}
+
+	/**
+	 * Flush and close all files.  Returns false if any write failed.
+	 */
+	bool close();
+
+	/**
+	 * Given the argument to an --un or --al option, return the name of the
+	 * file to write.  'dflt' is the file name used when 'fn' names a
+	 * directory.
+	 */
+	static std::string unpairedName(const std::string& fn, const char *dflt);
+
+	/**
+	 * Given the argument to an --un-conc or --al-conc option, set fn1 and
+	 * fn2 to the names of the mate-1 and mate-2 files.  If 'fn' contains a
+	 * '%', it is replaced with 1 or 2; otherwise .1 or .2 is inserted
+	 * before the final extension, or appended if there is none.
+	 */
+	static void pairedNames(
+		const std::string& fn,
+		const char *dflt,
+		std::string& fn1,
+		std::string& fn2);
+
+protected:
+
+	/**
+	 * Record that read 'rdid' finished and goes to 'f' (or nowhere), then
+	 * pass every finished read at the head of the queue to its file.
+	 * Caller holds the lock.
+	 */
+	void finish(
+		TReadId rdid,
+		ReadOutFile *f,
+		const Read::TBuf *rec1,
+		const Read::TBuf *rec2,
+		size_t threadId);
+
+	/**
+	 * Write out any chunks that finish() handed to slot 'threadId'.
+	 */
+	void writeTaken(size_t threadId);
+
+	size_t       nthreads_;
+	bool         reorder_;   // write in read-id order
+	TReadId      cur_;       // id of the read at the head of pending_
+	EList<ReadOutPending> pending_; // ring of reads waiting to be written
+	size_t       head_;      // index in pending_ of read cur_
+	size_t       npend_;     // # entries of pending_ in use, from head_
+	MUTEX_T      mutex_m;    // guards cur_ and pending_
+	ReadOutFile *un_;        // --un
+	ReadOutFile *al_;        // --al
+	ReadOutFile *unConc_;    // --un-conc, mate 1 and mate 2
+	ReadOutFile *alConc_;    // --al-conc, mate 1 and mate 2
+};
+
+#endif /*ndef READ_OUT_H_*/
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of Bowtie 2.
+ *
+ * Bowtie 2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bowtie 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bowtie 2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include "ref_repeats.h"
+#include "word_io.h"
+#include "endian_swap.h"
+
+using namespace std;
+
+/**
+ * Write a table to the given stream.  'kmers' must be sorted and parallel
+ * to 'counts'.
+ */
+void RepeatKmers::write(
+	ostream& out,
+	int k,
+	uint64_t minCount,
+	const EList<uint64_t>& kmers,
+	const EList<uint64_t>& counts,
+	bool toBigEndian)
+{
+	assert_eq(kmers.size(), counts.size());
+	writeU<uint32_t>(out, 1, toBigEndian); // endianness hint
+	writeI<int32_t>(out, k, toBigEndian);
+	writeU<uint64_t>(out, minCount, toBigEndian);
+	writeU<uint64_t>(out, (uint64_t)kmers.size(), toBigEndian);
+	for(size_t i = 0; i < kmers.size(); i++) {
+		assert(i == 0 || kmers[i-1] < kmers[i]);
+		writeU<uint64_t>(out, kmers[i], toBigEndian);
+		writeU<uint64_t>(out, counts[i], toBigEndian);
+	}
+}
+
+/**
+ * Load a table from the given file, keeping only k-mers that occur at
+ * least minCount times.  Return false if the file could not be opened or
+ * is malformed.
+ */
+bool RepeatKmers::load(const string& fname, uint64_t minCount, bool verbose) {
+	kmers_.clear();
+	counts_.clear();
+	k_ = 0;
+	minCount_ = 0;
+	FILE *f = fopen(fname.c_str(), "rb");
+	if(f == NULL) {
+		return false;
+	}
+	bool swap = false;
+	uint32_t one = 0;
+	if(fread(&one, 4, 1, f) != 1) {
+		fclose(f);
+		return false;
+	}
+	if(one != 1) {
+		if(endianSwapU32(one) != 1) {
+			cerr << "Error: " << fname.c_str() << " is not a repeat k-mer table" << endl;
+			fclose(f);
+			return false;
+		}
+		swap = true;
+	}
+	int32_t k = readI<int32_t>(f, swap);
+	uint64_t fileMin = readU<uint64_t>(f, swap);
+	uint64_t n = readU<uint64_t>(f, swap);
+	if(k < 1 || k > 32) {
+		cerr << "Error: bad k-mer length " << k << " in " << fname.c_str() << endl;
+		fclose(f);
+		return false;
+	}
+	k_ = k;
+	minCount_ = max<uint64_t>(minCount, fileMin);
+	for(uint64_t i = 0; i < n; i++) {
+		uint64_t kmer = readU<uint64_t>(f, swap);
+		uint64_t cnt = readU<uint64_t>(f, swap);
+		if(feof(f) || ferror(f)) {
+			cerr << "Error: " << fname.c_str() << " is truncated" << endl;
+			kmers_.clear();
+			counts_.clear();
+			k_ = 0;
+			fclose(f);
+			return false;
+		}
+		if(cnt >= minCount_) {
+			kmers_.push_back(kmer);
+			counts_.push_back(cnt);
+		}
+	}
+	fclose(f);
+	if(verbose) {
+		cerr << "Loaded " << kmers_.size() << " repeat " << k_ << "-mers "
+		     << "occurring at least " << minCount_ << " times" << endl;
+	}
+	return true;
+}
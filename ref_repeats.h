@@ -0,0 +1,240 @@
+/*
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of Bowtie 2.
+ *
+ * Bowtie 2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bowtie 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bowtie 2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * ref_repeats.h
+ *
+ * Table of k-mers that are over-represented in the reference.  The table
+ * is computed by bowtie2-build while it streams the suffix array (suffixes
+ * sharing a k-character prefix are adjacent there) and written to the
+ * .rep.bt2 file.  The aligner consults it to skip seeds that fall entirely
+ * within highly repetitive sequence before searching for them.
+ *
+ * File layout (all words in the index's endianness):
+ *
+ *   uint32_t  1 (endianness hint)
+ *   int32_t   k
+ *   uint64_t  minimum count of k-mers stored
+ *   uint64_t  number of k-mers stored (n)
+ *   n x { uint64_t 2-bit packed k-mer, uint64_t count }, sorted by k-mer
+ *
+ * K-mers are packed with the leftmost character in the most significant
+ * bit pair, as with ftab entries.
+ */
+
+#ifndef REF_REPEATS_H_
+#define REF_REPEATS_H_
+
+#include <stdint.h>
+#include <iostream>
+#include <string>
+#include "ds.h"
+#include "sstring.h"
+#include "mem_ids.h"
+#include "btypes.h"
+
+/**
+ * 2-bit packed copy of the joined reference that bowtie2-build uses to
+ * read the k-mer at any text offset in constant time while it streams the
+ * suffix array.  Consecutive suffixes in SA order don't overlap in the
+ * text, so their k-mers can't be rolled from one another; instead the text
+ * is packed once, fragment by fragment, and each k-mer is read back with
+ * at most two word loads.  Windows that run past the end of a fragment
+ * (into a stretch of Ns or the next sequence) are marked and not counted.
+ */
+class RepeatKmerText {
+
+public:
+
+	RepeatKmerText() :
+		k_(0),
+		words_(MISC_CAT),
+		ok_(MISC_CAT) { }
+
+	/**
+	 * Pack the joined string 's', made of fragments of the given lengths
+	 * laid end to end, for reading k-mers of length k.
+	 */
+	template<typename TStr>
+	void init(const TStr& s, const EList<TIndexOffU>& fragLens, int k) {
+		assert_gt(k, 0);
+		assert_leq(k, 32);
+		k_ = k;
+		size_t len = s.length();
+		// One word of padding so a k-mer can always read the next word
+		words_.resize((len >> 5) + 2);
+		words_.fillZero();
+		ok_.resize((len >> 6) + 1);
+		ok_.fillZero();
+		TIndexOffU off = 0;
+		for(size_t f = 0; f < fragLens.size(); f++) {
+			TIndexOffU flen = fragLens[f];
+			for(TIndexOffU i = off; i < off + flen; i++) {
+				int c = (int)s[i];
+				assert_range(0, 3, c);
+				words_[i >> 5] |= (uint64_t)c << (62 - ((i & 31) << 1));
+				if(off + flen - i >= (TIndexOffU)k) {
+					ok_[i >> 6] |= (uint64_t)1 << (i & 63);
+				}
+			}
+			off += flen;
+		}
+		assert_eq((size_t)off, len);
+	}
+
+	/**
+	 * Set 'kmer' to the k-mer starting at text offset 'off' and return
+	 * true, or return false if it runs past the end of its fragment.
+	 */
+	bool get(TIndexOffU off, uint64_t& kmer) const {
+		if(((ok_[off >> 6] >> (off & 63)) & 1) == 0) {
+			return false;
+		}
+		size_t w = off >> 5;
+		int b = (int)(off & 31) << 1;
+		uint64_t bits = words_[w] << b;
+		if(b > 0) {
+			bits |= words_[w + 1] >> (64 - b);
+		}
+		kmer = bits >> (64 - 2 * k_);
+		return true;
+	}
+
+	/**
+	 * Return the k-mer length, or 0 if not initialized.
+	 */
+	int k() const { return k_; }
+
+protected:
+
+	int             k_;     // k-mer length
+	EList<uint64_t> words_; // text, 32 characters per word, first in MSBs
+	EList<uint64_t> ok_;    // bit i set iff the k-mer at i is in one fragment
+};
+
+class RepeatKmers {
+
+public:
+
+	RepeatKmers() :
+		k_(0),
+		minCount_(0),
+		kmers_(MISC_CAT),
+		counts_(MISC_CAT) { }
+
+	/**
+	 * Write a table to the given stream.  'kmers' must be sorted and
+	 * parallel to 'counts'.
+	 */
+	static void write(
+		std::ostream& out,
+		int k,
+		uint64_t minCount,
+		const EList<uint64_t>& kmers,
+		const EList<uint64_t>& counts,
+		bool toBigEndian);
+
+	/**
+	 * Load a table from the given file, keeping only k-mers that occur
+	 * at least minCount times.  Return false if the file could not be
+	 * opened or is malformed.
+	 */
+	bool load(const std::string& fname, uint64_t minCount, bool verbose);
+
+	/**
+	 * Return the number of times the given packed k-mer occurs in the
+	 * reference, or 0 if it occurs fewer than minCount() times.
+	 */
+	uint64_t count(uint64_t kmer) const {
+		size_t lo = 0, hi = kmers_.size();
+		while(lo < hi) {
+			size_t mid = lo + ((hi - lo) >> 1);
+			if(kmers_[mid] < kmer) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		if(lo < kmers_.size() && kmers_[lo] == kmer) {
+			return counts_[lo];
+		}
+		return 0;
+	}
+
+	/**
+	 * Return an upper bound on the number of times the given sequence
+	 * occurs in the reference if every one of its k-mers is in the
+	 * table, or 0 if any k-mer is absent, contains an N, or the
+	 * sequence is shorter than k.
+	 */
+	uint64_t seqCount(const BTDnaString& seq) const {
+		if(kmers_.empty() || seq.length() < (size_t)k_) {
+			return 0;
+		}
+		const uint64_t mask = (k_ == 32) ?
+			~(uint64_t)0 : (((uint64_t)1 << (2 * k_)) - 1);
+		uint64_t kmer = 0, best = 0;
+		for(size_t i = 0; i < seq.length(); i++) {
+			int c = seq[i];
+			if(c > 3) {
+				return 0;
+			}
+			kmer = ((kmer << 2) | (uint64_t)c) & mask;
+			if(i + 1 >= (size_t)k_) {
+				uint64_t cnt = count(kmer);
+				if(cnt == 0) {
+					return 0;
+				}
+				if(best == 0 || cnt < best) {
+					best = cnt;
+				}
+			}
+		}
+		return best;
+	}
+
+	/**
+	 * Return the k-mer length, or 0 if no table is loaded.
+	 */
+	int k() const { return k_; }
+
+	/**
+	 * Return the count threshold in effect.
+	 */
+	uint64_t minCount() const { return minCount_; }
+
+	/**
+	 * Return the number of k-mers in the table.
+	 */
+	size_t size() const { return kmers_.size(); }
+
+	/**
+	 * Return true iff no k-mers are loaded.
+	 */
+	bool empty() const { return kmers_.empty(); }
+
+protected:
+
+	int              k_;        // k-mer length
+	uint64_t         minCount_; // k-mers occurring fewer times are omitted
+	EList<uint64_t>  kmers_;    // sorted, packed k-mers
+	EList<uint64_t>  counts_;   // # occurrences, parallel to kmers_
+};
+
+#endif /*ndef REF_REPEATS_H_*/
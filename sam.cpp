@@ -308,6 +308,17 @@ void SamConfig::printAlignedOptFlags(
 		WRITE_SEP();
 		flags.printYT(o);
 	}
+	if(idxStarts_ != NULL) {
+		// XI:i: Index the read aligned to
+		size_t xi = 0;
+		while(xi + 1 < idxStarts_->size() && (*idxStarts_)[xi + 1] <= (size_t)res.refid()) {
+			xi++;
+		}
+		itoa10<size_t>(xi, buf);
+		WRITE_SEP();
+		o.append("XI:i:");
+		o.append(buf);
+	}
 	if(print_yp_ && flags.partOfPair() && flags.canMax()) {
 		// YP:i: Read was repetitive when aligned paired?
 		WRITE_SEP();
@@ -149,7 +149,8 @@ public:
 		print_zi_(print_zi), // # seed extend loop iters
 		print_zp_(print_zp), // # seed extend loop iters
 		print_zu_(print_zu), // # seed extend loop iters
-		print_zt_(print_zt)  // extra features for MAPQ estimation
+		print_zt_(print_zt), // extra features for MAPQ estimation
+		idxStarts_(NULL)
 	{
 		assert_eq(refnames_.size(), reflens_.size());
 	}
@@ -321,6 +322,15 @@ public:
 		return noUnal_;
 	}
 
+	/**
+	 * When aligning to several indexes, give the id of the first reference
+	 * of each index, in order.  Aligned records are then tagged with XI:i:,
+	 * the 0-based number of the index they aligned to.
+	 */
+	void setIndexStarts(const LenList* starts) {
+		idxStarts_ = starts;
+	}
+
 protected:
 
 	bool truncQname_;   // truncate QNAME to 255 chars?
@@ -379,6 +389,8 @@ protected:
 	bool print_zp_; // ZP:i: Score of best/second-best paired-end alignment
 	bool print_zu_; // ZU:i: Score of best/second-best unpaired alignment
 	bool print_zt_; // ZT:Z: Extra features for MAPQ estimation
+
+	const LenList* idxStarts_; // first ref id of each index, or NULL
 };
 
 #endif /* SAM_H_ */
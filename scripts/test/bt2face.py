@@ -12,6 +12,7 @@ class BowtieSuite(object):
         self.bowtie_bin     = os.path.join(curr_path,'bowtie2')
         self.bowtie_build   = os.path.join(curr_path,'bowtie2-build')
         self.bowtie_inspect = os.path.join(curr_path,'bowtie2-inspect')
+        self.bowtie_merge   = os.path.join(curr_path,'bowtie2-merge-shards')
         logging.info('bowtie2 path: ' + self.bowtie_bin)
         logging.info('bowtie2-build path: ' + self.bowtie_build)
         logging.info('bowtie2-inspect path: ' + self.bowtie_inspect)
@@ -29,6 +30,12 @@ class BowtieSuite(object):
         return(subprocess.call(cmd,shell=True,stderr=open(os.devnull, 'w')))
 
 
+    def merge_shards(self, *args):
+        cmd = self.bowtie_merge + " " + " ".join([i for i in args])
+        logging.debug('merge cmd: ' + cmd)
+        return(subprocess.call(cmd,shell=True))
+
+
     def build(self, *args):
         cmd = self.bowtie_build + " " + " ".join([i for i in args])
         curr_dir = os.getcwd()
@@ -37,3 +44,9 @@ class BowtieSuite(object):
         ret = subprocess.check_call(cmd,shell=True)
         os.chdir(curr_dir)
         return(ret)
+
+
+    def inspect(self, *args):
+        cmd = self.bowtie_inspect + " " + " ".join([i for i in args])
+        logging.debug('inspect cmd: ' + cmd)
+        return(subprocess.check_output(cmd,shell=True).decode())
@@ -5,6 +5,7 @@ import inspect
 import unittest
 import logging
 import shutil
+import struct
 import bt2face
 import dataface
 import btdata
@@ -162,7 +163,795 @@ class TestRegressions(unittest.TestCase):
         )
         shutil.rmtree(no_dot_dir)
         shutil.rmtree(dot_dir)
+
+
+    def test_minimizers(self):
+        """ Check that minimizer seeding searches fewer seeds than the
+            default, that --seed-cap drops the seeds of a repeat and not
+            those of unique sequence, and that every read still gets a
+            record.
+        """
+        import random
+        ref_fasta = os.path.join(g_bdata.ref_dir_path,'lambda_virus.fa')
+        seq = "".join([l.strip() for l in open(ref_fasta) if l[0] != '>'])
+        rnd = random.Random(76)
+        # Unique lambda sequence followed by 20 copies of a 200 bp segment
+        # of random sequence, each between random spacers
+        unit = "".join([rnd.choice('ACGT') for i in range(200)])
+        parts = [seq[:20000]]
+        spacers = []
+        for i in range(20):
+            spacers.append("".join([rnd.choice('ACGT') for k in range(300)]))
+            parts += [spacers[-1], unit]
+        fasta = os.path.join(os.getcwd(),'test_minimizers.fa')
+        index = os.path.join(os.getcwd(),'test_minimizers')
+        fh = open(fasta, 'w')
+        fh.write(">ref\n%s\n" % "".join(parts))
+        fh.close()
+        self.assertEqual(g_bt.build("--quiet %s %s" % (fasta,index)), 0)
+        reads = 'test_minimizers.fq'
+        out_sam = 'test_minimizers.sam'
+        met_file = 'test_minimizers.met'
+
+        def metrics(kind, opts):
+            """ Align reads drawn from unique lambda sequence, or from the
+                junction of a spacer and the repeat that follows it, and
+                return the run's total metrics. """
+            r = random.Random(kind)
+            fh = open(reads, 'w')
+            for i in range(200):
+                if kind == 'junction':
+                    # 40 bp of unique spacer, 60 bp of repeat
+                    rd = r.choice(spacers)[-40:] + unit[:60]
+                else:
+                    off = r.randint(0, 20000 - 100)
+                    rd = seq[off:off+100]
+                fh.write("@r%d\n%s\n+\n%s\n" % (i, rd, 'I' * 100))
+            fh.close()
+            args = "-x %s -U %s %s --met-file %s -S %s" % (index,reads,opts,met_file,out_sam)
+            self.assertEqual(g_bt.silent_run(args), 0)
+            self.assertEqual(dataface.SamFile(out_sam).size(), 200)
+            lines = [l.rstrip('\t\n').split('\t') for l in open(met_file)]
+            return dict(zip(lines[0], [int(v) for v in lines[-1]]))
+
+        for kind in ['junction', 'unique']:
+            dflt = metrics(kind, "")
+            mini = metrics(kind, "--minimizers")
+            capped = metrics(kind, "--seed-cap 5")
+            self.assertTrue(0 < mini['SeedSearch'] < dflt['SeedSearch'])
+            self.assertEqual(dflt['CappedSeed'], 0)
+            if kind == 'junction':
+                # The repeat's seeds hit 20 copies and are dropped in favour
+                # of the spacer's
+                self.assertTrue(capped['CappedSeed'] > 0)
+                self.assertTrue(capped['NElt'] < dflt['NElt'])
+            else:
+                self.assertEqual(capped['CappedSeed'], 0)
+                self.assertEqual(capped['NElt'], dflt['NElt'])
+        for f in os.listdir(os.getcwd()):
+            if f.startswith('test_minimizers.'):
+                os.remove(f)
+
+
+    def test_rep_mask(self):
+        """ Check that bowtie2-build --rep-k writes a repeat k-mer table and
+            that --rep-mask uses it, and that --rep-mask fails without one.
+        """
+        ref_index = os.path.join(g_bdata.index_dir_path,'lambda_virus')
+        ref_fasta = os.path.join(g_bdata.ref_dir_path,'lambda_virus.fa')
+        reads     = os.path.join(g_bdata.reads_dir_path,'reads_1.fq')
+        rep_index = os.path.join(os.getcwd(),'test_rep_mask')
+        out_sam   = 'test_rep_mask.sam'
+        no_reads  = dataface.FastaQFile(reads).size()
+        ret = g_bt.build("--quiet --rep-k 8 --rep-min 2 %s %s" % (ref_fasta,rep_index))
+        self.assertEqual(ret, 0)
+        self.assertTrue(os.path.getsize(rep_index + '.rep.bt2') > 0)
+        args = "--quiet -x %s -U %s --rep-mask 3 -S %s" % (rep_index,reads,out_sam)
+        ret = g_bt.run(args)
+        self.assertEqual(ret, 0)
+        self.assertEqual(dataface.SamFile(out_sam).size(), no_reads)
+        args = "--quiet -x %s -U %s --rep-mask 3 -S %s" % (ref_index,reads,out_sam)
+        ret = g_bt.silent_run(args)
+        self.assertNotEqual(ret, 0)
+        # The table counts exactly the k-mers lying within one stretch of
+        # non-N sequence; none spans a run of Ns or two sequences
+        seq = "".join([l.strip() for l in open(ref_fasta) if l[0] != '>'])
+        frags = [seq[:3000], seq[1000:2500], seq[2500:5000], seq[:400]]
+        rep_fasta = os.path.join(os.getcwd(),'test_rep_mask.fa')
+        fh = open(rep_fasta, 'w')
+        fh.write(">a\n%s\n>b\n%sNNNN%s\n>c\n%s\n" % tuple(frags))
+        fh.close()
+        ret = g_bt.build("--quiet --rep-k 12 --rep-min 2 %s %s" % (rep_fasta,rep_index))
+        self.assertEqual(ret, 0)
+        counts = {}
+        for frag in frags:
+            for i in range(len(frag) - 11):
+                kmer = 0
+                for c in frag[i:i+12]:
+                    kmer = kmer * 4 + "ACGT".index(c)
+                counts[kmer] = counts.get(kmer, 0) + 1
+        expected = dict([(km, n) for km, n in counts.items() if n >= 2])
+        data = open(rep_index + '.rep.bt2', 'rb').read()
+        hint, k, min_count, nkmers = struct.unpack('<IiQQ', data[:24])
+        self.assertEqual((hint, k, min_count), (1, 12, 2))
+        table = dict([struct.unpack('<QQ', data[24+16*i:40+16*i]) for i in range(nkmers)])
+        self.assertEqual(table, expected)
+        os.remove(out_sam)
+        for f in os.listdir(os.getcwd()):
+            if f.startswith('test_rep_mask.'):
+                os.remove(f)
+
+
+    def test_inspect_stats(self):
+        """ Check bowtie2-inspect --stats: the measured walk-left cost
+            matches the SA sample rate and the recommendation fits the
+            memory budget.
+        """
+        ref_fasta = os.path.join(g_bdata.ref_dir_path,'lambda_virus.fa')
+        reads     = os.path.join(g_bdata.reads_dir_path,'reads_1.fq')
+        st_index  = os.path.join(os.getcwd(),'test_stats')
+        ret = g_bt.build("--quiet --offrate 4 %s %s" % (ref_fasta,st_index))
+        self.assertEqual(ret, 0)
+        for budget in ['', '--stats-mem 3']:
+            out = g_bt.inspect("--stats --stats-reads %s %s %s" % (reads,budget,st_index))
+            lines = [l.split('\t') for l in out.splitlines()]
+            fields = dict((l[0], l[1:]) for l in lines if len(l) > 1)
+            # Sampling every 16th row leaves about 15 steps per lookup
+            self.assertTrue(13.0 < float(fields['WalkLeft-Mean'][0]) < 17.0)
+            self.assertEqual(int(fields['Reads'][0]), 10000)
+            models = [l for l in lines if l[0] == 'Model']
+            self.assertTrue(['Model', '4', '10'] in [m[:3] for m in models])
+            self.assertTrue(all(m[5] == ('measured' if int(m[1]) >= 4 else 'estimated') for m in models))
+            rec = fields['Recommend']
+            self.assertTrue(int(rec[1]) <= int(fields['Memory-Budget'][0]))
+            if budget:
+                # An ftab of 4^10 entries alone won't fit in 3 MB
+                self.assertTrue(int(rec[0].split()[-1]) < 10)
+        for f in os.listdir(os.getcwd()):
+            if f.startswith('test_stats.'):
+                os.remove(f)
+
+
+    def test_inspect_threads(self):
+        """ Check that bowtie2-inspect writes the same FASTA with several
+            threads as with one, from the reference and from the BWT.
+        """
+        ref_fasta = os.path.join(g_bdata.ref_dir_path,'lambda_virus.fa')
+        th_fasta  = os.path.join(os.getcwd(),'test_threads.fa')
+        th_index  = os.path.join(os.getcwd(),'test_threads')
+        seq = "".join([l.strip() for l in open(ref_fasta) if l[0] != '>'])
+        fh = open(th_fasta, 'w')
+        # Several references, with leading, inner and trailing Ns
+        fh.write(">one\n%s\n" % seq)
+        fh.write(">two\nNNN%sNNNNNNNNNN%sNN\n" % (seq[:10000], seq[20000:31000]))
+        fh.write(">three\n%s\n" % seq[5:80])
+        fh.close()
+        ret = g_bt.build("--quiet %s %s" % (th_fasta,th_index))
+        self.assertEqual(ret, 0)
+        for opts in ['', '-e', '-a 0', '-e -a 0', '-e -a 7']:
+            one  = g_bt.inspect("-p 1 %s %s" % (opts,th_index))
+            many = g_bt.inspect("-p 4 %s %s" % (opts,th_index))
+            self.assertEqual(one.count('>'), 3)
+            self.assertEqual(one, many)
+        for f in os.listdir(os.getcwd()):
+            if f.startswith('test_threads.'):
+                os.remove(f)
+
+
+    def test_mapq_stop(self):
+        """ Check that --mapq-stop leaves AS:i, XS:i and MAPQ unchanged for
+            reads whose best alignment is perfect and repeated.
+        """
+        ref_fasta = os.path.join(g_bdata.ref_dir_path,'lambda_virus.fa')
+        rep_fasta = os.path.join(os.getcwd(),'test_mapq_stop.fa')
+        rep_index = os.path.join(os.getcwd(),'test_mapq_stop')
+        reads     = 'test_mapq_stop.fq'
+        out_sam   = 'test_mapq_stop.sam'
+        seq = "".join([l.strip() for l in open(ref_fasta) if l[0] != '>'])
+        seg = seq[:2000]
+        fh = open(rep_fasta, 'w')
+        fh.write(">copy1\n%s\n>copy2\n%s\n" % (seg, seg))
+        fh.close()
+        fh = open(reads, 'w')
+        for i in range(0, 1800, 150):
+            fh.write("@r%d\n%s\n+\n%s\n" % (i, seg[i:i+100], 'I' * 100))
+        fh.close()
+        ret = g_bt.build("--quiet %s %s" % (rep_fasta,rep_index))
+        self.assertEqual(ret, 0)
+        results = []
+        for opts in ["", "--mapq-stop", "--local", "--local --mapq-stop"]:
+            args = "--quiet -x %s -U %s %s -S %s" % (rep_index,reads,opts,out_sam)
+            ret = g_bt.run(args)
+            self.assertEqual(ret, 0)
+            recs = []
+            for line in open(out_sam):
+                if line[0] == '@':
+                    continue
+                fields = line.rstrip().split('\t')
+                tags = [f for f in fields[11:] if f[:5] in ('AS:i:', 'XS:i:')]
+                recs.append((fields[0], fields[4], sorted(tags)))
+            results.append(recs)
+        self.assertEqual(len(results[0]), 12)
+        self.assertEqual(results[0], results[1])
+        self.assertEqual(results[2], results[3])
+        os.remove(out_sam)
+        os.remove(reads)
+        for f in os.listdir(os.getcwd()):
+            if f.startswith('test_mapq_stop.'):
+                os.remove(f)
+
+    def test_desc_len(self):
+        """ Check that reads aligned by the descent search with --desc-len
+            get the same positions and scores as with seed-and-extend.
+        """
+        ref_fasta = os.path.join(g_bdata.ref_dir_path,'lambda_virus.fa')
+        lambda_index = os.path.join(g_bdata.index_dir_path,'lambda_virus')
+        reads     = 'test_desc_len.fq'
+        out_sam   = 'test_desc_len.sam'
+        seq = "".join([l.strip() for l in open(ref_fasta) if l[0] != '>'])
+        comp = {'A':'T', 'C':'G', 'G':'C', 'T':'A'}
+        fh = open(reads, 'w')
+        for i in range(0, 40000, 1000):
+            rd = list(seq[i:i+50])
+            if (i // 1000) % 2 == 1:
+                # One mismatch near the 3' end
+                rd[45] = comp[rd[45]]
+            rd = "".join(rd)
+            if (i // 1000) % 4 >= 2:
+                rd = "".join([comp[c] for c in reversed(rd)])
+            fh.write("@r%d\n%s\n+\n%s\n" % (i, rd, 'I' * 50))
+        fh.close()
+        results = []
+        # Without 1-mismatch end-to-end search, only the descent needs the
+        # mirror index
+        for opts in ["", "--desc-len 60", "--desc-len 60 --no-1mm-upfront"]:
+            args = "--quiet -x %s -U %s %s -S %s" % (lambda_index,reads,opts,out_sam)
+            ret = g_bt.run(args)
+            self.assertEqual(ret, 0)
+            recs = []
+            for line in open(out_sam):
+                if line[0] == '@':
+                    continue
+                fields = line.rstrip().split('\t')
+                tags = [f for f in fields[11:] if f[:5] in ('AS:i:', 'NM:i:')]
+                recs.append((fields[0], fields[1], fields[3], fields[5], sorted(tags)))
+            results.append(recs)
+        self.assertEqual(len(results[0]), 40)
+        self.assertEqual(results[0], results[1])
+        self.assertEqual(results[0], results[2])
+        os.remove(out_sam)
+        os.remove(reads)
+
+    def test_descent_parity(self):
+        """ Check that --descent places reads where the default aligner
+            does, for both unpaired and paired example reads.
+        """
+        lambda_index = os.path.join(g_bdata.index_dir_path,'lambda_virus')
+        reads_1 = os.path.join(g_bdata.reads_dir_path,'reads_1.fq')
+        reads_2 = os.path.join(g_bdata.reads_dir_path,'reads_2.fq')
+        out_sam = 'test_descent_parity.sam'
+
+        def aligned(args):
+            ret = g_bt.silent_run("-x %s %s -S %s" % (lambda_index,args,out_sam))
+            self.assertEqual(ret, 0)
+            recs = {}
+            for line in open(out_sam):
+                if line[0] == '@':
+                    continue
+                fields = line.split('\t')
+                flag = int(fields[1])
+                if flag & 4 == 0:
+                    recs[(fields[0], flag & 192)] = (fields[2], fields[3])
+            return recs
+
+        for inputs in ["-U %s" % reads_1, "-1 %s -2 %s" % (reads_1,reads_2)]:
+            sw = aligned(inputs)
+            desc = aligned("--descent " + inputs)
+            both = [k for k in desc if k in sw]
+            same = [k for k in both if desc[k] == sw[k]]
+            self.assertTrue(len(desc) >= 0.8 * len(sw))
+            self.assertTrue(len(same) >= 0.99 * len(both))
+        ret = g_bt.silent_run("-x %s -U %s --descent --local -S %s" % (lambda_index,reads_1,out_sam))
+        self.assertNotEqual(ret, 0)
+        os.remove(out_sam)
+
+    def test_bz2_input(self):
+        """ Check that bzip2-compressed reads, including files made of
+            several concatenated bzip2 streams, align like plain ones.
+        """
+        import bz2
+        lambda_index = os.path.join(g_bdata.index_dir_path,'lambda_virus')
+        reads_1 = os.path.join(g_bdata.reads_dir_path,'reads_1.fq')
+        reads_2 = os.path.join(g_bdata.reads_dir_path,'reads_2.fq')
+        data = open(reads_2, 'rb').read()
+        half = data.index(b'\n@', len(data) // 2) + 1
+        fh = open('test_bz2_input.fq.bz2', 'wb')
+        fh.write(bz2.compress(data[:half]))
+        fh.write(bz2.compress(data[half:]))
+        fh.close()
+        results = []
+        for mate2 in [reads_2, 'test_bz2_input.fq.bz2']:
+            args = "-x %s -1 %s -2 %s -S test_bz2_input.sam" % (lambda_index,reads_1,mate2)
+            self.assertEqual(g_bt.silent_run(args), 0)
+            results.append([l for l in open('test_bz2_input.sam') if not l.startswith('@PG')])
+        self.assertEqual(len(results[0]), len(results[1]))
+        self.assertEqual(results[0], results[1])
+        os.remove('test_bz2_input.fq.bz2')
+        os.remove('test_bz2_input.sam')
+
+    def test_dust(self):
+        """ Check that --dust filters low-complexity reads with YF:Z:LC
+            and leaves ordinary reads alone.
+        """
+        ref_fasta = os.path.join(g_bdata.ref_dir_path,'lambda_virus.fa')
+        lambda_index = os.path.join(g_bdata.index_dir_path,'lambda_virus')
+        reads   = 'test_dust.fq'
+        out_sam = 'test_dust.sam'
+        seq = "".join([l.strip() for l in open(ref_fasta) if l[0] != '>'])
+        fh = open(reads, 'w')
+        low = ['A' * 100, 'AT' * 50, 'CAG' * 33 + 'C', 'A' * 60 + 'N' * 5 + 'A' * 35]
+        for i, rd in enumerate(low):
+            fh.write("@low%d\n%s\n+\n%s\n" % (i, rd, 'I' * len(rd)))
+        for i in range(0, 40000, 2000):
+            fh.write("@lam%d\n%s\n+\n%s\n" % (i, seq[i:i+100], 'I' * 100))
+        fh.close()
+        for opts, nlc in [("", 0), ("--dust 30", 4), ("--dust 60", 2)]:
+            args = "-x %s -U %s %s -S %s" % (lambda_index,reads,opts,out_sam)
+            self.assertEqual(g_bt.silent_run(args), 0)
+            lc = []
+            for line in open(out_sam):
+                if line[0] == '@':
+                    continue
+                fields = line.rstrip().split('\t')
+                if 'YF:Z:LC' in fields[11:]:
+                    self.assertTrue(int(fields[1]) & 4 != 0)
+                    lc.append(fields[0])
+                elif fields[0].startswith('lam'):
+                    self.assertTrue(int(fields[1]) & 4 == 0)
+            self.assertEqual(len(lc), nlc)
+            self.assertTrue(all(n.startswith('low') for n in lc))
+        os.remove(out_sam)
+        os.remove(reads)
+
+    def test_multi_index(self):
+        """ Check that reads are aligned to several -x indexes in turn and
+            tagged with the index they aligned to.
+        """
+        ref_fasta = os.path.join(g_bdata.ref_dir_path,'lambda_virus.fa')
+        lambda_index = os.path.join(g_bdata.index_dir_path,'lambda_virus')
+        reads     = os.path.join(g_bdata.reads_dir_path,'reads_1.fq')
+        out_sam   = 'test_multi_index.sam'
+        seq = "".join([l.strip() for l in open(ref_fasta) if l[0] != '>'])
+        halves = []
+        for name, part in [('A', seq[:24000]), ('B', seq[24000:])]:
+            fasta = os.path.join(os.getcwd(),'test_multi_index.%s.fa' % name)
+            index = os.path.join(os.getcwd(),'test_multi_index.%s' % name)
+            fh = open(fasta, 'w')
+            fh.write(">part%s\n%s\n" % (name, part))
+            fh.close()
+            self.assertEqual(g_bt.build("--quiet %s %s" % (fasta,index)), 0)
+            halves.append(index)
+
+        def records(opts):
+            args = "-x %s -U %s %s -S %s" % (" -x ".join(halves),reads,opts,out_sam)
+            self.assertEqual(g_bt.silent_run(args), 0)
+            sq, recs = [], []
+            for line in open(out_sam):
+                fields = line.rstrip().split('\t')
+                if line.startswith('@SQ'):
+                    sq.append(fields[1])
+                elif line[0] != '@':
+                    recs.append(fields)
+            return sq, recs
+
+        sq, recs = records("")
+        self.assertEqual(sq, ['SN:partA', 'SN:partB'])
+        naligned = [0, 0]
+        for fields in recs:
+            xi = [f for f in fields[11:] if f.startswith('XI:i:')]
+            if int(fields[1]) & 4 != 0:
+                self.assertEqual(xi, [])
+                continue
+            self.assertEqual(xi, ['XI:i:%d' % ('AB'.index(fields[2][-1]))])
+            naligned['AB'.index(fields[2][-1])] += 1
+        self.assertTrue(naligned[0] > 4000 and naligned[1] > 4000)
+        # A later index that is missing a file is an ordinary error, not a
+        # crash in the worker thread that loads it
+        os.remove(halves[1] + '.3.bt2')
+        args = "-p 2 -x %s -U %s -S %s" % (" -x ".join(halves),reads,out_sam)
+        self.assertEqual(g_bt.silent_run(args), 1)
+        # The same index twice: every read that aligns aligns to both when
+        # --all-indexes is given, so none is unique
+        halves = [lambda_index, lambda_index]
+        sq, recs = records("")
+        self.assertTrue(any(int(f[4]) > 1 for f in recs))
+        sq, recs = records("--all-indexes")
+        self.assertTrue(all(int(f[4]) <= 1 for f in recs))
+        os.remove(out_sam)
+        for f in os.listdir(os.getcwd()):
+            if f.startswith('test_multi_index.'):
+                os.remove(f)
+
+    def test_shard(self):
+        """ Check that merging the output of --shard runs reproduces the
+            output of an unsharded run, for unpaired and paired reads.
+        """
+        lambda_index = os.path.join(g_bdata.index_dir_path,'lambda_virus')
+        reads_1 = os.path.join(g_bdata.reads_dir_path,'reads_1.fq')
+        reads_2 = os.path.join(g_bdata.reads_dir_path,'reads_2.fq')
+        nshards = 3
+        for reads in ["-U %s" % reads_1, "-1 %s -2 %s" % (reads_1, reads_2)]:
+            args = "-x %s %s -S test_shard.sam" % (lambda_index,reads)
+            self.assertEqual(g_bt.silent_run(args), 0)
+            shards = []
+            for i in range(nshards):
+                out_sam = "test_shard%d.sam" % i
+                args = "-p 2 --shard %d/%d -x %s %s -S %s" % (i,nshards,lambda_index,reads,out_sam)
+                self.assertEqual(g_bt.silent_run(args), 0)
+                shards.append(out_sam)
+            self.assertEqual(g_bt.merge_shards("-o test_shard_merged.sam", *shards), 0)
+            expected = [l for l in open('test_shard.sam') if not l.startswith('@PG')]
+            merged = [l for l in open('test_shard_merged.sam') if not l.startswith('@PG')]
+            self.assertEqual(len(merged), len(expected))
+            self.assertTrue(merged == expected)
+            for fn in shards + ['test_shard.sam', 'test_shard_merged.sam']:
+                os.remove(fn)
+        # Options that leave reads without records, or start the input
+        # part way through a round of shards, would break the merge
+        for opts in ["--no-unal", "--sample 0.5", "-s 1"]:
+            args = "--shard 0/%d %s -x %s -U %s -S test_shard.sam" % (nshards,opts,lambda_index,reads_1)
+            self.assertNotEqual(g_bt.silent_run(args), 0)
+        args = "--shard 0/%d -s %d -x %s -U %s -S test_shard.sam" % (nshards,2*nshards,lambda_index,reads_1)
+        self.assertEqual(g_bt.silent_run(args), 0)
+        os.remove('test_shard.sam')
+
+    def test_un_al(self):
+        """ Check that --un/--al and --un-conc/--al-conc split the input
+            reads according to the SAM flags, with and without gzip and
+            with several threads, that the Nth records of the mate-1 and
+            mate-2 files always come from the same pair, and that
+            --reorder keeps them in input order.
+        """
+        import gzip
+        lambda_index = os.path.join(g_bdata.index_dir_path,'lambda_virus')
+        reads_1 = os.path.join(g_bdata.reads_dir_path,'reads_1.fq')
+        reads_2 = os.path.join(g_bdata.reads_dir_path,'reads_2.fq')
+        out_sam = 'test_un_al.sam'
+        # Several 256 KB chunks' worth of reads per thread
+        self.assertTrue(os.path.getsize(reads_1) > 4 * 256 * 1024)
+
+        def names(fn):
+            opener = gzip.open if fn.endswith('.gz') else open
+            lines = opener(fn).read().decode().split('\n')
+            ret = []
+            for i in range(0, len(lines) - 1, 4):
+                name = lines[i][1:]
+                if name.endswith('/1') or name.endswith('/2'):
+                    name = name[:-2]
+                ret.append(name)
+            return ret
+
+        def flagged(bit, want):
+            ret = []
+            for line in open(out_sam):
+                if line[0] == '@':
+                    continue
+                fields = line.split('\t')
+                flag = int(fields[1])
+                if flag & 256 == 0 and flag & 128 == 0 and ((flag & bit) != 0) == want:
+                    ret.append(fields[0])
+            return ret
+
+        for opts in ["", "-p 4", "-p 4 --reorder"]:
+            ordered = opts != "-p 4"
+            args = "-x %s -U %s --un un.fq --al-gz al.fq.gz %s -S %s" % (lambda_index,reads_1,opts,out_sam)
+            self.assertEqual(g_bt.silent_run(args), 0)
+            if ordered:
+                self.assertEqual(names('un.fq'), flagged(4, True))
+                self.assertEqual(names('al.fq.gz'), flagged(4, False))
+            self.assertEqual(sorted(names('un.fq')), sorted(flagged(4, True)))
+            self.assertEqual(sorted(names('al.fq.gz')), sorted(flagged(4, False)))
+            self.assertEqual(len(names('un.fq')) + len(names('al.fq.gz')), 10000)
+            args = "-x %s -1 %s -2 %s --un-conc-gz unc%%.fq.gz --al-conc alc.fq %s -S %s" % (lambda_index,reads_1,reads_2,opts,out_sam)
+            self.assertEqual(g_bt.silent_run(args), 0)
+            # Mate files must agree record by record
+            self.assertEqual(names('unc1.fq.gz'), names('unc2.fq.gz'))
+            self.assertEqual(names('alc.1.fq'), names('alc.2.fq'))
+            if ordered:
+                self.assertEqual(names('unc1.fq.gz'), flagged(2, False))
+                self.assertEqual(names('alc.1.fq'), flagged(2, True))
+            self.assertEqual(sorted(names('unc1.fq.gz')), sorted(flagged(2, False)))
+            self.assertEqual(sorted(names('alc.1.fq')), sorted(flagged(2, True)))
+        # bzip2 output goes through the shell; a quote in the name must
+        # stay part of the name
+        # (al.fq.gz is from the --reorder run, so in input order too)
+        import bz2
+        args = "-x %s -U %s --al-bz2 \"al'q.fq.bz2\" -S %s" % (lambda_index,reads_1,out_sam)
+        self.assertEqual(g_bt.silent_run(args), 0)
+        self.assertEqual(bz2.BZ2File("al'q.fq.bz2").read(), gzip.open('al.fq.gz').read())
+        for fn in ['un.fq', 'al.fq.gz', "al'q.fq.bz2", 'unc1.fq.gz', 'unc2.fq.gz', 'alc.1.fq', 'alc.2.fq', out_sam]:
+            os.remove(fn)
+
+    def test_checkpoint_resume(self):
+        """ Check that a run stopped part way through and continued with
+            --resume produces the same output as an uninterrupted run, even
+            when output was written after the last checkpoint.
+        """
+        lambda_index = os.path.join(g_bdata.index_dir_path,'lambda_virus')
+        reads_1 = os.path.join(g_bdata.reads_dir_path,'reads_1.fq')
+        reads_2 = os.path.join(g_bdata.reads_dir_path,'reads_2.fq')
+        ckpt = 'test_ckpt.txt'
+        for reads in ["-U %s" % reads_1, "-1 %s -2 %s" % (reads_1, reads_2)]:
+            args = "-x %s %s -S test_ckpt_full.sam" % (lambda_index,reads)
+            self.assertEqual(g_bt.silent_run(args), 0)
+            # Stop after 3000 reads, then add a partial record as though the
+            # run had crashed while writing
+            args = "-p 2 -u 3000 --checkpoint %s --checkpoint-every 500 -x %s %s -S test_ckpt.sam" % (ckpt,lambda_index,reads)
+            self.assertEqual(g_bt.silent_run(args), 0)
+            with open('test_ckpt.sam', 'a') as fh:
+                fh.write('r3001\t0\tgi|9626243|ref|NC_001416.1|\t1')
+            args = "-p 2 --checkpoint %s --resume -x %s %s -S test_ckpt.sam" % (ckpt,lambda_index,reads)
+            self.assertEqual(g_bt.silent_run(args), 0)
+            expected = [l for l in open('test_ckpt_full.sam') if not l.startswith('@PG')]
+            resumed = [l for l in open('test_ckpt.sam') if not l.startswith('@PG')]
+            self.assertEqual(len(resumed), len(expected))
+            self.assertTrue(resumed == expected)
+            for fn in [ckpt, 'test_ckpt.sam', 'test_ckpt_full.sam']:
+                os.remove(fn)
+
+    def test_async_io(self):
+        """ Check that --async-io gives the same output as ordinary reads
+            and writes, including when resuming part way through a file.
+        """
+        lambda_index = os.path.join(g_bdata.index_dir_path,'lambda_virus')
+        reads_1 = os.path.join(g_bdata.reads_dir_path,'reads_1.fq')
+        reads_2 = os.path.join(g_bdata.reads_dir_path,'reads_2.fq')
+        ckpt = 'test_aio_ckpt.txt'
+        for reads in ["-U %s" % reads_1, "-1 %s -2 %s" % (reads_1, reads_2)]:
+            args = "-p 2 --reorder -x %s %s -S test_aio_sync.sam" % (lambda_index,reads)
+            self.assertEqual(g_bt.silent_run(args), 0)
+            args = "-p 2 --reorder --async-io -x %s %s -S test_aio.sam" % (lambda_index,reads)
+            self.assertEqual(g_bt.silent_run(args), 0)
+            expected = [l for l in open('test_aio_sync.sam') if not l.startswith('@PG')]
+            got = [l for l in open('test_aio.sam') if not l.startswith('@PG')]
+            self.assertEqual(len(got), len(expected))
+            self.assertTrue(got == expected)
+            # Resuming seeks the read-ahead to the checkpointed offset
+            args = "-u 3000 --async-io --checkpoint %s --checkpoint-every 500 -x %s %s -S test_aio.sam" % (ckpt,lambda_index,reads)
+            self.assertEqual(g_bt.silent_run(args), 0)
+            args = "--async-io --checkpoint %s --resume -x %s %s -S test_aio.sam" % (ckpt,lambda_index,reads)
+            self.assertEqual(g_bt.silent_run(args), 0)
+            got = [l for l in open('test_aio.sam') if not l.startswith('@PG')]
+            self.assertTrue(got == expected)
+            for fn in [ckpt, 'test_aio.sam', 'test_aio_sync.sam']:
+                os.remove(fn)
+
+    def test_met_live(self):
+        """ Check that the --met-live file accounts for every read once the
+            run has finished.
+        """
+        lambda_index = os.path.join(g_bdata.index_dir_path,'lambda_virus')
+        reads_1 = os.path.join(g_bdata.reads_dir_path,'reads_1.fq')
+        reads_2 = os.path.join(g_bdata.reads_dir_path,'reads_2.fq')
+        args = "-p 3 --met-live test_live.bin -x %s -1 %s -2 %s -S test_live.sam" % (lambda_index,reads_1,reads_2)
+        self.assertEqual(g_bt.silent_run(args), 0)
+        with open('test_live.bin', 'rb') as fh:
+            data = fh.read()
+        magic, version, nslots, slot_bytes = struct.unpack('=8sIII', data[:20])
+        state, = struct.unpack('=Q', data[40:48])
+        self.assertEqual(magic, b'BT2LIVE\0')
+        self.assertEqual(version, 1)
+        self.assertEqual(nslots, 3)
+        self.assertEqual(state, 1)
+        self.assertEqual(len(data), 64 + nslots * slot_bytes)
+        reads = mates = aligned = 0
+        for i in range(nslots):
+            w = struct.unpack('=16Q', data[64 + i*slot_bytes:64 + (i+1)*slot_bytes])
+            self.assertEqual(w[0] % 2, 0)
+            self.assertEqual(w[11], 1)
+            reads += w[2]
+            mates += w[4]
+            aligned += w[5]
+        self.assertEqual(reads, 10000)
+        self.assertEqual(mates, 20000)
+        self.assertTrue(0 < aligned <= mates)
+        for fn in ['test_live.bin', 'test_live.sam']:
+            os.remove(fn)
+
+    def test_mate_isect(self):
+        """ Check that --mate-isect finds the same concordant pairs as
+            extending each mate's seed hits on its own.
+        """
+        lambda_index = os.path.join(g_bdata.index_dir_path,'lambda_virus')
+        reads_1 = os.path.join(g_bdata.reads_dir_path,'reads_1.fq')
+        reads_2 = os.path.join(g_bdata.reads_dir_path,'reads_2.fq')
+        for extra in ["", "-I 200 -X 400 --local"]:
+            pairs = []
+            for opt in ["", "--mate-isect"]:
+                args = "%s %s -x %s -1 %s -2 %s -S test_isect.sam" % (opt,extra,lambda_index,reads_1,reads_2)
+                self.assertEqual(g_bt.silent_run(args), 0)
+                conc = set()
+                for line in open('test_isect.sam'):
+                    if line.startswith('@'):
+                        continue
+                    fields = line.split('\t')
+                    if int(fields[1]) & 2:
+                        conc.add((fields[0], fields[1], fields[2], fields[3]))
+                pairs.append(conc)
+            self.assertTrue(len(pairs[0]) > 0)
+            self.assertTrue(pairs[0] == pairs[1])
+        os.remove('test_isect.sam')
         
+    def test_cigar_md(self):
+        """ Check that CIGAR, MD:Z, XM:i and NM:i describe each alignment's
+            columns against the reference, for ungapped alignments (written
+            straight from the mismatches) and gapped ones (left-aligned from
+            the stacked columns) alike, with mismatches and Ns in the reads.
+        """
+        import random
+        import re
+        ref_fasta = os.path.join(g_bdata.ref_dir_path,'lambda_virus.fa')
+        lambda_index = os.path.join(g_bdata.index_dir_path,'lambda_virus')
+        ref = "".join([l.strip() for l in open(ref_fasta) if l[0] != '>'])
+        comp = {'A': 'T', 'C': 'G', 'G': 'C', 'T': 'A', 'N': 'N'}
+        rnd = random.Random(89)
+        fh = open('test_cigar_md.fq', 'w')
+        for i in range(2000):
+            off = rnd.randint(0, len(ref) - 150)
+            rd = list(ref[off:off+120])
+            for j in range(rnd.randint(0, 5)):
+                p = rnd.randint(0, len(rd) - 1)
+                rd[p] = rnd.choice([c for c in 'ACGT' if c != rd[p]])
+            for j in range(rnd.randint(0, 2)):
+                rd[rnd.randint(0, len(rd) - 1)] = 'N'
+            if i % 4 == 1:
+                p = rnd.randint(20, 100)
+                rd[p:p] = [rnd.choice('ACGT') for k in range(rnd.randint(1, 3))]
+            elif i % 4 == 2:
+                p = rnd.randint(20, 100)
+                del rd[p:p+rnd.randint(1, 3)]
+            rd = "".join(rd)
+            if i % 2 == 1:
+                rd = "".join([comp[c] for c in reversed(rd)])
+            fh.write("@r%d\n%s\n+\n%s\n" % (i, rd, 'I' * len(rd)))
+        fh.close()
+        optss = ["", "--xeq", "--local", "--local --xeq"]
+        if os.path.exists(g_bt.bowtie_bin + '-align-s-debug'):
+            # The debug aligner also checks the ungapped fast path against
+            # the stacked columns for every alignment it writes
+            optss += ["--debug", "--debug --local"]
+        for opts in optss:
+            args = "-x %s -U test_cigar_md.fq %s -S test_cigar_md.sam" % (lambda_index,opts)
+            self.assertEqual(g_bt.silent_run(args), 0)
+            naligned, ngapped = 0, 0
+            for line in open('test_cigar_md.sam'):
+                if line[0] == '@':
+                    continue
+                fields = line.rstrip().split('\t')
+                if int(fields[1]) & 4 != 0:
+                    continue
+                naligned += 1
+                seq, rpos, qpos = fields[9], int(fields[3]) - 1, 0
+                md, mdrun, nmm, ngap = [], 0, 0, 0
+                for n, op in re.findall(r'(\d+)([MIDS=X])', fields[5]):
+                    n = int(n)
+                    if op in 'M=X':
+                        for k in range(n):
+                            same = seq[qpos+k] == ref[rpos+k] and seq[qpos+k] != 'N'
+                            self.assertTrue(op == 'M' or (op == '=') == same)
+                            if same:
+                                mdrun += 1
+                            else:
+                                md.append("%d%s" % (mdrun, ref[rpos+k]))
+                                mdrun, nmm = 0, nmm + 1
+                        qpos, rpos = qpos + n, rpos + n
+                    elif op == 'D':
+                        md.append("%d^%s" % (mdrun, ref[rpos:rpos+n]))
+                        mdrun, rpos, ngap = 0, rpos + n, ngap + n
+                    else:
+                        qpos += n
+                        if op == 'I':
+                            ngap += n
+                self.assertEqual(qpos, len(seq))
+                self.assertTrue(opts.find('--xeq') < 0 or fields[5].find('M') < 0)
+                tags = dict([(f[:2], f[5:]) for f in fields[11:]])
+                self.assertEqual(tags['MD'], "".join(md) + str(mdrun))
+                self.assertEqual(int(tags['XM']), nmm)
+                self.assertEqual(int(tags['NM']), nmm + ngap)
+                if ngap > 0:
+                    ngapped += 1
+            self.assertTrue(naligned > 1800 and ngapped > 500)
+        os.remove('test_cigar_md.fq')
+        os.remove('test_cigar_md.sam')
+
+    def test_redundant_alns(self):
+        """ Check that with -k and -a no two alignments reported for a read
+            share a cell (a read position aligned to a reference position
+            on the same strand), and that alignments to distinct copies of
+            a repeat are all still reported.  The debug aligner also checks
+            each redundancy decision against the alignments' cells.
+        """
+        import random
+        import re
+        ref_fasta = os.path.join(g_bdata.ref_dir_path,'lambda_virus.fa')
+        seq = "".join([l.strip() for l in open(ref_fasta) if l[0] != '>'])
+        rnd = random.Random(91)
+        unit = seq[5000:6000]
+        # Four copies of a 1 kb segment, and two tandem repeats whose reads
+        # align at several diagonals of the same stretch
+        tandem = seq[9000:9040] * 12
+        tandem2 = "ACGTTGC" * 60
+        parts = []
+        for i in range(4):
+            parts.append("".join([rnd.choice('ACGT') for k in range(500)]))
+            parts.append(unit)
+        parts.append(seq[20000:22000] + tandem + seq[30000:32000])
+        parts.append(seq[40000:41000] + tandem2 + seq[41000:42000])
+        fasta = os.path.join(os.getcwd(),'test_redundant_alns.fa')
+        index = os.path.join(os.getcwd(),'test_redundant_alns')
+        fh = open(fasta, 'w')
+        fh.write(">rep\n%s\n" % "".join(parts))
+        fh.close()
+        self.assertEqual(g_bt.build("--quiet %s %s" % (fasta,index)), 0)
+        fh = open('test_redundant_alns.fq', 'w')
+        for i in range(200):
+            off = rnd.randint(0, len(unit) - 100)
+            rd = list(unit[off:off+100])
+            p = rnd.randint(0, 99)
+            rd[p] = rnd.choice([c for c in 'ACGT' if c != rd[p]])
+            fh.write("@u%d\n%s\n+\n%s\n" % (i, "".join(rd), 'I' * 100))
+        for i in range(50):
+            off = rnd.randint(0, len(tandem) - 100)
+            fh.write("@t%d\n%s\n+\n%s\n" % (i, tandem[off:off+100], 'I' * 100))
+        for i in range(50):
+            # Gapped reads from the short-period repeat
+            off = rnd.randint(0, len(tandem2) - 100)
+            rd = list(tandem2[off:off+100])
+            p = rnd.randint(20, 80)
+            if i % 2 == 0:
+                rd[p:p] = [rnd.choice('ACGT')] * rnd.randint(1, 3)
+            else:
+                del rd[p:p+rnd.randint(1, 3)]
+            fh.write("@g%d\n%s\n+\n%s\n" % (i, "".join(rd), 'I' * len(rd)))
+        fh.close()
+        optss = ["-k 10", "-k 10 --local", "-a"]
+        if os.path.exists(g_bt.bowtie_bin + '-align-s-debug'):
+            optss += ["--debug -a", "--debug -a --local"]
+        for opts in optss:
+            args = "-x %s -U test_redundant_alns.fq %s -S test_redundant_alns.sam" % (index,opts)
+            self.assertEqual(g_bt.silent_run(args), 0)
+            alns = {}
+            for line in open('test_redundant_alns.sam'):
+                if line[0] == '@':
+                    continue
+                fields = line.split('\t')
+                flags = int(fields[1])
+                if flags & 4 != 0:
+                    continue
+                cells = set()
+                rpos, qpos = int(fields[3]) - 1, 0
+                for n, op in re.findall(r'(\d+)([MIDS=X])', fields[5]):
+                    n = int(n)
+                    if op in 'M=X':
+                        for k in range(n):
+                            cells.add((flags & 16, qpos + k, rpos + k))
+                    if op in 'M=XIS':
+                        qpos += n
+                    if op in 'M=XD':
+                        rpos += n
+                alns.setdefault(fields[0], []).append(cells)
+            for name, cellss in alns.items():
+                for i in range(len(cellss)):
+                    for j in range(i):
+                        self.assertEqual(len(cellss[i] & cellss[j]), 0)
+                if name[0] == 'u':
+                    self.assertEqual(len(cellss), 4)
+            self.assertEqual(len([n for n in alns if n[0] == 'u']), 200)
+            self.assertTrue(max([len(alns[n]) for n in alns if n[0] == 't']) > 4)
+        for f in os.listdir(os.getcwd()):
+            if f.startswith('test_redundant_alns.'):
+                os.remove(f)
+
 
    
 def get_suite():
@@ -21,6 +21,7 @@
 #define SSTRING_H_
 
 #include <string.h>
+#include <algorithm>
 #include <iostream>
 #include "assert_helpers.h"
 #include "alphabet.h"
@@ -1750,6 +1751,16 @@ public:
 		return *this;
 	}
 
+	/**
+	 * Exchange buffers with another SStringExpandable.
+	 */
+	void swap(SStringExpandable<T,S,M,I>& o) {
+		std::swap(cs_, o.cs_);
+		std::swap(printcs_, o.printcs_);
+		std::swap(len_, o.len_);
+		std::swap(sz_, o.sz_);
+	}
+
 	/**
 	 * Insert char c before position 'idx'; slide subsequent chars down.
 	 */
@@ -2118,6 +2129,18 @@ protected:
 	size_t sz_;  // size capacity of cs_
 };
 
+/**
+ * When an EList of strings is reallocated, hand each string's buffer over
+ * rather than copying it.
+ */
+template<typename T, int S, int M, int I>
+inline void relocate(
+	SStringExpandable<T, S, M, I>& dst,
+	SStringExpandable<T, S, M, I>& src)
+{
+	dst.swap(src);
+}
+
 /**
  * Simple string class with in-object storage.
  *
@@ -3116,6 +3139,14 @@ public:
 	virtual const char* toZBuf() const { return this->toZBufXForm("ACGTN"); }
 };
 
+template<int S, int M>
+inline void relocate(
+	SDnaStringExpandable<S, M>& dst,
+	SDnaStringExpandable<S, M>& src)
+{
+	dst.swap(src);
+}
+
 /**
  * Encapsulates an expandable DNA string with characters encoded as
  * char-sized masks.  Encodes A, C, G, T, and all IUPAC, as well as the